@@ -0,0 +1,299 @@
+// filename: GUI_TextOverlay.c
+#include "GUI_TextOverlay.h"
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <string.h>
+
+static const char *TAG = "GUI_TextOverlay";
+
+#define ATLAS_FIRST_CHAR ' '
+#define ATLAS_LAST_CHAR '~'
+#define ATLAS_GLYPH_COUNT (ATLAS_LAST_CHAR - ATLAS_FIRST_CHAR + 1)
+#define ATLAS_CACHE_SIZE 4
+#define ATLAS_MAX_SCALE 8
+
+// One atlas per (font, scale, rotation). Each glyph is stored twice: phase 0 starts on a
+// byte boundary, phase 1 has one leading empty nibble so that glyphs landing on an odd
+// memory column can still be blitted a whole byte at a time.
+typedef struct {
+    const sFONT *font;
+    UBYTE scale;
+    UWORD rotate;
+    UWORD cell_width;   // glyph width in panel memory order (pixels)
+    UWORD cell_height;  // glyph height in panel memory order (pixels)
+    UBYTE *glyphs[2][ATLAS_GLYPH_COUNT];  // nibble masks, 0xF where the glyph is set
+    UDOUBLE last_used;
+} GLYPH_ATLAS;
+
+// Only touched while the caller owns the framebuffer, so no locking here
+static GLYPH_ATLAS atlases[ATLAS_CACHE_SIZE];
+static UDOUBLE atlas_clock = 0;
+
+static void atlas_release(GLYPH_ATLAS *atlas)
+{
+    for (int phase = 0; phase < 2; phase++) {
+        for (int i = 0; i < ATLAS_GLYPH_COUNT; i++) {
+            heap_caps_free(atlas->glyphs[phase][i]);
+        }
+    }
+    memset(atlas, 0, sizeof(*atlas));
+}
+
+static GLYPH_ATLAS *atlas_get(sFONT *Font, UBYTE scale, UWORD rotate)
+{
+    GLYPH_ATLAS *victim = &atlases[0];
+
+    atlas_clock++;
+    for (int i = 0; i < ATLAS_CACHE_SIZE; i++) {
+        GLYPH_ATLAS *atlas = &atlases[i];
+        if (atlas->font == Font && atlas->scale == scale && atlas->rotate == rotate) {
+            atlas->last_used = atlas_clock;
+            return atlas;
+        }
+        if (victim->font != NULL &&
+            (atlas->font == NULL || atlas->last_used < victim->last_used)) {
+            victim = atlas;
+        }
+    }
+
+    if (victim->font != NULL) {
+        ESP_LOGD(TAG, "Evicting glyph atlas (scale %d, rotate %d)", victim->scale, victim->rotate);
+        atlas_release(victim);
+    }
+
+    victim->font = Font;
+    victim->scale = scale;
+    victim->rotate = rotate;
+    if (rotate == ROTATE_90 || rotate == ROTATE_270) {
+        victim->cell_width = Font->Height * scale;
+        victim->cell_height = Font->Width * scale;
+    } else {
+        victim->cell_width = Font->Width * scale;
+        victim->cell_height = Font->Height * scale;
+    }
+    victim->last_used = atlas_clock;
+    return victim;
+}
+
+static UWORD atlas_stride(const GLYPH_ATLAS *atlas, int phase)
+{
+    return (atlas->cell_width + phase + 1) / 2;
+}
+
+// Rasterise one glyph into panel memory order, scaled and rotated
+static UBYTE *atlas_glyph(GLYPH_ATLAS *atlas, int index, int phase)
+{
+    if (atlas->glyphs[phase][index]) {
+        return atlas->glyphs[phase][index];
+    }
+
+    const sFONT *font = atlas->font;
+    UWORD stride = atlas_stride(atlas, phase);
+    size_t size = (size_t) stride * atlas->cell_height;
+
+    UBYTE *cell = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!cell) {
+        cell = heap_caps_calloc(1, size, MALLOC_CAP_8BIT);
+    }
+    if (!cell) {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes for glyph atlas", (unsigned) size);
+        return NULL;
+    }
+
+    UWORD glyph_width = font->Width * atlas->scale;
+    UWORD glyph_height = font->Height * atlas->scale;
+    UWORD row_bytes = (font->Width + 7) / 8;
+    const uint8_t *bits = &font->table[index * font->Height * row_bytes];
+
+    for (UWORD fy = 0; fy < font->Height; fy++) {
+        for (UWORD fx = 0; fx < font->Width; fx++) {
+            if (!(bits[fy * row_bytes + fx / 8] & (0x80 >> (fx % 8)))) {
+                continue;
+            }
+            for (UWORD sy = 0; sy < atlas->scale; sy++) {
+                for (UWORD sx = 0; sx < atlas->scale; sx++) {
+                    UWORD gx = fx * atlas->scale + sx;
+                    UWORD gy = fy * atlas->scale + sy;
+                    UWORD mx, my;
+                    switch (atlas->rotate) {
+                    case ROTATE_90:
+                        mx = glyph_height - gy - 1;
+                        my = gx;
+                        break;
+                    case ROTATE_180:
+                        mx = glyph_width - gx - 1;
+                        my = glyph_height - gy - 1;
+                        break;
+                    case ROTATE_270:
+                        mx = gy;
+                        my = glyph_width - gx - 1;
+                        break;
+                    default:
+                        mx = gx;
+                        my = gy;
+                        break;
+                    }
+                    mx += phase;
+                    cell[my * stride + mx / 2] |= (mx % 2) ? 0x0F : 0xF0;
+                }
+            }
+        }
+    }
+
+    atlas->glyphs[phase][index] = cell;
+    return cell;
+}
+
+// Map a logical rectangle to the top-left corner of the same rectangle in panel memory
+static void logical_to_memory(int x, int y, int w, int h, int *mx, int *my)
+{
+    switch (Paint.Rotate) {
+    case ROTATE_90:
+        *mx = Paint.WidthMemory - y - h;
+        *my = x;
+        break;
+    case ROTATE_180:
+        *mx = Paint.WidthMemory - x - w;
+        *my = Paint.HeightMemory - y - h;
+        break;
+    case ROTATE_270:
+        *mx = y;
+        *my = Paint.HeightMemory - x - w;
+        break;
+    default:
+        *mx = x;
+        *my = y;
+        break;
+    }
+}
+
+static void blit_cell(const UBYTE *cell, UWORD stride, UWORD rows, int byte_x, int mem_y,
+                      UBYTE color_pair)
+{
+    int b_start = byte_x < 0 ? -byte_x : 0;
+    int b_end = stride;
+    if (byte_x + b_end > Paint.WidthByte) {
+        b_end = Paint.WidthByte - byte_x;
+    }
+
+    for (int r = 0; r < rows; r++) {
+        int y = mem_y + r;
+        if (y < 0 || y >= Paint.HeightMemory) {
+            continue;
+        }
+        UBYTE *dst = Paint.Image + (UDOUBLE) y * Paint.WidthByte;
+        const UBYTE *src = cell + r * stride;
+        for (int b = b_start; b < b_end; b++) {
+            UBYTE mask = src[b];
+            if (mask) {
+                int x = byte_x + b;
+                dst[x] = (dst[x] & ~mask) | (color_pair & mask);
+            }
+        }
+    }
+}
+
+static void fill_memory_rect(int mx, int my, int mw, int mh, UBYTE color)
+{
+    int x0 = mx < 0 ? 0 : mx;
+    int y0 = my < 0 ? 0 : my;
+    int x1 = mx + mw > Paint.WidthMemory ? Paint.WidthMemory : mx + mw;
+    int y1 = my + mh > Paint.HeightMemory ? Paint.HeightMemory : my + mh;
+    UBYTE pair = (color << 4) | color;
+
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    for (int y = y0; y < y1; y++) {
+        UBYTE *row = Paint.Image + (UDOUBLE) y * Paint.WidthByte;
+        int x = x0;
+        if (x % 2) {
+            row[x / 2] = (row[x / 2] & 0xF0) | color;
+            x++;
+        }
+        int full = (x1 - x) / 2;
+        memset(&row[x / 2], pair, full);
+        x += full * 2;
+        if (x < x1) {
+            row[x / 2] = (row[x / 2] & 0x0F) | (color << 4);
+        }
+    }
+}
+
+int GUI_TextRunWidth(const char *text, sFONT *Font, UBYTE scale)
+{
+    if (!text || !Font) {
+        return 0;
+    }
+    return (int) strlen(text) * Font->Width * scale;
+}
+
+UBYTE GUI_DrawTextRun(int Xstart, int Ystart, const char *text, sFONT *Font, UBYTE scale,
+                      UBYTE Color_Foreground, UBYTE Color_Background, UBYTE padding)
+{
+    if (!text || !Font || !Paint.Image) {
+        ESP_LOGE(TAG, "Invalid text run");
+        return 1;
+    }
+    if (!(Paint.Scale == 6 || Paint.Scale == 7 || Paint.Scale == 16) ||
+        Paint.Mirror != MIRROR_NONE) {
+        ESP_LOGE(TAG, "Text runs need a 4bpp, unmirrored image");
+        return 1;
+    }
+    if (scale < 1) {
+        scale = 1;
+    } else if (scale > ATLAS_MAX_SCALE) {
+        scale = ATLAS_MAX_SCALE;
+    }
+
+    GLYPH_ATLAS *atlas = atlas_get(Font, scale, Paint.Rotate);
+    int glyph_width = Font->Width * scale;
+    int glyph_height = Font->Height * scale;
+    int mx, my;
+
+    if (Color_Background != OVERLAY_TRANSPARENT) {
+        int box_width = GUI_TextRunWidth(text, Font, scale) + 2 * padding;
+        int box_height = glyph_height + 2 * padding;
+        logical_to_memory(Xstart - padding, Ystart - padding, box_width, box_height, &mx, &my);
+        if (Paint.Rotate == ROTATE_90 || Paint.Rotate == ROTATE_270) {
+            fill_memory_rect(mx, my, box_height, box_width, Color_Background & 0x0F);
+        } else {
+            fill_memory_rect(mx, my, box_width, box_height, Color_Background & 0x0F);
+        }
+    }
+
+    UBYTE color_pair = ((Color_Foreground & 0x0F) << 4) | (Color_Foreground & 0x0F);
+
+    for (int i = 0; text[i] != '\0'; i++) {
+        char c = text[i];
+        if (c == ' ') {
+            continue;
+        }
+        if (c < ATLAS_FIRST_CHAR || c > ATLAS_LAST_CHAR) {
+            c = '?';
+        }
+
+        logical_to_memory(Xstart + i * glyph_width, Ystart, glyph_width, glyph_height, &mx, &my);
+        int phase = ((mx % 2) + 2) % 2;
+        const UBYTE *cell = atlas_glyph(atlas, c - ATLAS_FIRST_CHAR, phase);
+        if (!cell) {
+            return 1;
+        }
+        blit_cell(cell, atlas_stride(atlas, phase), atlas->cell_height, (mx - phase) / 2, my,
+                  color_pair);
+    }
+
+    return 0;
+}
+
+void GUI_TextAtlas_Flush(void)
+{
+    for (int i = 0; i < ATLAS_CACHE_SIZE; i++) {
+        if (atlases[i].font != NULL) {
+            atlas_release(&atlases[i]);
+        }
+    }
+    atlas_clock = 0;
+}
@@ -0,0 +1,49 @@
+// filename: GUI_TextOverlay.h
+#ifndef __GUI_TEXTOVERLAY_H
+#define __GUI_TEXTOVERLAY_H
+
+#include <stdint.h>
+
+#include "GUI_Paint.h"
+#include "fonts.h"
+
+// Background value meaning "leave the photo visible behind the glyphs"
+#define OVERLAY_TRANSPARENT 0xFF
+
+/**
+ * @brief Draw a run of ASCII text into the selected 4bpp image using a glyph atlas
+ *
+ * Glyphs are rasterised once per (font, scale, rotation) into a packed-nibble
+ * atlas laid out in panel memory order, so drawing a run is a masked byte copy
+ * per glyph row instead of a Paint_SetPixel call per font bit. Atlas entries are
+ * built lazily the first time a character is used and kept until
+ * GUI_TextAtlas_Flush() is called.
+ *
+ * Coordinates are in the rotated (logical) coordinate space, like the rest of the
+ * Paint_* API. Text that falls outside the image is clipped. Only the 4bpp
+ * scales (6/7/16) without mirroring are supported.
+ *
+ * @param Xstart Left edge of the run
+ * @param Ystart Top edge of the run
+ * @param text ASCII text; characters outside ' '..'~' are drawn as '?'
+ * @param Font Bitmap font (e.g. &Font24)
+ * @param scale Integer magnification (1-8)
+ * @param Color_Foreground Glyph colour index
+ * @param Color_Background Box colour index, or OVERLAY_TRANSPARENT
+ * @param padding Box padding in logical pixels (ignored when transparent)
+ * @return 0 on success, 1 on error
+ */
+UBYTE GUI_DrawTextRun(int Xstart, int Ystart, const char *text, sFONT *Font, UBYTE scale,
+                      UBYTE Color_Foreground, UBYTE Color_Background, UBYTE padding);
+
+/**
+ * @brief Width in logical pixels of a text run drawn with GUI_DrawTextRun()
+ */
+int GUI_TextRunWidth(const char *text, sFONT *Font, UBYTE scale);
+
+/**
+ * @brief Release every cached glyph atlas
+ */
+void GUI_TextAtlas_Flush(void);
+
+#endif
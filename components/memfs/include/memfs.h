@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "esp_err.h"
 
@@ -8,11 +9,26 @@
 extern "C" {
 #endif
 
+/**
+ * @brief fcntl() command that reserves room for a file without changing its size
+ *
+ * Call fcntl(fd, MEMFS_F_PREALLOCATE, expected_size) when the final size is known up front
+ * (e.g. from Content-Length) so the file is allocated once instead of growing while it is
+ * written. The fd must be open for writing (EBADF otherwise). Other filesystems reject the
+ * command with EINVAL, so it is safe to issue on any fd. ftruncate() is supported as well, but
+ * it also sets the file size.
+ */
+#define MEMFS_F_PREALLOCATE 0x4d46
+
 /**
  * @brief Initialize and mount a RAM-based virtual filesystem
  *
+ * Names are looked up through a hash index. Directories are supported through
+ * mkdir/rmdir and opendir/readdir, so code written for the SD card or LittleFS
+ * also works on memfs.
+ *
  * @param base_path The mount point (e.g., "/storage")
- * @param max_files Maximum number of files to support
+ * @param max_files Maximum number of entries (files and directories) to support
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t memfs_mount(const char *base_path, size_t max_files);
@@ -32,6 +48,29 @@ esp_err_t memfs_unmount(const char *base_path);
  */
 size_t memfs_get_total_used(void);
 
+/**
+ * @brief Borrow a read-only pointer to a file's contents without copying them
+ *
+ * While mapped, the file cannot be opened for writing, written, truncated, preallocated,
+ * unlinked or replaced by a rename (EBUSY); renaming the file itself is fine. Release it with
+ * memfs_unmap().
+ *
+ * @param path Full VFS path, including the mount point
+ * @param data Receives a pointer to the file contents
+ * @param size Receives the file size
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the path is not a memfs file,
+ *         ESP_ERR_INVALID_SIZE if it is empty, ESP_ERR_INVALID_STATE if it is open for writing
+ */
+esp_err_t memfs_map(const char *path, const uint8_t **data, size_t *size);
+
+/**
+ * @brief Release a pointer obtained from memfs_map()
+ *
+ * @param data The pointer returned by memfs_map()
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t memfs_unmap(const uint8_t *data);
+
 #ifdef __cplusplus
 }
 #endif
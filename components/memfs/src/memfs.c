@@ -1,22 +1,35 @@
 #include "memfs.h"
 
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/errno.h>
 #include <sys/fcntl.h>
 #include <sys/stat.h>
 #include <sys/unistd.h>
+#include <time.h>
 
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "memfs";
 
+#define MEMFS_BLOCK_SIZE 4096
+#define MEMFS_ROUND_UP(n) (((n) + MEMFS_BLOCK_SIZE - 1) & ~(size_t) (MEMFS_BLOCK_SIZE - 1))
+
 typedef struct {
-    char *name;
+    char *name;  // path below the mount point, without a leading slash
     uint8_t *data;
     size_t size;
     size_t capacity;
+    int map_count;  // outstanding memfs_map() borrows; the data must not move meanwhile
+    bool is_dir;
+    time_t mtime;
 } mem_file_t;
 
 typedef struct {
@@ -25,12 +38,243 @@ typedef struct {
     int flags;
 } mem_fd_t;
 
+typedef struct {
+    DIR dir;       // must come first: the VFS layer fills in dd_vfs_idx
+    char *prefix;  // directory name plus '/', or "" for the root
+    size_t prefix_len;
+    long position;  // next slot in files[] to examine
+    struct dirent entry;
+} mem_dir_t;
+
 static mem_file_t **files = NULL;
 static size_t max_files_count = 0;
 static mem_fd_t *fds = NULL;
 static size_t max_fds_count = 0;
+static char mount_path[ESP_VFS_PATH_MAX + 1];
+static SemaphoreHandle_t memfs_mutex = NULL;
 
-static int memfs_open_vfs(void *ctx, const char *path, int flags, int mode)
+static void memfs_lock(void)
+{
+    xSemaphoreTake(memfs_mutex, portMAX_DELAY);
+}
+
+static void memfs_unlock(void)
+{
+    xSemaphoreGive(memfs_mutex);
+}
+
+// Open-addressing hash index from name to slot in files[]. The table is a power of two at
+// least twice max_files so probe runs stay short; removed names leave a tombstone so later
+// entries in the same run are still found, and the table is rebuilt once those pile up.
+#define INDEX_EMPTY -1
+#define INDEX_DELETED -2
+
+static int32_t *name_index = NULL;
+static size_t name_index_mask = 0;
+static size_t name_index_tombstones = 0;
+
+// FNV-1a
+static uint32_t name_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Position of `name` in name_index, or -1 if it is not there
+static long index_find(const char *name)
+{
+    size_t pos = name_hash(name) & name_index_mask;
+    for (size_t probe = 0; probe <= name_index_mask; probe++) {
+        int32_t slot = name_index[pos];
+        if (slot == INDEX_EMPTY) {
+            return -1;
+        }
+        if (slot >= 0 && strcmp(files[slot]->name, name) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & name_index_mask;
+    }
+    return -1;
+}
+
+static void index_insert(int slot)
+{
+    size_t pos = name_hash(files[slot]->name) & name_index_mask;
+    while (name_index[pos] >= 0) {
+        pos = (pos + 1) & name_index_mask;
+    }
+    if (name_index[pos] == INDEX_DELETED) {
+        name_index_tombstones--;
+    }
+    name_index[pos] = slot;
+}
+
+static void index_rebuild(void)
+{
+    for (size_t i = 0; i <= name_index_mask; i++) {
+        name_index[i] = INDEX_EMPTY;
+    }
+    name_index_tombstones = 0;
+    for (int i = 0; i < max_files_count; i++) {
+        if (files[i]) {
+            index_insert(i);
+        }
+    }
+}
+
+static void index_remove(const char *name)
+{
+    long pos = index_find(name);
+    if (pos < 0) {
+        return;
+    }
+    name_index[pos] = INDEX_DELETED;
+    name_index_tombstones++;
+}
+
+// Rebuild once tombstones pile up. Only called once files[] matches the index again, since the
+// rebuild indexes whatever files[] holds.
+static void index_compact(void)
+{
+    if (name_index_tombstones > (name_index_mask + 1) / 4) {
+        index_rebuild();
+    }
+}
+
+static int lookup_slot(const char *name)
+{
+    long pos = index_find(name);
+    return pos < 0 ? -1 : name_index[pos];
+}
+
+static mem_file_t *lookup(const char *name)
+{
+    int slot = lookup_slot(name);
+    return slot < 0 ? NULL : files[slot];
+}
+
+static bool file_is_open(const mem_file_t *file)
+{
+    for (int j = 0; j < max_fds_count; j++) {
+        if (fds[j].file == file) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Creating, removing or renaming an entry changes its directory, like on a real filesystem
+static void touch_parent(const char *name)
+{
+    const char *slash = strrchr(name, '/');
+    if (!slash) {
+        return;
+    }
+
+    char parent[256];
+    size_t len = slash - name;
+    if (len >= sizeof(parent)) {
+        return;
+    }
+    memcpy(parent, name, len);
+    parent[len] = '\0';
+
+    mem_file_t *dir = lookup(parent);
+    if (dir) {
+        dir->mtime = time(NULL);
+    }
+}
+
+// Does any entry live below `name`? Used for directories that were never mkdir'ed explicitly
+// and for rmdir, so a linear scan is fine here.
+static bool has_children(const char *name)
+{
+    size_t len = strlen(name);
+    for (int i = 0; i < max_files_count; i++) {
+        if (files[i] && strncmp(files[i]->name, name, len) == 0 && files[i]->name[len] == '/') {
+            return true;
+        }
+    }
+    return false;
+}
+
+static mem_file_t *create_entry(const char *name, bool is_dir)
+{
+    int slot = -1;
+    for (int i = 0; i < max_files_count; i++) {
+        if (files[i] == NULL) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == -1) {
+        errno = ENOSPC;
+        return NULL;
+    }
+
+    mem_file_t *file = (mem_file_t *) calloc(1, sizeof(mem_file_t));
+    if (!file || !(file->name = strdup(name))) {
+        free(file);
+        errno = ENOMEM;
+        return NULL;
+    }
+    file->is_dir = is_dir;
+    file->mtime = time(NULL);
+
+    files[slot] = file;
+    index_insert(slot);
+    touch_parent(name);
+    return file;
+}
+
+static void destroy_entry(int slot)
+{
+    mem_file_t *file = files[slot];
+    index_remove(file->name);
+    touch_parent(file->name);
+    files[slot] = NULL;
+    index_compact();
+
+    free(file->name);
+    if (file->data)
+        heap_caps_free(file->data);
+    free(file);
+}
+
+static int rename_entry(int slot, char *new_name)
+{
+    mem_file_t *file = files[slot];
+    index_remove(file->name);
+    touch_parent(file->name);
+    free(file->name);
+    file->name = new_name;
+    index_insert(slot);
+    index_compact();
+    touch_parent(new_name);
+    return 0;
+}
+
+static void fill_stat(const mem_file_t *file, struct stat *st)
+{
+    memset(st, 0, sizeof(*st));
+    if (file && file->is_dir) {
+        st->st_mode = S_IFDIR | 0777;
+    } else if (file) {
+        st->st_size = file->size;
+        st->st_mode = S_IFREG | 0666;
+    } else {
+        st->st_mode = S_IFDIR | 0777;  // root or implicit directory
+    }
+    if (file) {
+        st->st_mtime = file->mtime;
+    }
+}
+
+static int do_open(void *ctx, const char *path, int flags, int mode)
 {
     // Skip leading slash
     if (path[0] == '/')
@@ -49,21 +293,24 @@ static int memfs_open_vfs(void *ctx, const char *path, int flags, int mode)
         return -1;
     }
 
-    mem_file_t *file = NULL;
-    for (int i = 0; i < max_files_count; i++) {
-        if (files[i] && strcmp(files[i]->name, path) == 0) {
-            file = files[i];
-            break;
-        }
-    }
+    mem_file_t *file = lookup(path);
 
     if (file) {
         if ((flags & O_CREAT) && (flags & O_EXCL)) {
             errno = EEXIST;
             return -1;
         }
+        if (file->is_dir) {
+            errno = EISDIR;
+            return -1;
+        }
+        if (file->map_count > 0 && ((flags & O_ACCMODE) != O_RDONLY || (flags & O_TRUNC))) {
+            errno = EBUSY;
+            return -1;
+        }
         if (flags & O_TRUNC) {
             file->size = 0;
+            file->mtime = time(NULL);
         }
     } else {
         if (!(flags & O_CREAT)) {
@@ -71,26 +318,10 @@ static int memfs_open_vfs(void *ctx, const char *path, int flags, int mode)
             return -1;
         }
 
-        int file_idx = -1;
-        for (int i = 0; i < max_files_count; i++) {
-            if (files[i] == NULL) {
-                file_idx = i;
-                break;
-            }
-        }
-
-        if (file_idx == -1) {
-            errno = ENOSPC;
-            return -1;
-        }
-
-        file = (mem_file_t *) calloc(1, sizeof(mem_file_t));
+        file = create_entry(path, false);
         if (!file) {
-            errno = ENOMEM;
             return -1;
         }
-        file->name = strdup(path);
-        files[file_idx] = file;
     }
 
     fds[fd].file = file;
@@ -100,28 +331,73 @@ static int memfs_open_vfs(void *ctx, const char *path, int flags, int mode)
     return fd;
 }
 
-static ssize_t memfs_write_vfs(void *ctx, int fd, const void *data, size_t size)
+// Make room for at least `needed` bytes. Writes grow the buffer by 1.5x so that a file written
+// in small pieces is copied O(log n) times rather than once per block; preallocation asks for
+// the exact size instead.
+static int file_reserve(mem_file_t *file, size_t needed, bool exact)
 {
-    if (fd < 0 || fd >= max_fds_count || fds[fd].file == NULL) {
+    if (needed <= file->capacity) {
+        return 0;
+    }
+
+    size_t min_capacity = MEMFS_ROUND_UP(needed);
+    size_t new_capacity = min_capacity;
+    if (!exact && file->capacity + file->capacity / 2 > new_capacity) {
+        new_capacity = MEMFS_ROUND_UP(file->capacity + file->capacity / 2);
+    }
+
+    uint8_t *new_data = heap_caps_realloc(file->data, new_capacity, MALLOC_CAP_SPIRAM);
+    if (!new_data && new_capacity > min_capacity) {
+        // PSRAM is getting tight, settle for what this write needs
+        new_capacity = min_capacity;
+        new_data = heap_caps_realloc(file->data, new_capacity, MALLOC_CAP_SPIRAM);
+    }
+    if (!new_data) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    file->data = new_data;
+    file->capacity = new_capacity;
+    return 0;
+}
+
+// Writing, truncating and preallocating need a descriptor opened for writing, and must not
+// touch a file while memfs_map() has handed its buffer out
+static mem_file_t *writable_file(int fd)
+{
+    if (fd < 0 || fd >= max_fds_count || fds[fd].file == NULL ||
+        (fds[fd].flags & O_ACCMODE) == O_RDONLY) {
         errno = EBADF;
+        return NULL;
+    }
+    if (fds[fd].file->map_count > 0) {
+        errno = EBUSY;
+        return NULL;
+    }
+    return fds[fd].file;
+}
+
+static ssize_t do_write(void *ctx, int fd, const void *data, size_t size)
+{
+    mem_file_t *file = writable_file(fd);
+    if (!file) {
         return -1;
     }
 
-    mem_file_t *file = fds[fd].file;
     size_t offset = fds[fd].offset;
 
-    if (offset + size > file->capacity) {
-        size_t new_capacity = (offset + size + 4095) & ~4095;
-        uint8_t *new_data = heap_caps_realloc(file->data, new_capacity, MALLOC_CAP_SPIRAM);
-        if (!new_data) {
-            errno = ENOMEM;
-            return -1;
-        }
-        file->data = new_data;
-        file->capacity = new_capacity;
+    if (file_reserve(file, offset + size, false) != 0) {
+        return -1;
+    }
+
+    // Writing past the end after a seek leaves a hole that reads back as zeros
+    if (offset > file->size) {
+        memset(file->data + file->size, 0, offset - file->size);
     }
 
     memcpy(file->data + offset, data, size);
+    file->mtime = time(NULL);
     fds[fd].offset += size;
     if (fds[fd].offset > file->size) {
         file->size = fds[fd].offset;
@@ -130,7 +406,7 @@ static ssize_t memfs_write_vfs(void *ctx, int fd, const void *data, size_t size)
     return size;
 }
 
-static ssize_t memfs_read_vfs(void *ctx, int fd, void *dst, size_t size)
+static ssize_t do_read(void *ctx, int fd, void *dst, size_t size)
 {
     if (fd < 0 || fd >= max_fds_count || fds[fd].file == NULL) {
         errno = EBADF;
@@ -153,7 +429,7 @@ static ssize_t memfs_read_vfs(void *ctx, int fd, void *dst, size_t size)
     return to_read;
 }
 
-static off_t memfs_lseek_vfs(void *ctx, int fd, off_t offset, int mode)
+static off_t do_lseek(void *ctx, int fd, off_t offset, int mode)
 {
     if (fd < 0 || fd >= max_fds_count || fds[fd].file == NULL) {
         errno = EBADF;
@@ -182,7 +458,7 @@ static off_t memfs_lseek_vfs(void *ctx, int fd, off_t offset, int mode)
     return new_offset;
 }
 
-static int memfs_close_vfs(void *ctx, int fd)
+static int do_close(void *ctx, int fd)
 {
     if (fd < 0 || fd >= max_fds_count || fds[fd].file == NULL) {
         errno = EBADF;
@@ -193,124 +469,511 @@ static int memfs_close_vfs(void *ctx, int fd)
     return 0;
 }
 
-static int memfs_fstat_vfs(void *ctx, int fd, struct stat *st)
+static int do_ftruncate(void *ctx, int fd, off_t length)
+{
+    mem_file_t *file = writable_file(fd);
+    if (!file) {
+        return -1;
+    }
+    if (length < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (file_reserve(file, length, true) != 0) {
+        return -1;
+    }
+    if ((size_t) length > file->size) {
+        memset(file->data + file->size, 0, length - file->size);
+    }
+    file->size = length;
+    file->mtime = time(NULL);
+    return 0;
+}
+
+static int do_fcntl(void *ctx, int fd, int cmd, int arg)
 {
     if (fd < 0 || fd >= max_fds_count || fds[fd].file == NULL) {
         errno = EBADF;
         return -1;
     }
 
-    mem_file_t *file = fds[fd].file;
-    memset(st, 0, sizeof(*st));
-    st->st_size = file->size;
-    st->st_mode = S_IFREG | 0666;
+    switch (cmd) {
+    case F_GETFL:
+        return fds[fd].flags;
+    case MEMFS_F_PREALLOCATE: {
+        mem_file_t *file = writable_file(fd);
+        if (!file) {
+            return -1;
+        }
+        if (arg < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        return file_reserve(file, arg, true);
+    }
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+static int do_fstat(void *ctx, int fd, struct stat *st)
+{
+    if (fd < 0 || fd >= max_fds_count || fds[fd].file == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+
+    fill_stat(fds[fd].file, st);
     return 0;
 }
 
-static int memfs_stat_vfs(void *ctx, const char *path, struct stat *st)
+static int do_stat(void *ctx, const char *path, struct stat *st)
 {
     if (path[0] == '/')
         path++;
 
-    for (int i = 0; i < max_files_count; i++) {
-        if (files[i] && strcmp(files[i]->name, path) == 0) {
-            memset(st, 0, sizeof(*st));
-            st->st_size = files[i]->size;
-            st->st_mode = S_IFREG | 0666;
-            return 0;
-        }
+    mem_file_t *file = lookup(path);
+    if (file || path[0] == '\0' || has_children(path)) {
+        fill_stat(file, st);
+        return 0;
     }
 
     errno = ENOENT;
     return -1;
 }
-static int memfs_unlink_vfs(void *ctx, const char *path)
+
+static int do_unlink(void *ctx, const char *path)
 {
     if (path[0] == '/')
         path++;
 
-    for (int i = 0; i < max_files_count; i++) {
-        if (files[i] && strcmp(files[i]->name, path) == 0) {
-            // Check if any FD is open for this file
-            for (int j = 0; j < max_fds_count; j++) {
-                if (fds[j].file == files[i]) {
-                    errno = EBUSY;
-                    return -1;
-                }
-            }
+    int slot = lookup_slot(path);
+    if (slot < 0) {
+        errno = ENOENT;
+        return -1;
+    }
 
-            free(files[i]->name);
-            if (files[i]->data)
-                heap_caps_free(files[i]->data);
-            free(files[i]);
-            files[i] = NULL;
-            return 0;
-        }
+    mem_file_t *file = files[slot];
+    if (file->is_dir) {
+        errno = EISDIR;
+        return -1;
+    }
+    if (file->map_count > 0 || file_is_open(file)) {
+        errno = EBUSY;
+        return -1;
     }
 
-    errno = ENOENT;
-    return -1;
+    destroy_entry(slot);
+    return 0;
 }
 
-static int memfs_rename_vfs(void *ctx, const char *src, const char *dst)
+static int do_rename(void *ctx, const char *src, const char *dst)
 {
     if (src[0] == '/')
         src++;
     if (dst[0] == '/')
         dst++;
 
-    mem_file_t *src_file = NULL;
-    for (int i = 0; i < max_files_count; i++) {
-        if (files[i] && strcmp(files[i]->name, src) == 0) {
-            src_file = files[i];
-            break;
-        }
-    }
-
-    if (!src_file) {
+    int src_slot = lookup_slot(src);
+    if (src_slot < 0) {
         errno = ENOENT;
         return -1;
     }
+    mem_file_t *src_file = files[src_slot];
+
+    if (strcmp(src, dst) == 0) {
+        return 0;
+    }
 
     // Check if src is open
-    for (int j = 0; j < max_fds_count; j++) {
-        if (fds[j].file == src_file) {
+    if (file_is_open(src_file)) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    // If destination exists, replace it (files only, and never while it is in use)
+    int dst_slot = lookup_slot(dst);
+    if (dst_slot >= 0) {
+        mem_file_t *dst_file = files[dst_slot];
+        if (dst_file->is_dir || src_file->is_dir) {
+            errno = dst_file->is_dir ? EISDIR : ENOTDIR;
+            return -1;
+        }
+        if (dst_file->map_count > 0 || file_is_open(dst_file)) {
             errno = EBUSY;
             return -1;
         }
+    } else if (has_children(dst)) {
+        // An implicit directory: moving anything onto it would shadow or duplicate its entries
+        errno = src_file->is_dir ? ENOTEMPTY : EISDIR;
+        return -1;
     }
 
-    // If destination exists, unlink it
-    for (int i = 0; i < max_files_count; i++) {
-        if (files[i] && strcmp(files[i]->name, dst) == 0) {
-            // Check if dst is open
-            for (int j = 0; j < max_fds_count; j++) {
-                if (fds[j].file == files[i]) {
+    size_t src_len = strlen(src);
+    size_t dst_len = strlen(dst);
+
+    if (src_file->is_dir && strncmp(dst, src, src_len) == 0 && dst[src_len] == '/') {
+        errno = EINVAL;  // into itself
+        return -1;
+    }
+
+    // Every child must be free to move and get its new name before anything is renamed, so a
+    // failure leaves the tree as it was
+    size_t child_count = 0;
+    if (src_file->is_dir) {
+        for (int i = 0; i < max_files_count; i++) {
+            if (files[i] && strncmp(files[i]->name, src, src_len) == 0 &&
+                files[i]->name[src_len] == '/') {
+                if (file_is_open(files[i])) {
                     errno = EBUSY;
                     return -1;
                 }
+                child_count++;
             }
-            free(files[i]->name);
-            if (files[i]->data)
-                heap_caps_free(files[i]->data);
-            free(files[i]);
-            files[i] = NULL;
-            break;
         }
     }
 
+    char **child_names = NULL;
     char *new_name = strdup(dst);
-    if (!new_name) {
+    bool ok = new_name != NULL;
+    if (ok && child_count > 0) {
+        child_names = calloc(child_count, sizeof(char *));
+        ok = child_names != NULL;
+        size_t n = 0;
+        for (int i = 0; ok && i < max_files_count; i++) {
+            if (files[i] && strncmp(files[i]->name, src, src_len) == 0 &&
+                files[i]->name[src_len] == '/') {
+                const char *rest = files[i]->name + src_len;
+                char *child_name = malloc(dst_len + strlen(rest) + 1);
+                if (!child_name) {
+                    ok = false;
+                    break;
+                }
+                memcpy(child_name, dst, dst_len);
+                strcpy(child_name + dst_len, rest);
+                child_names[n++] = child_name;
+            }
+        }
+    }
+    if (!ok) {
+        if (child_names) {
+            for (size_t n = 0; n < child_count; n++) {
+                free(child_names[n]);
+            }
+            free(child_names);
+        }
+        free(new_name);
         errno = ENOMEM;
         return -1;
     }
 
-    free(src_file->name);
-    src_file->name = new_name;
+    if (dst_slot >= 0) {
+        destroy_entry(dst_slot);
+    }
+
+    size_t n = 0;
+    for (int i = 0; n < child_count && i < max_files_count; i++) {
+        if (files[i] && strncmp(files[i]->name, src, src_len) == 0 &&
+            files[i]->name[src_len] == '/') {
+            rename_entry(i, child_names[n++]);
+        }
+    }
+    free(child_names);
+
+    return rename_entry(src_slot, new_name);
+}
+
+static int do_mkdir(void *ctx, const char *path, mode_t mode)
+{
+    if (path[0] == '/')
+        path++;
+
+    if (path[0] == '\0' || lookup(path)) {
+        errno = EEXIST;
+        return -1;
+    }
+
+    return create_entry(path, true) ? 0 : -1;
+}
+
+static int do_rmdir(void *ctx, const char *path)
+{
+    if (path[0] == '/')
+        path++;
+
+    int slot = lookup_slot(path);
+    if (slot < 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    if (!files[slot]->is_dir) {
+        errno = ENOTDIR;
+        return -1;
+    }
+    if (has_children(path)) {
+        errno = ENOTEMPTY;
+        return -1;
+    }
+
+    destroy_entry(slot);
+    return 0;
+}
+
+static DIR *do_opendir(void *ctx, const char *name)
+{
+    if (name[0] == '/')
+        name++;
+
+    size_t len = strlen(name);
+    while (len > 0 && name[len - 1] == '/') {
+        len--;
+    }
+
+    if (len > 0) {
+        char dir_name[256];
+        if (len >= sizeof(dir_name)) {
+            errno = ENAMETOOLONG;
+            return NULL;
+        }
+        memcpy(dir_name, name, len);
+        dir_name[len] = '\0';
+
+        mem_file_t *file = lookup(dir_name);
+        if (file && !file->is_dir) {
+            errno = ENOTDIR;
+            return NULL;
+        }
+        if (!file && !has_children(dir_name)) {
+            errno = ENOENT;
+            return NULL;
+        }
+    }
+
+    mem_dir_t *dir = calloc(1, sizeof(mem_dir_t));
+    if (!dir || !(dir->prefix = malloc(len + 2))) {
+        free(dir);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(dir->prefix, name, len);
+    if (len > 0) {
+        dir->prefix[len++] = '/';
+    }
+    dir->prefix[len] = '\0';
+    dir->prefix_len = len;
+
+    return (DIR *) dir;
+}
+
+static struct dirent *do_readdir(void *ctx, DIR *pdir)
+{
+    mem_dir_t *dir = (mem_dir_t *) pdir;
+
+    for (; dir->position < (long) max_files_count; dir->position++) {
+        mem_file_t *file = files[dir->position];
+        if (!file || strncmp(file->name, dir->prefix, dir->prefix_len) != 0) {
+            continue;
+        }
+        const char *child = file->name + dir->prefix_len;
+        if (child[0] == '\0' || strchr(child, '/')) {
+            continue;  // deeper entries show up when their own directory is listed
+        }
+
+        dir->entry.d_ino = dir->position + 1;
+        dir->entry.d_type = file->is_dir ? DT_DIR : DT_REG;
+        snprintf(dir->entry.d_name, sizeof(dir->entry.d_name), "%s", child);
+        dir->position++;
+        return &dir->entry;
+    }
+
+    return NULL;
+}
+
+static int do_readdir_r(void *ctx, DIR *pdir, struct dirent *entry, struct dirent **out)
+{
+    struct dirent *next = do_readdir(ctx, pdir);
+    if (next) {
+        *entry = *next;
+        *out = entry;
+    } else {
+        *out = NULL;
+    }
+    return 0;
+}
+
+static long do_telldir(void *ctx, DIR *pdir)
+{
+    return ((mem_dir_t *) pdir)->position;
+}
 
+static void do_seekdir(void *ctx, DIR *pdir, long offset)
+{
+    ((mem_dir_t *) pdir)->position = offset < 0 ? 0 : offset;
+}
+
+static int do_closedir(void *ctx, DIR *pdir)
+{
+    mem_dir_t *dir = (mem_dir_t *) pdir;
+    free(dir->prefix);
+    free(dir);
     return 0;
 }
 
+// Entry points for the VFS layer. Tasks share the filesystem (e.g. a thumbnail is written while
+// the main image is decoded from memfs), so each operation runs under memfs_mutex.
+static int memfs_open_vfs(void *ctx, const char *path, int flags, int mode)
+{
+    memfs_lock();
+    int ret = do_open(ctx, path, flags, mode);
+    memfs_unlock();
+    return ret;
+}
+
+static ssize_t memfs_write_vfs(void *ctx, int fd, const void *data, size_t size)
+{
+    memfs_lock();
+    ssize_t ret = do_write(ctx, fd, data, size);
+    memfs_unlock();
+    return ret;
+}
+
+static ssize_t memfs_read_vfs(void *ctx, int fd, void *dst, size_t size)
+{
+    memfs_lock();
+    ssize_t ret = do_read(ctx, fd, dst, size);
+    memfs_unlock();
+    return ret;
+}
+
+static off_t memfs_lseek_vfs(void *ctx, int fd, off_t offset, int mode)
+{
+    memfs_lock();
+    off_t ret = do_lseek(ctx, fd, offset, mode);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_close_vfs(void *ctx, int fd)
+{
+    memfs_lock();
+    int ret = do_close(ctx, fd);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_ftruncate_vfs(void *ctx, int fd, off_t length)
+{
+    memfs_lock();
+    int ret = do_ftruncate(ctx, fd, length);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_fcntl_vfs(void *ctx, int fd, int cmd, int arg)
+{
+    memfs_lock();
+    int ret = do_fcntl(ctx, fd, cmd, arg);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_fstat_vfs(void *ctx, int fd, struct stat *st)
+{
+    memfs_lock();
+    int ret = do_fstat(ctx, fd, st);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_stat_vfs(void *ctx, const char *path, struct stat *st)
+{
+    memfs_lock();
+    int ret = do_stat(ctx, path, st);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_unlink_vfs(void *ctx, const char *path)
+{
+    memfs_lock();
+    int ret = do_unlink(ctx, path);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_rename_vfs(void *ctx, const char *src, const char *dst)
+{
+    memfs_lock();
+    int ret = do_rename(ctx, src, dst);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_mkdir_vfs(void *ctx, const char *path, mode_t mode)
+{
+    memfs_lock();
+    int ret = do_mkdir(ctx, path, mode);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_rmdir_vfs(void *ctx, const char *path)
+{
+    memfs_lock();
+    int ret = do_rmdir(ctx, path);
+    memfs_unlock();
+    return ret;
+}
+
+static DIR *memfs_opendir_vfs(void *ctx, const char *name)
+{
+    memfs_lock();
+    DIR *ret = do_opendir(ctx, name);
+    memfs_unlock();
+    return ret;
+}
+
+static struct dirent *memfs_readdir_vfs(void *ctx, DIR *pdir)
+{
+    memfs_lock();
+    struct dirent *ret = do_readdir(ctx, pdir);
+    memfs_unlock();
+    return ret;
+}
+
+static int memfs_readdir_r_vfs(void *ctx, DIR *pdir, struct dirent *entry, struct dirent **out)
+{
+    memfs_lock();
+    int ret = do_readdir_r(ctx, pdir, entry, out);
+    memfs_unlock();
+    return ret;
+}
+
+static long memfs_telldir_vfs(void *ctx, DIR *pdir)
+{
+    memfs_lock();
+    long ret = do_telldir(ctx, pdir);
+    memfs_unlock();
+    return ret;
+}
+
+static void memfs_seekdir_vfs(void *ctx, DIR *pdir, long offset)
+{
+    memfs_lock();
+    do_seekdir(ctx, pdir, offset);
+    memfs_unlock();
+}
+
+static int memfs_closedir_vfs(void *ctx, DIR *pdir)
+{
+    memfs_lock();
+    int ret = do_closedir(ctx, pdir);
+    memfs_unlock();
+    return ret;
+}
+
 esp_err_t memfs_mount(const char *base_path, size_t max_files)
 {
     if (files)
@@ -322,6 +985,29 @@ esp_err_t memfs_mount(const char *base_path, size_t max_files)
     max_fds_count = max_files * 2;
     fds = (mem_fd_t *) calloc(max_fds_count, sizeof(mem_fd_t));
 
+    size_t index_size = 16;
+    while (index_size < max_files * 2) {
+        index_size <<= 1;
+    }
+    name_index = (int32_t *) malloc(index_size * sizeof(int32_t));
+    name_index_mask = index_size - 1;
+    memfs_mutex = xSemaphoreCreateMutex();
+
+    if (!files || !fds || !name_index || !memfs_mutex) {
+        free(files);
+        free(fds);
+        free(name_index);
+        if (memfs_mutex) {
+            vSemaphoreDelete(memfs_mutex);
+        }
+        files = NULL;
+        fds = NULL;
+        name_index = NULL;
+        memfs_mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    index_rebuild();
+
     esp_vfs_t vfs = {
         .flags = ESP_VFS_FLAG_CONTEXT_PTR,
         .open_p = &memfs_open_vfs,
@@ -330,11 +1016,22 @@ esp_err_t memfs_mount(const char *base_path, size_t max_files)
         .lseek_p = &memfs_lseek_vfs,
         .close_p = &memfs_close_vfs,
         .fstat_p = &memfs_fstat_vfs,
+        .fcntl_p = &memfs_fcntl_vfs,
+        .ftruncate_p = &memfs_ftruncate_vfs,
         .stat_p = &memfs_stat_vfs,
         .unlink_p = &memfs_unlink_vfs,
         .rename_p = &memfs_rename_vfs,
+        .mkdir_p = &memfs_mkdir_vfs,
+        .rmdir_p = &memfs_rmdir_vfs,
+        .opendir_p = &memfs_opendir_vfs,
+        .readdir_p = &memfs_readdir_vfs,
+        .readdir_r_p = &memfs_readdir_r_vfs,
+        .telldir_p = &memfs_telldir_vfs,
+        .seekdir_p = &memfs_seekdir_vfs,
+        .closedir_p = &memfs_closedir_vfs,
     };
 
+    snprintf(mount_path, sizeof(mount_path), "%s", base_path);
     ESP_ERROR_CHECK(esp_vfs_register(base_path, &vfs, NULL));
     ESP_LOGI(TAG, "Mounted RAM filesystem at %s", base_path);
     return ESP_OK;
@@ -357,18 +1054,82 @@ esp_err_t memfs_unmount(const char *base_path)
     files = NULL;
     free(fds);
     fds = NULL;
+    free(name_index);
+    name_index = NULL;
+    vSemaphoreDelete(memfs_mutex);
+    memfs_mutex = NULL;
+    mount_path[0] = '\0';
 
     return ESP_OK;
 }
 
+esp_err_t memfs_map(const char *path, const uint8_t **data, size_t *size)
+{
+    if (!path || !data || !size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t prefix = strlen(mount_path);
+    if (!files || prefix == 0 || strncmp(path, mount_path, prefix) != 0 || path[prefix] != '/') {
+        return ESP_ERR_NOT_FOUND;
+    }
+    path += prefix + 1;
+
+    memfs_lock();
+    esp_err_t err = ESP_OK;
+    mem_file_t *file = lookup(path);
+    if (!file || file->is_dir) {
+        err = ESP_ERR_NOT_FOUND;
+    } else if (file->size == 0) {
+        err = ESP_ERR_INVALID_SIZE;
+    } else {
+        // A writer could reallocate the buffer underneath the caller
+        for (int j = 0; j < max_fds_count; j++) {
+            if (fds[j].file == file && (fds[j].flags & O_ACCMODE) != O_RDONLY) {
+                err = ESP_ERR_INVALID_STATE;
+                break;
+            }
+        }
+    }
+
+    if (err == ESP_OK) {
+        file->map_count++;
+        *data = file->data;
+        *size = file->size;
+    }
+    memfs_unlock();
+    return err;
+}
+
+esp_err_t memfs_unmap(const uint8_t *data)
+{
+    if (!data || !files) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    memfs_lock();
+    for (int i = 0; i < max_files_count; i++) {
+        if (files[i] && files[i]->data == data && files[i]->map_count > 0) {
+            files[i]->map_count--;
+            err = ESP_OK;
+            break;
+        }
+    }
+    memfs_unlock();
+    return err;
+}
+
 size_t memfs_get_total_used(void)
 {
     size_t total = 0;
     if (files) {
+        memfs_lock();
         for (int i = 0; i < max_files_count; i++) {
             if (files[i])
                 total += files[i]->capacity;
         }
+        memfs_unlock();
     }
     return total;
 }
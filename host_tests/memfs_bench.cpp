@@ -0,0 +1,153 @@
+/**
+ * Host benchmark for memfs write throughput
+ *
+ * Builds components/memfs against the stand-in IDF headers in shims/ and drives the VFS
+ * callbacks directly, writing multi-MB files in network-sized pieces with and without
+ * preallocation. Every file is read back and compared, so a wrong result fails the run.
+ *
+ * The PSRAM heap cannot grow a block in place the way glibc remaps large allocations, so
+ * heap_caps_realloc() here always allocates, copies and frees, and counts what it moved.
+ */
+
+#include <fcntl.h>
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "esp_heap_caps.h"
+#include "esp_vfs.h"
+#include "memfs.h"
+
+static esp_vfs_t registered_vfs;
+static size_t realloc_calls;
+static size_t realloc_bytes_copied;
+
+extern "C" void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+extern "C" void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return calloc(n, size);
+}
+
+extern "C" void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *moved = malloc(size);
+    if (moved && ptr) {
+        memcpy(moved, ptr, std::min(old_size, size));
+        realloc_bytes_copied += std::min(old_size, size);
+    }
+    if (moved) {
+        free(ptr);
+        realloc_calls++;
+    }
+    return moved;
+}
+
+extern "C" void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+extern "C" esp_err_t esp_vfs_register(const char *base_path, const esp_vfs_t *vfs, void *ctx)
+{
+    registered_vfs = *vfs;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t esp_vfs_unregister(const char *base_path)
+{
+    memset(&registered_vfs, 0, sizeof(registered_vfs));
+    return ESP_OK;
+}
+
+extern "C" const esp_vfs_t *host_vfs_get(void)
+{
+    return &registered_vfs;
+}
+
+static bool write_and_verify(const std::vector<uint8_t> &payload, size_t chunk, bool preallocate,
+                             double *seconds)
+{
+    const esp_vfs_t *vfs = host_vfs_get();
+
+    auto start = std::chrono::steady_clock::now();
+    int fd = vfs->open_p(NULL, "/bench.bin", O_WRONLY | O_CREAT | O_TRUNC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (preallocate && vfs->fcntl_p(NULL, fd, MEMFS_F_PREALLOCATE, (int) payload.size()) != 0) {
+        return false;
+    }
+    for (size_t pos = 0; pos < payload.size(); pos += chunk) {
+        size_t len = std::min(chunk, payload.size() - pos);
+        if (vfs->write_p(NULL, fd, payload.data() + pos, len) != (ssize_t) len) {
+            return false;
+        }
+    }
+    vfs->close_p(NULL, fd);
+    *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint8_t> readback(payload.size() + 1);
+    fd = vfs->open_p(NULL, "/bench.bin", O_RDONLY, 0);
+    ssize_t got = vfs->read_p(NULL, fd, readback.data(), readback.size());
+    vfs->close_p(NULL, fd);
+    bool ok = got == (ssize_t) payload.size() &&
+              memcmp(readback.data(), payload.data(), payload.size()) == 0;
+
+    vfs->unlink_p(NULL, "/bench.bin");
+    return ok;
+}
+
+int main()
+{
+    const size_t sizes[] = {1 << 20, 3 << 20, 8 << 20};
+    const size_t chunks[] = {1460, 4096, 16384};
+    const int rounds = 5;
+
+    if (memfs_mount("/bench", 4) != ESP_OK) {
+        fprintf(stderr, "mount failed\n");
+        return 1;
+    }
+
+    printf("%-8s %-7s %-12s %10s %9s %12s\n", "size", "chunk", "mode", "MB/s", "reallocs",
+           "copied MB");
+    for (size_t size : sizes) {
+        std::vector<uint8_t> payload(size);
+        for (size_t i = 0; i < size; i++) {
+            payload[i] = (uint8_t) (i * 2654435761u >> 24);
+        }
+
+        for (size_t chunk : chunks) {
+            for (int preallocate = 0; preallocate < 2; preallocate++) {
+                double best = 1e9;
+                realloc_calls = 0;
+                realloc_bytes_copied = 0;
+                for (int r = 0; r < rounds; r++) {
+                    double seconds;
+                    if (!write_and_verify(payload, chunk, preallocate, &seconds)) {
+                        fprintf(stderr, "verification failed (size %zu, chunk %zu)\n", size,
+                                chunk);
+                        return 1;
+                    }
+                    best = std::min(best, seconds);
+                }
+                printf("%-8zu %-7zu %-12s %10.1f %9zu %12.1f\n", size, chunk,
+                       preallocate ? "preallocate" : "grow", size / best / (1 << 20),
+                       realloc_calls / rounds,
+                       (double) realloc_bytes_copied / rounds / (1 << 20));
+            }
+        }
+    }
+
+    memfs_unmount("/bench");
+    return 0;
+}
@@ -0,0 +1,28 @@
+// Host stand-in for the newlib <dirent.h> that ESP-IDF uses, so code that embeds DIR (as VFS
+// drivers do) builds on the host. Found ahead of the system header via the shims include path.
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t dd_vfs_idx;
+    uint16_t dd_rsv;
+} DIR;
+
+struct dirent {
+    ino_t d_ino;
+    uint8_t d_type;
+#define DT_UNKNOWN 0
+#define DT_REG 1
+#define DT_DIR 2
+    char d_name[256];
+};
+
+#ifdef __cplusplus
+}
+#endif
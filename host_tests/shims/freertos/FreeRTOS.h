@@ -0,0 +1,12 @@
+// Host stand-in for the ESP-IDF header of the same name, just enough for the types and
+// constants components pass to the semaphore API
+#pragma once
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
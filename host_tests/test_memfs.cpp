@@ -0,0 +1,499 @@
+/**
+ * Google Test-based unit tests for the memfs VFS driver
+ *
+ * Builds components/memfs against the stand-in IDF headers in shims/ and calls the registered
+ * VFS operations directly, with paths relative to the mount point as the VFS layer passes them.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "esp_heap_caps.h"
+#include "esp_vfs.h"
+#include "memfs.h"
+
+static esp_vfs_t registered_vfs;
+static int realloc_calls;
+
+extern "C" void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+extern "C" void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return calloc(n, size);
+}
+
+extern "C" void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    realloc_calls++;
+    return realloc(ptr, size);
+}
+
+extern "C" void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+extern "C" esp_err_t esp_vfs_register(const char *base_path, const esp_vfs_t *vfs, void *ctx)
+{
+    registered_vfs = *vfs;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t esp_vfs_unregister(const char *base_path)
+{
+    memset(&registered_vfs, 0, sizeof(registered_vfs));
+    return ESP_OK;
+}
+
+extern "C" const esp_vfs_t *host_vfs_get(void)
+{
+    return &registered_vfs;
+}
+
+class MemfsTest : public ::testing::Test
+{
+   protected:
+    static constexpr size_t kMaxFiles = 64;
+
+    void SetUp() override
+    {
+        ASSERT_EQ(memfs_mount("/mem", kMaxFiles), ESP_OK);
+        vfs = host_vfs_get();
+    }
+
+    void TearDown() override { memfs_unmount("/mem"); }
+
+    bool CreateFile(const std::string &path, const std::string &content = "x")
+    {
+        int fd = vfs->open_p(NULL, path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = vfs->write_p(NULL, fd, content.data(), content.size()) ==
+                  (ssize_t) content.size();
+        vfs->close_p(NULL, fd);
+        return ok;
+    }
+
+    std::string ReadFile(const std::string &path)
+    {
+        int fd = vfs->open_p(NULL, path.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return "<missing>";
+        }
+        char buf[64];
+        ssize_t len = vfs->read_p(NULL, fd, buf, sizeof(buf));
+        vfs->close_p(NULL, fd);
+        return std::string(buf, len > 0 ? len : 0);
+    }
+
+    bool Exists(const std::string &path)
+    {
+        struct stat st;
+        return vfs->stat_p(NULL, path.c_str(), &st) == 0;
+    }
+
+    std::vector<std::string> List(const std::string &path)
+    {
+        std::vector<std::string> names;
+        DIR *dir = vfs->opendir_p(NULL, path.c_str());
+        if (!dir) {
+            return names;
+        }
+        struct dirent *entry;
+        while ((entry = vfs->readdir_p(NULL, dir)) != NULL) {
+            names.push_back(entry->d_name);
+        }
+        vfs->closedir_p(NULL, dir);
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    const esp_vfs_t *vfs;
+};
+
+// Enough unlinks to rebuild the name index several times; every survivor must still be found
+TEST_F(MemfsTest, LookupAfterManyUnlinks)
+{
+    ASSERT_TRUE(CreateFile("/keep_a", "a"));
+    ASSERT_TRUE(CreateFile("/keep_b", "b"));
+
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 40; i++) {
+            ASSERT_TRUE(CreateFile("/tmp_" + std::to_string(i)));
+        }
+        for (int i = 0; i < 40; i++) {
+            ASSERT_EQ(vfs->unlink_p(NULL, ("/tmp_" + std::to_string(i)).c_str()), 0);
+        }
+    }
+
+    EXPECT_EQ(ReadFile("/keep_a"), "a");
+    EXPECT_EQ(ReadFile("/keep_b"), "b");
+    EXPECT_FALSE(Exists("/tmp_0"));
+    EXPECT_FALSE(Exists("/tmp_39"));
+
+    // The freed slots are usable again
+    for (int i = 0; i < (int) kMaxFiles - 2; i++) {
+        ASSERT_TRUE(CreateFile("/again_" + std::to_string(i)));
+    }
+    EXPECT_FALSE(CreateFile("/one_too_many"));
+    EXPECT_EQ(ReadFile("/again_0"), "x");
+}
+
+TEST_F(MemfsTest, ReaddirListsDirectChildrenOnly)
+{
+    ASSERT_EQ(vfs->mkdir_p(NULL, "/album", 0777), 0);
+    ASSERT_EQ(vfs->mkdir_p(NULL, "/album/sub", 0777), 0);
+    ASSERT_TRUE(CreateFile("/album/one.jpg"));
+    ASSERT_TRUE(CreateFile("/album/two.jpg"));
+    ASSERT_TRUE(CreateFile("/album/sub/deep.jpg"));
+    ASSERT_TRUE(CreateFile("/other.jpg"));
+
+    EXPECT_EQ(List("/album"), (std::vector<std::string>{"one.jpg", "sub", "two.jpg"}));
+    EXPECT_EQ(List("/album/sub"), (std::vector<std::string>{"deep.jpg"}));
+    EXPECT_EQ(List("/"), (std::vector<std::string>{"album", "other.jpg"}));
+
+    DIR *dir = vfs->opendir_p(NULL, "/album");
+    ASSERT_NE(dir, nullptr);
+    struct dirent *entry;
+    while ((entry = vfs->readdir_p(NULL, dir)) != NULL) {
+        EXPECT_EQ(entry->d_type, strcmp(entry->d_name, "sub") == 0 ? DT_DIR : DT_REG);
+    }
+    vfs->closedir_p(NULL, dir);
+}
+
+TEST_F(MemfsTest, SeekdirReturnsToTelldirPosition)
+{
+    ASSERT_TRUE(CreateFile("/d/a"));
+    ASSERT_TRUE(CreateFile("/d/b"));
+    ASSERT_TRUE(CreateFile("/d/c"));
+
+    DIR *dir = vfs->opendir_p(NULL, "/d");
+    ASSERT_NE(dir, nullptr);
+    ASSERT_NE(vfs->readdir_p(NULL, dir), nullptr);
+    long pos = vfs->telldir_p(NULL, dir);
+    std::string second = vfs->readdir_p(NULL, dir)->d_name;
+    while (vfs->readdir_p(NULL, dir) != NULL) {
+    }
+
+    vfs->seekdir_p(NULL, dir, pos);
+    struct dirent *entry = vfs->readdir_p(NULL, dir);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(second, entry->d_name);
+    vfs->closedir_p(NULL, dir);
+}
+
+TEST_F(MemfsTest, OpendirOnMissingOrFileFails)
+{
+    ASSERT_TRUE(CreateFile("/file"));
+
+    errno = 0;
+    EXPECT_EQ(vfs->opendir_p(NULL, "/missing"), nullptr);
+    EXPECT_EQ(errno, ENOENT);
+    errno = 0;
+    EXPECT_EQ(vfs->opendir_p(NULL, "/file"), nullptr);
+    EXPECT_EQ(errno, ENOTDIR);
+}
+
+TEST_F(MemfsTest, RmdirRequiresEmptyDirectory)
+{
+    ASSERT_EQ(vfs->mkdir_p(NULL, "/dir", 0777), 0);
+    EXPECT_EQ(vfs->mkdir_p(NULL, "/dir", 0777), -1);
+    ASSERT_TRUE(CreateFile("/dir/file"));
+
+    errno = 0;
+    EXPECT_EQ(vfs->rmdir_p(NULL, "/dir"), -1);
+    EXPECT_EQ(errno, ENOTEMPTY);
+    EXPECT_TRUE(Exists("/dir/file"));
+
+    ASSERT_EQ(vfs->unlink_p(NULL, "/dir/file"), 0);
+    EXPECT_EQ(vfs->rmdir_p(NULL, "/dir"), 0);
+    EXPECT_FALSE(Exists("/dir"));
+}
+
+TEST_F(MemfsTest, RenameDirectoryMovesSubtree)
+{
+    ASSERT_EQ(vfs->mkdir_p(NULL, "/src", 0777), 0);
+    ASSERT_TRUE(CreateFile("/src/a", "a"));
+    ASSERT_TRUE(CreateFile("/src/nested/b", "b"));
+    ASSERT_TRUE(CreateFile("/srcfile", "s"));
+
+    ASSERT_EQ(vfs->rename_p(NULL, "/src", "/dst"), 0);
+
+    EXPECT_EQ(ReadFile("/dst/a"), "a");
+    EXPECT_EQ(ReadFile("/dst/nested/b"), "b");
+    EXPECT_EQ(ReadFile("/srcfile"), "s");
+    EXPECT_FALSE(Exists("/src"));
+    EXPECT_FALSE(Exists("/src/a"));
+    EXPECT_EQ(List("/dst"), (std::vector<std::string>{"a"}));
+}
+
+// "dst" has no entry of its own but exists through its children: moving onto it must not
+// produce a second "dst/x"
+TEST_F(MemfsTest, RenameDirectoryOntoImplicitDirectoryFails)
+{
+    ASSERT_EQ(vfs->mkdir_p(NULL, "/src", 0777), 0);
+    ASSERT_TRUE(CreateFile("/src/x", "from src"));
+    ASSERT_TRUE(CreateFile("/dst/x", "from dst"));
+
+    errno = 0;
+    EXPECT_EQ(vfs->rename_p(NULL, "/src", "/dst"), -1);
+    EXPECT_EQ(errno, ENOTEMPTY);
+
+    EXPECT_EQ(ReadFile("/src/x"), "from src");
+    EXPECT_EQ(ReadFile("/dst/x"), "from dst");
+    ASSERT_EQ(vfs->unlink_p(NULL, "/dst/x"), 0);
+    EXPECT_FALSE(Exists("/dst/x"));
+}
+
+TEST_F(MemfsTest, RenameFileOntoImplicitDirectoryFails)
+{
+    ASSERT_TRUE(CreateFile("/file"));
+    ASSERT_TRUE(CreateFile("/dir/child"));
+
+    errno = 0;
+    EXPECT_EQ(vfs->rename_p(NULL, "/file", "/dir"), -1);
+    EXPECT_EQ(errno, EISDIR);
+    EXPECT_TRUE(Exists("/file"));
+}
+
+TEST_F(MemfsTest, RenameDirectoryIntoItselfFails)
+{
+    ASSERT_EQ(vfs->mkdir_p(NULL, "/dir", 0777), 0);
+    ASSERT_TRUE(CreateFile("/dir/child"));
+
+    errno = 0;
+    EXPECT_EQ(vfs->rename_p(NULL, "/dir", "/dir/inner"), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_TRUE(Exists("/dir/child"));
+}
+
+TEST_F(MemfsTest, RenameReplacesExistingFile)
+{
+    ASSERT_TRUE(CreateFile("/new", "new"));
+    ASSERT_TRUE(CreateFile("/old", "old"));
+
+    ASSERT_EQ(vfs->rename_p(NULL, "/new", "/old"), 0);
+    EXPECT_EQ(ReadFile("/old"), "new");
+    EXPECT_FALSE(Exists("/new"));
+    EXPECT_EQ(List("/"), (std::vector<std::string>{"old"}));
+}
+
+TEST_F(MemfsTest, MapBorrowsContentsWithoutCopy)
+{
+    ASSERT_TRUE(CreateFile("/img", "pixels"));
+
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    ASSERT_EQ(memfs_map("/mem/img", &data, &size), ESP_OK);
+    EXPECT_EQ(std::string((const char *) data, size), "pixels");
+
+    // A second borrow of the same file sees the same buffer
+    const uint8_t *again = nullptr;
+    ASSERT_EQ(memfs_map("/mem/img", &again, &size), ESP_OK);
+    EXPECT_EQ(again, data);
+
+    EXPECT_EQ(memfs_unmap(data), ESP_OK);
+    EXPECT_EQ(memfs_unmap(again), ESP_OK);
+    EXPECT_EQ(memfs_unmap(data), ESP_ERR_NOT_FOUND);
+    EXPECT_EQ(vfs->unlink_p(NULL, "/img"), 0);
+}
+
+TEST_F(MemfsTest, MapRejectsMissingEmptyAndDirectories)
+{
+    const uint8_t *data;
+    size_t size;
+    ASSERT_TRUE(CreateFile("/empty", ""));
+    ASSERT_EQ(vfs->mkdir_p(NULL, "/dir", 0777), 0);
+
+    EXPECT_EQ(memfs_map("/mem/missing", &data, &size), ESP_ERR_NOT_FOUND);
+    EXPECT_EQ(memfs_map("/mem/dir", &data, &size), ESP_ERR_NOT_FOUND);
+    EXPECT_EQ(memfs_map("/other/empty", &data, &size), ESP_ERR_NOT_FOUND);
+    EXPECT_EQ(memfs_map("/mem/empty", &data, &size), ESP_ERR_INVALID_SIZE);
+}
+
+TEST_F(MemfsTest, MappedFileCannotBeReplacedOrRemoved)
+{
+    ASSERT_TRUE(CreateFile("/img", "mapped"));
+    ASSERT_TRUE(CreateFile("/other", "other"));
+
+    const uint8_t *data;
+    size_t size;
+    ASSERT_EQ(memfs_map("/mem/img", &data, &size), ESP_OK);
+
+    errno = 0;
+    EXPECT_EQ(vfs->unlink_p(NULL, "/img"), -1);
+    EXPECT_EQ(errno, EBUSY);
+    errno = 0;
+    EXPECT_EQ(vfs->rename_p(NULL, "/other", "/img"), -1);
+    EXPECT_EQ(errno, EBUSY);
+    errno = 0;
+    EXPECT_EQ(vfs->open_p(NULL, "/img", O_RDONLY | O_TRUNC, 0), -1);
+    EXPECT_EQ(errno, EBUSY);
+    errno = 0;
+    EXPECT_EQ(vfs->open_p(NULL, "/img", O_WRONLY, 0), -1);
+    EXPECT_EQ(errno, EBUSY);
+    EXPECT_EQ(std::string((const char *) data, size), "mapped");
+
+    // Readers are fine, and so is moving the mapped file itself
+    EXPECT_EQ(ReadFile("/img"), "mapped");
+    ASSERT_EQ(vfs->rename_p(NULL, "/img", "/moved"), 0);
+    EXPECT_EQ(std::string((const char *) data, size), "mapped");
+
+    ASSERT_EQ(memfs_unmap(data), ESP_OK);
+    EXPECT_EQ(vfs->unlink_p(NULL, "/moved"), 0);
+}
+
+TEST_F(MemfsTest, MapRefusedWhileWriterIsOpen)
+{
+    ASSERT_TRUE(CreateFile("/img", "data"));
+    int fd = vfs->open_p(NULL, "/img", O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+
+    const uint8_t *data;
+    size_t size;
+    EXPECT_EQ(memfs_map("/mem/img", &data, &size), ESP_ERR_INVALID_STATE);
+
+    vfs->close_p(NULL, fd);
+    ASSERT_EQ(memfs_map("/mem/img", &data, &size), ESP_OK);
+    EXPECT_EQ(memfs_unmap(data), ESP_OK);
+}
+
+TEST_F(MemfsTest, MappedFileCannotBeWrittenThroughReadOnlyFd)
+{
+    ASSERT_TRUE(CreateFile("/img", "mapped"));
+    const uint8_t *data;
+    size_t size;
+    ASSERT_EQ(memfs_map("/mem/img", &data, &size), ESP_OK);
+
+    int fd = vfs->open_p(NULL, "/img", O_RDONLY, 0);
+    ASSERT_GE(fd, 0);
+    errno = 0;
+    EXPECT_EQ(vfs->write_p(NULL, fd, "changed", 7), -1);
+    EXPECT_EQ(errno, EBADF);
+    errno = 0;
+    EXPECT_EQ(vfs->ftruncate_p(NULL, fd, 0), -1);
+    EXPECT_EQ(errno, EBADF);
+    errno = 0;
+    EXPECT_EQ(vfs->fcntl_p(NULL, fd, MEMFS_F_PREALLOCATE, 1 << 20), -1);
+    EXPECT_EQ(errno, EBADF);
+    vfs->close_p(NULL, fd);
+
+    EXPECT_EQ(std::string((const char *) data, size), "mapped");
+    ASSERT_EQ(memfs_unmap(data), ESP_OK);
+}
+
+TEST_F(MemfsTest, ReadOnlyFdCannotModifyUnmappedFile)
+{
+    ASSERT_TRUE(CreateFile("/file", "keep"));
+    int fd = vfs->open_p(NULL, "/file", O_RDONLY, 0);
+    ASSERT_GE(fd, 0);
+
+    errno = 0;
+    EXPECT_EQ(vfs->write_p(NULL, fd, "x", 1), -1);
+    EXPECT_EQ(errno, EBADF);
+    errno = 0;
+    EXPECT_EQ(vfs->ftruncate_p(NULL, fd, 1), -1);
+    EXPECT_EQ(errno, EBADF);
+    vfs->close_p(NULL, fd);
+
+    EXPECT_EQ(ReadFile("/file"), "keep");
+}
+
+// 1 MB in 4 KB writes: growing by 1.5x reallocates a handful of times, not once per block
+TEST_F(MemfsTest, WritesGrowGeometrically)
+{
+    int fd = vfs->open_p(NULL, "/big", O_WRONLY | O_CREAT, 0);
+    ASSERT_GE(fd, 0);
+    std::vector<char> block(4096, 'b');
+
+    realloc_calls = 0;
+    for (int i = 0; i < 256; i++) {
+        ASSERT_EQ(vfs->write_p(NULL, fd, block.data(), block.size()), (ssize_t) block.size());
+    }
+    vfs->close_p(NULL, fd);
+
+    EXPECT_LT(realloc_calls, 32);
+    EXPECT_GE(memfs_get_total_used(), (size_t) 1 << 20);
+    EXPECT_LE(memfs_get_total_used(), (size_t) 3 << 19);
+}
+
+TEST_F(MemfsTest, PreallocateReservesWithoutChangingSize)
+{
+    const size_t expected = 300000;
+    int fd = vfs->open_p(NULL, "/dl", O_WRONLY | O_CREAT, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(vfs->fcntl_p(NULL, fd, MEMFS_F_PREALLOCATE, (int) expected), 0);
+
+    struct stat st;
+    ASSERT_EQ(vfs->fstat_p(NULL, fd, &st), 0);
+    EXPECT_EQ(st.st_size, 0);
+    EXPECT_GE(memfs_get_total_used(), expected);
+
+    std::vector<char> chunk(1000, 'p');
+    realloc_calls = 0;
+    for (size_t written = 0; written < expected; written += chunk.size()) {
+        ASSERT_EQ(vfs->write_p(NULL, fd, chunk.data(), chunk.size()), (ssize_t) chunk.size());
+    }
+    EXPECT_EQ(realloc_calls, 0);
+
+    ASSERT_EQ(vfs->fstat_p(NULL, fd, &st), 0);
+    EXPECT_EQ((size_t) st.st_size, expected);
+    vfs->close_p(NULL, fd);
+
+    errno = 0;
+    fd = vfs->open_p(NULL, "/dl", O_WRONLY, 0);
+    EXPECT_EQ(vfs->fcntl_p(NULL, fd, MEMFS_F_PREALLOCATE, -1), -1);
+    EXPECT_EQ(errno, EINVAL);
+    vfs->close_p(NULL, fd);
+}
+
+TEST_F(MemfsTest, FtruncateExtendsWithZerosAndShrinks)
+{
+    ASSERT_TRUE(CreateFile("/file", "abc"));
+    int fd = vfs->open_p(NULL, "/file", O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+
+    ASSERT_EQ(vfs->ftruncate_p(NULL, fd, 8), 0);
+    char buf[16];
+    ASSERT_EQ(vfs->read_p(NULL, fd, buf, sizeof(buf)), 8);
+    EXPECT_EQ(std::string(buf, 8), std::string("abc\0\0\0\0\0", 8));
+
+    ASSERT_EQ(vfs->ftruncate_p(NULL, fd, 2), 0);
+    struct stat st;
+    ASSERT_EQ(vfs->fstat_p(NULL, fd, &st), 0);
+    EXPECT_EQ(st.st_size, 2);
+
+    // Growing again must not resurrect the bytes cut off above
+    ASSERT_EQ(vfs->ftruncate_p(NULL, fd, 4), 0);
+    ASSERT_EQ(vfs->lseek_p(NULL, fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(vfs->read_p(NULL, fd, buf, sizeof(buf)), 4);
+    EXPECT_EQ(std::string(buf, 4), std::string("ab\0\0", 4));
+    vfs->close_p(NULL, fd);
+}
+
+TEST_F(MemfsTest, WritePastEndLeavesZeroedHole)
+{
+    int fd = vfs->open_p(NULL, "/sparse", O_RDWR | O_CREAT, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(vfs->write_p(NULL, fd, "head", 4), 4);
+    ASSERT_EQ(vfs->lseek_p(NULL, fd, 10, SEEK_SET), 10);
+    ASSERT_EQ(vfs->write_p(NULL, fd, "tail", 4), 4);
+
+    char buf[32];
+    ASSERT_EQ(vfs->lseek_p(NULL, fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(vfs->read_p(NULL, fd, buf, sizeof(buf)), 14);
+    EXPECT_EQ(std::string(buf, 14), std::string("head\0\0\0\0\0\0tail", 14));
+    vfs->close_p(NULL, fd);
+}
@@ -6,6 +6,8 @@
 #include <time.h>
 
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "../main/testable_utils.h"
 
@@ -260,6 +262,254 @@ TEST_F(CalculateNextWakeupIntervalTest, SameDayScheduleWraparound)
     EXPECT_EQ(29949, result) << "Should wake at 08:00 tomorrow (wrapper around)";
 }
 
+// shuffle_permute_index: every item is visited exactly once per cycle
+TEST(ShufflePermuteIndexTest, IsPermutationForVariousCounts)
+{
+    const uint32_t counts[] = {2, 3, 4, 5, 7, 16, 17, 100, 255, 256, 257, 1000, 4099};
+    for (uint32_t count : counts) {
+        std::vector<bool> seen(count, false);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t item = shuffle_permute_index(i, count, 0x12345678);
+            ASSERT_LT(item, count) << "count=" << count;
+            EXPECT_FALSE(seen[item]) << "count=" << count << " repeated item " << item;
+            seen[item] = true;
+        }
+    }
+}
+
+TEST(ShufflePermuteIndexTest, SingleItem)
+{
+    EXPECT_EQ(0u, shuffle_permute_index(0, 1, 42));
+    EXPECT_EQ(0u, shuffle_permute_index(0, 0, 42));
+}
+
+TEST(ShufflePermuteIndexTest, DeterministicForSeed)
+{
+    for (uint32_t i = 0; i < 50; i++) {
+        EXPECT_EQ(shuffle_permute_index(i, 50, 7), shuffle_permute_index(i, 50, 7));
+    }
+}
+
+TEST(ShufflePermuteIndexTest, DifferentSeedsGiveDifferentOrders)
+{
+    int same = 0;
+    for (uint32_t i = 0; i < 100; i++) {
+        if (shuffle_permute_index(i, 100, 1) == shuffle_permute_index(i, 100, 2)) {
+            same++;
+        }
+    }
+    EXPECT_LT(same, 20) << "Orders for different seeds should mostly differ";
+}
+
+TEST(ShufflePermuteIndexTest, NotIdentity)
+{
+    int fixed = 0;
+    for (uint32_t i = 0; i < 100; i++) {
+        if (shuffle_permute_index(i, 100, 0xdeadbeef) == i) {
+            fixed++;
+        }
+    }
+    EXPECT_LT(fixed, 20) << "Shuffled order should not be the original order";
+}
+
+// Tests for the multipart/form-data helpers
+TEST(MultipartTest, BoundaryFromContentType)
+{
+    char boundary[80];
+    EXPECT_TRUE(multipart_get_boundary(
+        "multipart/form-data; boundary=----WebKitFormBoundaryx8Yk", boundary, sizeof(boundary)));
+    EXPECT_STREQ(boundary, "----WebKitFormBoundaryx8Yk");
+
+    EXPECT_TRUE(multipart_get_boundary("multipart/form-data; BOUNDARY=\"a b;c\"", boundary,
+                                       sizeof(boundary)));
+    EXPECT_STREQ(boundary, "a b;c");
+
+    EXPECT_TRUE(multipart_get_boundary("multipart/form-data; boundary=xyz; charset=utf-8", boundary,
+                                       sizeof(boundary)));
+    EXPECT_STREQ(boundary, "xyz");
+
+    EXPECT_FALSE(multipart_get_boundary("multipart/form-data", boundary, sizeof(boundary)));
+    EXPECT_FALSE(
+        multipart_get_boundary("multipart/form-data; boundary=", boundary, sizeof(boundary)));
+}
+
+TEST(MultipartTest, DelimiterFindMatchesNaiveSearch)
+{
+    multipart_delimiter_t delimiter;
+    ASSERT_TRUE(multipart_delimiter_init(&delimiter, "----abcAB12"));
+
+    std::string pattern = "\r\n------abcAB12";
+    // Near misses of the delimiter all over the place, then the real one
+    std::string data;
+    for (int i = 0; i < 200; i++) {
+        data += "\r\n------abcAB1";
+        data += (char) ('a' + i % 26);
+        data += "-----";
+    }
+    size_t expected = data.size();
+    data += pattern + "--\r\n";
+
+    EXPECT_EQ(multipart_delimiter_find(&delimiter, (const uint8_t *) data.data(), data.size()),
+              (long) expected);
+    EXPECT_EQ(data.find(pattern), expected);
+
+    // Cut off one byte before the end of the delimiter
+    EXPECT_EQ(multipart_delimiter_find(&delimiter, (const uint8_t *) data.data(),
+                                       expected + pattern.size() - 1),
+              -1);
+    // At offset 0
+    EXPECT_EQ(
+        multipart_delimiter_find(&delimiter, (const uint8_t *) pattern.data(), pattern.size()), 0);
+}
+
+TEST(MultipartTest, DelimiterFindInBinaryData)
+{
+    multipart_delimiter_t delimiter;
+    ASSERT_TRUE(multipart_delimiter_init(&delimiter, "XyZ"));
+
+    std::vector<uint8_t> data(4096);
+    uint32_t state = 1;
+    for (auto &b : data) {
+        state = state * 1103515245u + 12345u;
+        b = (uint8_t) (state >> 16);
+    }
+    const char *pattern = "\r\n--XyZ";
+    memcpy(&data[3000], pattern, 7);
+
+    std::string haystack(data.begin(), data.end());
+    size_t expected = haystack.find(std::string(pattern, 7));
+    EXPECT_EQ(multipart_delimiter_find(&delimiter, data.data(), data.size()), (long) expected);
+}
+
+TEST(MultipartTest, RejectsOverlongBoundary)
+{
+    multipart_delimiter_t delimiter;
+    std::string boundary(MULTIPART_BOUNDARY_MAX + 1, 'a');
+    EXPECT_FALSE(multipart_delimiter_init(&delimiter, boundary.c_str()));
+    EXPECT_FALSE(multipart_delimiter_init(&delimiter, ""));
+}
+
+TEST(MultipartTest, ParsesPartHeaders)
+{
+    char name[32];
+    char filename[64];
+
+    std::string headers =
+        "content-disposition: form-data; filename=\"my \\\"cat\\\".jpg\"; name=\"image\"\r\n"
+        "Content-Type: image/jpeg";
+    ASSERT_TRUE(multipart_parse_part_headers(headers.data(), headers.size(), name, sizeof(name),
+                                             filename, sizeof(filename)));
+    EXPECT_STREQ(name, "image");
+    EXPECT_STREQ(filename, "my \"cat\".jpg");
+
+    headers = "Content-Type: text/plain\r\nContent-Disposition: form-data; name=processingMode";
+    ASSERT_TRUE(multipart_parse_part_headers(headers.data(), headers.size(), name, sizeof(name),
+                                             filename, sizeof(filename)));
+    EXPECT_STREQ(name, "processingMode");
+    EXPECT_STREQ(filename, "");
+
+    headers = "Content-Type: image/png";
+    EXPECT_FALSE(multipart_parse_part_headers(headers.data(), headers.size(), name, sizeof(name),
+                                              filename, sizeof(filename)));
+}
+
+static std::vector<uint8_t> make_raw_header(uint16_t width, uint16_t height, uint8_t flags,
+                                            uint32_t crc)
+{
+    std::vector<uint8_t> header = {'E', 'P', 'D', '4', RAW_FRAME_VERSION, flags, 0, 0};
+    header.push_back(width & 0xff);
+    header.push_back(width >> 8);
+    header.push_back(height & 0xff);
+    header.push_back(height >> 8);
+    for (int i = 0; i < 4; i++) {
+        header.push_back((crc >> (8 * i)) & 0xff);
+    }
+    return header;
+}
+
+TEST(RawFrameTest, ParsesHeader)
+{
+    raw_frame_header_t header;
+    std::vector<uint8_t> data = make_raw_header(800, 480, RAW_FRAME_FLAG_DEFLATE, 0xdeadbeef);
+    ASSERT_TRUE(raw_frame_parse_header(data.data(), data.size(), &header));
+    EXPECT_EQ(header.width, 800);
+    EXPECT_EQ(header.height, 480);
+    EXPECT_EQ(header.flags, RAW_FRAME_FLAG_DEFLATE);
+    EXPECT_EQ(header.crc32, 0xdeadbeefu);
+
+    EXPECT_FALSE(raw_frame_parse_header(data.data(), data.size() - 1, &header));
+
+    data[0] = 'X';
+    EXPECT_FALSE(raw_frame_parse_header(data.data(), data.size(), &header));
+
+    data = make_raw_header(800, 480, 0x80, 0);
+    EXPECT_FALSE(raw_frame_parse_header(data.data(), data.size(), &header));
+
+    data = make_raw_header(0, 480, 0, 0);
+    EXPECT_FALSE(raw_frame_parse_header(data.data(), data.size(), &header));
+}
+
+TEST(RawFrameTest, BuiltHeaderParsesBack)
+{
+    uint8_t data[RAW_FRAME_HEADER_SIZE];
+    raw_frame_build_header(data, 1200, 1600, 0, 0x01020304);
+    EXPECT_EQ(std::vector<uint8_t>(data, data + sizeof(data)),
+              make_raw_header(1200, 1600, 0, 0x01020304));
+
+    raw_frame_header_t header;
+    ASSERT_TRUE(raw_frame_parse_header(data, sizeof(data), &header));
+    EXPECT_EQ(header.width, 1200);
+    EXPECT_EQ(header.height, 1600);
+    EXPECT_EQ(header.crc32, 0x01020304u);
+}
+
+TEST(RawFrameTest, FrameSizeRoundsRowsUp)
+{
+    EXPECT_EQ(raw_frame_size(800, 480), 192000u);
+    EXPECT_EQ(raw_frame_size(3, 2), 4u);
+}
+
+TEST(RawFrameTest, ValidatesPixels)
+{
+    // 3x2: the low nibble of each row's last byte is padding
+    std::vector<uint8_t> frame = {0x01, 0x2f, 0x35, 0x6f};
+    EXPECT_TRUE(raw_frame_pixels_valid(frame.data(), 3, 2));
+
+    frame[1] = 0x4f;  // reserved colour
+    EXPECT_FALSE(raw_frame_pixels_valid(frame.data(), 3, 2));
+
+    frame = {0x01, 0x27};  // 4x1, 0x7 is not a panel colour
+    EXPECT_FALSE(raw_frame_pixels_valid(frame.data(), 4, 1));
+}
+
+TEST(UrlOriginTest, MatchesSameOrigin)
+{
+    EXPECT_TRUE(url_same_origin("http://example.com/a.jpg", "http://example.com/thumb?id=1"));
+    EXPECT_TRUE(url_same_origin("https://Example.COM/a", "https://example.com:443/b"));
+    EXPECT_TRUE(url_same_origin("http://example.com:80", "http://user:pw@example.com/x"));
+    EXPECT_TRUE(url_same_origin("http://192.168.1.5:8080/a", "http://192.168.1.5:8080#frag"));
+    EXPECT_TRUE(url_same_origin("http://[fe80::1]:8000/a", "http://[FE80::1]:8000/b"));
+}
+
+TEST(UrlOriginTest, RejectsDifferentOrigins)
+{
+    EXPECT_FALSE(url_same_origin("http://example.com/a", "https://example.com/a"));
+    EXPECT_FALSE(url_same_origin("http://example.com/a", "http://example.com:8080/a"));
+    EXPECT_FALSE(url_same_origin("http://example.com/a", "http://cdn.example.com/a"));
+    EXPECT_FALSE(url_same_origin("http://example.com/a", "http://example.co/a"));
+    EXPECT_FALSE(url_same_origin("http://[fe80::1]/a", "http://[fe80::2]/a"));
+}
+
+TEST(UrlOriginTest, RejectsMalformedUrls)
+{
+    EXPECT_FALSE(url_same_origin("/thumb.jpg", "/thumb.jpg"));
+    EXPECT_FALSE(url_same_origin("ftp://example.com/a", "ftp://example.com/a"));
+    EXPECT_FALSE(url_same_origin("http:///a", "http:///a"));
+    EXPECT_FALSE(url_same_origin("http://example.com:99999/", "http://example.com:99999/"));
+    EXPECT_FALSE(url_same_origin("http://example.com:8o/", "http://example.com:8o/"));
+    EXPECT_FALSE(url_same_origin(NULL, "http://example.com/"));
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -1,20 +1,59 @@
 #include "album_manager.h"
 
 #include <dirent.h>
+#include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "config.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "nvs.h"
 #include "storage.h"
 
 static const char *TAG = "album_manager";
 static char enabled_albums_str[512] = "";
 
+// On-disk album index: a header followed by fixed-size album_index_entry_t records, so entry N
+// lives at a known offset and rotation never has to walk the directory.
+#define ALBUM_INDEX_MAGIC 0x49414650  // "PFAI"
+#define ALBUM_INDEX_VERSION 1
+#define ALBUM_INDEX_TMP_FILENAME ".album.idx.tmp"
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_size;
+    uint32_t count;
+    uint32_t session;   // index_session when the index was written
+    int64_t dir_mtime;  // Album directory mtime when the index was written
+} album_index_header_t;
+
+// Random per power-on and kept across deep sleep. An index written in an earlier session is
+// rebuilt once, since the card may have been edited in another machine in the meantime.
+//
+// The directory mtime only catches outside changes on filesystems that update it. FAT does not
+// touch a directory's timestamp when entries are added or removed, so on SD cards staleness is
+// detected by the session, by our own upload/delete paths keeping the index current, and by
+// rotation discarding the index when an indexed file turns out to be missing. Files added to
+// the card during deep sleep show up after the next power cycle or a rebuild.
+RTC_DATA_ATTR static uint32_t index_session = 0;
+static SemaphoreHandle_t index_mutex = NULL;
+
 esp_err_t album_manager_init(void)
 {
+    if (index_session == 0) {
+        index_session = esp_random() | 1;
+    }
+    if (!index_mutex) {
+        index_mutex = xSemaphoreCreateMutex();
+    }
+
     if (!storage_has_persistent_storage()) {
         ESP_LOGI(TAG, "Storage not mounted - skipping album manager initialization");
         return ESP_OK;
@@ -183,6 +222,9 @@ esp_err_t album_manager_delete_album(const char *album_name)
     }
     closedir(dir);
 
+    // The index is a dot file and was skipped above
+    album_manager_index_invalidate(album_name);
+
     if (rmdir(album_path) != 0) {
         ESP_LOGE(TAG, "Failed to delete album directory: %s", album_name);
         return ESP_FAIL;
@@ -372,4 +414,399 @@ bool album_manager_album_exists(const char *album_name)
 
     struct stat st;
     return (stat(album_path, &st) == 0 && S_ISDIR(st.st_mode));
-}
\ No newline at end of file
+}
+// ============================================================================
+// Album index
+// ============================================================================
+
+static bool is_displayable_image(const char *filename)
+{
+    // Skip macOS resource fork files
+    if (filename[0] == '.' && filename[1] == '_') {
+        return false;
+    }
+    const char *ext = strrchr(filename, '.');
+    return ext && (strcasecmp(ext, ".bmp") == 0 || strcasecmp(ext, ".png") == 0);
+}
+
+static bool get_dir_mtime(const char *album_path, int64_t *mtime)
+{
+    struct stat st;
+    if (stat(album_path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    *mtime = (int64_t) st.st_mtime;
+    return true;
+}
+
+// Stamp the header with the current directory mtime. Must be called after every change to the
+// album directory, since our own writes move the mtime too.
+static esp_err_t index_write_header(const char *album_path, album_index_header_t *header)
+{
+    char index_path[320];
+    snprintf(index_path, sizeof(index_path), "%s/%s", album_path, ALBUM_INDEX_FILENAME);
+
+    if (!get_dir_mtime(album_path, &header->dir_mtime)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    FILE *f = fopen(index_path, "r+b");
+    if (!f) {
+        return ESP_FAIL;
+    }
+    size_t written = fwrite(header, sizeof(*header), 1, f);
+    fclose(f);
+    return written == 1 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t index_rebuild(const char *album_path)
+{
+    char index_path[320];
+    char tmp_path[320];
+    snprintf(index_path, sizeof(index_path), "%s/%s", album_path, ALBUM_INDEX_FILENAME);
+    snprintf(tmp_path, sizeof(tmp_path), "%s/%s", album_path, ALBUM_INDEX_TMP_FILENAME);
+
+    DIR *dir = opendir(album_path);
+    if (!dir) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        closedir(dir);
+        ESP_LOGE(TAG, "Failed to create album index: %s", tmp_path);
+        return ESP_FAIL;
+    }
+
+    album_index_header_t header = {
+        .magic = ALBUM_INDEX_MAGIC,
+        .version = ALBUM_INDEX_VERSION,
+        .entry_size = sizeof(album_index_entry_t),
+        .count = 0,
+        .session = index_session,
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG || !is_displayable_image(entry->d_name)) {
+            continue;
+        }
+        if (strlen(entry->d_name) >= ALBUM_INDEX_NAME_MAX) {
+            ESP_LOGW(TAG, "Filename too long for album index, skipping: %s", entry->d_name);
+            continue;
+        }
+
+        album_index_entry_t record = {0};
+        strlcpy(record.filename, entry->d_name, sizeof(record.filename));
+
+        char thumbnail_path[512];
+        const char *ext = strrchr(entry->d_name, '.');
+        snprintf(thumbnail_path, sizeof(thumbnail_path), "%s/%.*s.jpg", album_path,
+                 (int) (ext - entry->d_name), entry->d_name);
+        struct stat st;
+        if (stat(thumbnail_path, &st) == 0) {
+            record.flags |= ALBUM_INDEX_FLAG_THUMBNAIL;
+        }
+
+        ok = fwrite(&record, sizeof(record), 1, f) == 1;
+        header.count++;
+    }
+    closedir(dir);
+
+    if (ok) {
+        ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, f) == 1;
+    }
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+
+    // FAT can't rename over an existing file
+    unlink(index_path);
+    if (!ok || rename(tmp_path, index_path) != 0) {
+        ESP_LOGE(TAG, "Failed to write album index for %s", album_path);
+        unlink(tmp_path);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Rebuilt album index for %s: %lu image(s)", album_path,
+             (unsigned long) header.count);
+    return index_write_header(album_path, &header);
+}
+
+// Open an album index for reading. If allow_rebuild is set, a missing or stale index is rebuilt
+// first; otherwise ESP_ERR_INVALID_STATE is returned for it. Must be called with index_mutex held.
+static esp_err_t index_open(const char *album_name, bool allow_rebuild, FILE **file,
+                            album_index_header_t *header, char *album_path, size_t album_path_len)
+{
+    if (album_manager_get_album_path(album_name, album_path, album_path_len) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char index_path[320];
+    snprintf(index_path, sizeof(index_path), "%s/%s", album_path, ALBUM_INDEX_FILENAME);
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int64_t dir_mtime;
+        if (!get_dir_mtime(album_path, &dir_mtime)) {
+            return ESP_ERR_NOT_FOUND;
+        }
+
+        FILE *f = fopen(index_path, "rb");
+        if (f) {
+            bool valid = fread(header, sizeof(*header), 1, f) == 1 &&
+                         header->magic == ALBUM_INDEX_MAGIC &&
+                         header->version == ALBUM_INDEX_VERSION &&
+                         header->entry_size == sizeof(album_index_entry_t) &&
+                         header->session == index_session && header->dir_mtime == dir_mtime;
+            if (valid) {
+                // Guard against a truncated file
+                long expected = sizeof(*header) + (long) header->count * header->entry_size;
+                valid = fseek(f, 0, SEEK_END) == 0 && ftell(f) >= expected;
+            }
+            if (valid) {
+                *file = f;
+                return ESP_OK;
+            }
+            fclose(f);
+        }
+
+        if (!allow_rebuild || attempt > 0) {
+            break;
+        }
+        esp_err_t err = index_rebuild(album_path);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    return ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t album_manager_index_get_count(const char *album_name, int *count)
+{
+    if (!album_name || !count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!index_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    FILE *f = NULL;
+    album_index_header_t header;
+    char album_path[256];
+    esp_err_t err = index_open(album_name, true, &f, &header, album_path, sizeof(album_path));
+    if (err == ESP_OK) {
+        *count = header.count;
+        fclose(f);
+    }
+    xSemaphoreGive(index_mutex);
+    return err;
+}
+
+esp_err_t album_manager_index_read(const char *album_name, int start, album_index_entry_t *entries,
+                                   int max_entries, int *entries_read)
+{
+    if (!album_name || !entries || !entries_read || start < 0 || max_entries < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!index_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *entries_read = 0;
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    FILE *f = NULL;
+    album_index_header_t header;
+    char album_path[256];
+    esp_err_t err = index_open(album_name, true, &f, &header, album_path, sizeof(album_path));
+    if (err == ESP_OK) {
+        if ((uint32_t) start < header.count) {
+            int n = header.count - start;
+            if (n > max_entries) {
+                n = max_entries;
+            }
+            if (fseek(f, sizeof(header) + (long) start * sizeof(album_index_entry_t),
+                      SEEK_SET) == 0) {
+                *entries_read = fread(entries, sizeof(album_index_entry_t), n, f);
+            }
+            if (*entries_read != n) {
+                err = ESP_FAIL;
+            }
+        }
+        fclose(f);
+    }
+    xSemaphoreGive(index_mutex);
+    return err;
+}
+
+esp_err_t album_manager_index_add(const char *album_name, const char *filename,
+                                  bool has_thumbnail)
+{
+    if (!album_name || !filename) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!index_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!is_displayable_image(filename) || strlen(filename) >= ALBUM_INDEX_NAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+
+    // The directory already changed, so a valid index has a stale mtime: accept it as long as
+    // it is otherwise intact, and update it in place.
+    char album_path[256];
+    char index_path[320];
+    esp_err_t err = album_manager_get_album_path(album_name, album_path, sizeof(album_path));
+    if (err != ESP_OK) {
+        xSemaphoreGive(index_mutex);
+        return err;
+    }
+    snprintf(index_path, sizeof(index_path), "%s/%s", album_path, ALBUM_INDEX_FILENAME);
+
+    album_index_header_t header;
+    FILE *f = fopen(index_path, "r+b");
+    if (!f || fread(&header, sizeof(header), 1, f) != 1 || header.magic != ALBUM_INDEX_MAGIC ||
+        header.version != ALBUM_INDEX_VERSION ||
+        header.entry_size != sizeof(album_index_entry_t) || header.session != index_session) {
+        // No usable index: it will be built from scratch on next use
+        if (f) {
+            fclose(f);
+        }
+        xSemaphoreGive(index_mutex);
+        return ESP_OK;
+    }
+
+    album_index_entry_t record;
+    uint32_t slot = header.count;
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (fread(&record, sizeof(record), 1, f) != 1) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (strcmp(record.filename, filename) == 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (err == ESP_OK) {
+        memset(&record, 0, sizeof(record));
+        strlcpy(record.filename, filename, sizeof(record.filename));
+        record.flags = has_thumbnail ? ALBUM_INDEX_FLAG_THUMBNAIL : 0;
+        if (fseek(f, sizeof(header) + (long) slot * sizeof(record), SEEK_SET) != 0 ||
+            fwrite(&record, sizeof(record), 1, f) != 1) {
+            err = ESP_FAIL;
+        }
+    }
+    fclose(f);
+
+    if (err == ESP_OK) {
+        if (slot == header.count) {
+            header.count++;
+        }
+        err = index_write_header(album_path, &header);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to update album index for %s, discarding it", album_name);
+        unlink(index_path);
+    }
+
+    xSemaphoreGive(index_mutex);
+    return err;
+}
+
+esp_err_t album_manager_index_remove(const char *album_name, const char *filename)
+{
+    if (!album_name || !filename) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!index_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+
+    char album_path[256];
+    char index_path[320];
+    esp_err_t err = album_manager_get_album_path(album_name, album_path, sizeof(album_path));
+    if (err != ESP_OK) {
+        xSemaphoreGive(index_mutex);
+        return err;
+    }
+    snprintf(index_path, sizeof(index_path), "%s/%s", album_path, ALBUM_INDEX_FILENAME);
+
+    album_index_header_t header;
+    FILE *f = fopen(index_path, "r+b");
+    if (!f || fread(&header, sizeof(header), 1, f) != 1 || header.magic != ALBUM_INDEX_MAGIC ||
+        header.version != ALBUM_INDEX_VERSION ||
+        header.entry_size != sizeof(album_index_entry_t) || header.session != index_session) {
+        if (f) {
+            fclose(f);
+        }
+        xSemaphoreGive(index_mutex);
+        return ESP_OK;
+    }
+
+    album_index_entry_t record;
+    int64_t slot = -1;
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (fread(&record, sizeof(record), 1, f) != 1) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (strcmp(record.filename, filename) == 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (err == ESP_OK && slot >= 0) {
+        // Move the last entry into the hole
+        uint32_t last = header.count - 1;
+        if ((uint32_t) slot != last &&
+            (fseek(f, sizeof(header) + (long) last * sizeof(record), SEEK_SET) != 0 ||
+             fread(&record, sizeof(record), 1, f) != 1 ||
+             fseek(f, sizeof(header) + (long) slot * sizeof(record), SEEK_SET) != 0 ||
+             fwrite(&record, sizeof(record), 1, f) != 1)) {
+            err = ESP_FAIL;
+        }
+        header.count--;
+    }
+    fclose(f);
+
+    if (err == ESP_OK) {
+        err = index_write_header(album_path, &header);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to update album index for %s, discarding it", album_name);
+        unlink(index_path);
+    }
+
+    xSemaphoreGive(index_mutex);
+    return err;
+}
+
+void album_manager_index_invalidate(const char *album_name)
+{
+    char album_path[256];
+    if (!album_name || album_manager_get_album_path(album_name, album_path, sizeof(album_path)) !=
+                           ESP_OK) {
+        return;
+    }
+
+    char index_path[320];
+    snprintf(index_path, sizeof(index_path), "%s/%s", album_path, ALBUM_INDEX_FILENAME);
+
+    if (index_mutex) {
+        xSemaphoreTake(index_mutex, portMAX_DELAY);
+    }
+    unlink(index_path);
+    if (index_mutex) {
+        xSemaphoreGive(index_mutex);
+    }
+}
@@ -2,9 +2,24 @@
 #define ALBUM_MANAGER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "esp_err.h"
 
+// Name of the per-album index file, kept inside the album directory
+#define ALBUM_INDEX_FILENAME ".album.idx"
+#define ALBUM_INDEX_NAME_MAX 124
+
+#define ALBUM_INDEX_FLAG_THUMBNAIL (1 << 0)  // A .jpg thumbnail with the same base name exists
+
+/**
+ * @brief One displayable image in an album index (fixed size, so entry N can be seeked to)
+ */
+typedef struct {
+    char filename[ALBUM_INDEX_NAME_MAX];
+    uint32_t flags;  // ALBUM_INDEX_FLAG_*
+} album_index_entry_t;
+
 esp_err_t album_manager_init(void);
 esp_err_t album_manager_ensure_default_album(void);
 esp_err_t album_manager_list_albums(char ***albums, int *count);
@@ -17,4 +32,44 @@ esp_err_t album_manager_get_enabled_albums(char ***albums, int *count);
 esp_err_t album_manager_get_album_path(const char *album_name, char *path, size_t path_len);
 bool album_manager_album_exists(const char *album_name);
 
+/**
+ * @brief Number of displayable images in an album
+ *
+ * Served from the album's on-disk index. The index is rebuilt by scanning the
+ * directory if it is missing, corrupt or stale (the album directory changed, or
+ * it was written before the last power-on, when the card may have been edited
+ * elsewhere).
+ */
+esp_err_t album_manager_index_get_count(const char *album_name, int *count);
+
+/**
+ * @brief Read consecutive entries from an album index
+ *
+ * @param album_name Album to read
+ * @param start Index of the first entry
+ * @param entries Output array
+ * @param max_entries Capacity of entries
+ * @param entries_read Number of entries actually read (0 past the end)
+ */
+esp_err_t album_manager_index_read(const char *album_name, int start, album_index_entry_t *entries,
+                                   int max_entries, int *entries_read);
+
+/**
+ * @brief Record a new or replaced image in the album index
+ *
+ * Call after the image (and its thumbnail, if any) has been written.
+ */
+esp_err_t album_manager_index_add(const char *album_name, const char *filename,
+                                  bool has_thumbnail);
+
+/**
+ * @brief Drop an image from the album index
+ */
+esp_err_t album_manager_index_remove(const char *album_name, const char *filename);
+
+/**
+ * @brief Discard an album index so it is rebuilt on next use
+ */
+void album_manager_index_invalidate(const char *album_name);
+
 #endif
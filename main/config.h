@@ -26,6 +26,7 @@ typedef enum {
 #define ACCESS_TOKEN_MAX_LEN 512
 #define HTTP_HEADER_KEY_MAX_LEN 64
 #define HTTP_HEADER_VALUE_MAX_LEN 512
+#define DISPLAY_OVERLAY_SPEC_MAX_LEN 1536
 
 #define DEFAULT_DEVICE_NAME "PhotoFrame"
 #define DEFAULT_WIFI_SSID "PhotoFrame"
@@ -49,6 +50,9 @@ typedef enum {
 #define CURRENT_BMP_PATH FS_MOUNT_POINT "/.current.bmp"
 #define CURRENT_PNG_PATH FS_MOUNT_POINT "/.current.png"
 #define CURRENT_IMAGE_LINK FS_MOUNT_POINT "/.current.lnk"
+// URL rotation prefetch: next frame rendered before sleep, and its thumbnail
+#define PREFETCH_FRAME_PATH FS_MOUNT_POINT "/.next.epd4"
+#define PREFETCH_THUMB_PATH FS_MOUNT_POINT "/.next.jpg"
 #define CURRENT_CALIBRATION_PATH FS_MOUNT_POINT "/.calibration.png"
 
 #ifdef DEBUG_DEEP_SLEEP_WAKE
@@ -70,6 +74,7 @@ typedef enum {
 #define NVS_NTP_SERVER_KEY "ntp_server"
 #define NVS_DISPLAY_ORIENTATION_KEY "disp_orient"
 #define NVS_DISPLAY_ROTATION_DEG_KEY "disp_rot_deg"
+#define NVS_DISPLAY_OVERLAY_KEY "disp_overlay"
 
 // Auto Rotate
 #define NVS_AUTO_ROTATE_KEY "auto_rotate"
@@ -91,6 +96,7 @@ typedef enum {
 #define NVS_HTTP_HEADER_KEY_KEY "http_hdr_key"
 #define NVS_HTTP_HEADER_VALUE_KEY "http_hdr_val"
 #define NVS_SAVE_DOWNLOADED_KEY "save_dl"
+#define NVS_PREFETCH_NEXT_KEY "prefetch_next"
 
 // Power
 #define NVS_DEEP_SLEEP_KEY "deep_sleep"
@@ -6,6 +6,10 @@
 #include "board_hal.h"
 #include "config.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "nvs.h"
 #include "storage.h"
 
@@ -17,6 +21,7 @@ static char tz_string[TIMEZONE_MAX_LEN] = {0};
 static char ntp_server[NTP_SERVER_MAX_LEN] = {0};
 static display_orientation_t display_orientation = DISPLAY_ORIENTATION_LANDSCAPE;
 static int display_rotation_deg = BOARD_HAL_DISPLAY_ROTATION_DEG;
+static char display_overlay[DISPLAY_OVERLAY_SPEC_MAX_LEN] = {0};
 static char wifi_ssid[WIFI_SSID_MAX_LEN] = {0};
 static char wifi_password[WIFI_PASS_MAX_LEN] = {0};
 
@@ -41,6 +46,7 @@ static char access_token[ACCESS_TOKEN_MAX_LEN] = {0};
 static char http_header_key[HTTP_HEADER_KEY_MAX_LEN] = {0};
 static char http_header_value[HTTP_HEADER_VALUE_MAX_LEN] = {0};
 static bool save_downloaded_images = true;
+static bool prefetch_next_image = false;
 
 // Home Assistant
 static char ha_url[HA_URL_MAX_LEN] = {0};
@@ -52,10 +58,151 @@ static char google_api_key[AI_API_KEY_MAX_LEN] = {0};
 // Power
 static bool deep_sleep_enabled = true;  // Enabled by default
 
+// One NVS write, applied right away or staged by config_manager_begin()
+typedef enum { WRITE_STR, WRITE_U8, WRITE_I32, WRITE_ERASE } write_type_t;
+
+typedef struct {
+    const char *key;
+    write_type_t type;
+    union {
+        const char *str;  // One of the buffers above, read when the write is applied
+        uint8_t u8;
+        int32_t i32;
+    };
+} config_write_t;
+
+// More than the number of keys, so a batch never runs out of slots
+#define MAX_STAGED_WRITES 32
+
+static config_write_t staged_writes[MAX_STAGED_WRITES];
+static int staged_count = 0;
+static TaskHandle_t batch_task = NULL;  // Task with a batch open, NULL if none
+static SemaphoreHandle_t batch_mutex = NULL;
+
+static esp_err_t apply_write(nvs_handle_t nvs_handle, const config_write_t *write)
+{
+    switch (write->type) {
+    case WRITE_STR:
+        return nvs_set_str(nvs_handle, write->key, write->str);
+    case WRITE_U8:
+        return nvs_set_u8(nvs_handle, write->key, write->u8);
+    case WRITE_I32:
+        return nvs_set_i32(nvs_handle, write->key, write->i32);
+    case WRITE_ERASE: {
+        esp_err_t err = nvs_erase_key(nvs_handle, write->key);
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+    }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+static void config_write(const config_write_t *write)
+{
+    if (batch_task != NULL && batch_task == xTaskGetCurrentTaskHandle()) {
+        // A later write of the same key replaces the staged one
+        int i = 0;
+        while (i < staged_count && strcmp(staged_writes[i].key, write->key) != 0) {
+            i++;
+        }
+        if (i < MAX_STAGED_WRITES) {
+            staged_writes[i] = *write;
+            if (i == staged_count) {
+                staged_count++;
+            }
+            return;
+        }
+        ESP_LOGW(TAG, "Too many staged settings, saving %s right away", write->key);
+    }
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
+        apply_write(nvs_handle, write);
+        nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+}
+
+static void config_set_str(const char *key, const char *value)
+{
+    config_write(&(config_write_t){.key = key, .type = WRITE_STR, .str = value});
+}
+
+static void config_set_u8(const char *key, uint8_t value)
+{
+    config_write(&(config_write_t){.key = key, .type = WRITE_U8, .u8 = value});
+}
+
+static void config_set_i32(const char *key, int32_t value)
+{
+    config_write(&(config_write_t){.key = key, .type = WRITE_I32, .i32 = value});
+}
+
+static void config_erase(const char *key)
+{
+    config_write(&(config_write_t){.key = key, .type = WRITE_ERASE});
+}
+
+void config_manager_begin(void)
+{
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    staged_count = 0;
+    batch_task = xTaskGetCurrentTaskHandle();
+}
+
+esp_err_t config_manager_commit(int64_t *duration_us)
+{
+    if (batch_task != xTaskGetCurrentTaskHandle()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t result = ESP_OK;
+    if (staged_count > 0) {
+        nvs_handle_t nvs_handle;
+        result = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+        if (result == ESP_OK) {
+            for (int i = 0; i < staged_count; i++) {
+                esp_err_t err = apply_write(nvs_handle, &staged_writes[i]);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to save %s: %s", staged_writes[i].key,
+                             esp_err_to_name(err));
+                    if (result == ESP_OK) {
+                        result = err;
+                    }
+                }
+            }
+            esp_err_t err = nvs_commit(nvs_handle);
+            if (result == ESP_OK) {
+                result = err;
+            }
+            nvs_close(nvs_handle);
+        }
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "Saved %d setting(s) in %lld us: %s", staged_count, elapsed,
+             esp_err_to_name(result));
+    if (duration_us) {
+        *duration_us = elapsed;
+    }
+
+    staged_count = 0;
+    batch_task = NULL;
+    xSemaphoreGive(batch_mutex);
+    return result;
+}
+
 esp_err_t config_manager_init(void)
 {
     ESP_LOGI(TAG, "Initializing config manager");
 
+    if (!batch_mutex) {
+        batch_mutex = xSemaphoreCreateMutex();
+        if (!batch_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
     nvs_handle_t nvs_handle;
     if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK) {
         // General
@@ -101,6 +248,12 @@ esp_err_t config_manager_init(void)
             ESP_LOGI(TAG, "Loaded display rotation from NVS: %d degrees", display_rotation_deg);
         }
 
+        size_t display_overlay_len = DISPLAY_OVERLAY_SPEC_MAX_LEN;
+        if (nvs_get_str(nvs_handle, NVS_DISPLAY_OVERLAY_KEY, display_overlay,
+                        &display_overlay_len) == ESP_OK) {
+            ESP_LOGI(TAG, "Loaded display overlay from NVS: %s", display_overlay);
+        }
+
         size_t wifi_ssid_len = WIFI_SSID_MAX_LEN;
         if (nvs_get_str(nvs_handle, NVS_WIFI_SSID_KEY, wifi_ssid, &wifi_ssid_len) == ESP_OK) {
             ESP_LOGI(TAG, "Loaded WiFi SSID from NVS: %s", wifi_ssid);
@@ -223,6 +376,11 @@ esp_err_t config_manager_init(void)
                      save_downloaded_images ? "yes" : "no");
         }
 
+        uint8_t stored_prefetch = 0;
+        if (nvs_get_u8(nvs_handle, NVS_PREFETCH_NEXT_KEY, &stored_prefetch) == ESP_OK) {
+            prefetch_next_image = (stored_prefetch != 0);
+        }
+
         // Home Assistant
         size_t ha_url_len = HA_URL_MAX_LEN;
         if (nvs_get_str(nvs_handle, NVS_HA_URL_KEY, ha_url, &ha_url_len) == ESP_OK) {
@@ -297,12 +455,7 @@ void config_manager_set_device_name(const char *name)
     strncpy(device_name, name, DEVICE_NAME_MAX_LEN - 1);
     device_name[DEVICE_NAME_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_DEVICE_NAME_KEY, device_name);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_DEVICE_NAME_KEY, device_name);
 
     ESP_LOGI(TAG, "Device name set to: %s", device_name);
 }
@@ -320,12 +473,7 @@ void config_manager_set_timezone(const char *tz)
     strncpy(tz_string, tz, TIMEZONE_MAX_LEN - 1);
     tz_string[TIMEZONE_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_TIMEZONE_KEY, tz_string);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_TIMEZONE_KEY, tz_string);
 
     ESP_LOGI(TAG, "Timezone set to: %s", tz_string);
 }
@@ -346,12 +494,7 @@ void config_manager_set_ntp_server(const char *server)
     strncpy(ntp_server, server, NTP_SERVER_MAX_LEN - 1);
     ntp_server[NTP_SERVER_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_NTP_SERVER_KEY, ntp_server);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_NTP_SERVER_KEY, ntp_server);
 
     ESP_LOGI(TAG, "NTP server set to: %s", ntp_server);
 }
@@ -368,12 +511,7 @@ void config_manager_set_display_orientation(display_orientation_t orientation)
 {
     display_orientation = orientation;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_DISPLAY_ORIENTATION_KEY, (uint8_t) orientation);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_DISPLAY_ORIENTATION_KEY, (uint8_t) orientation);
 
     ESP_LOGI(TAG, "Display orientation set to: %s",
              orientation == DISPLAY_ORIENTATION_LANDSCAPE ? "landscape" : "portrait");
@@ -388,12 +526,7 @@ void config_manager_set_display_rotation_deg(int rotation_deg)
 {
     display_rotation_deg = rotation_deg;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_i32(nvs_handle, NVS_DISPLAY_ROTATION_DEG_KEY, rotation_deg);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_i32(NVS_DISPLAY_ROTATION_DEG_KEY, rotation_deg);
 
     ESP_LOGI(TAG, "Display rotation set to %d degrees", rotation_deg);
 }
@@ -403,6 +536,29 @@ int config_manager_get_display_rotation_deg(void)
     return display_rotation_deg;
 }
 
+void config_manager_set_display_overlay(const char *spec)
+{
+    if (spec) {
+        strncpy(display_overlay, spec, DISPLAY_OVERLAY_SPEC_MAX_LEN - 1);
+        display_overlay[DISPLAY_OVERLAY_SPEC_MAX_LEN - 1] = '\0';
+    } else {
+        display_overlay[0] = '\0';
+    }
+
+    if (display_overlay[0] != '\0') {
+        config_set_str(NVS_DISPLAY_OVERLAY_KEY, display_overlay);
+    } else {
+        config_erase(NVS_DISPLAY_OVERLAY_KEY);
+    }
+
+    ESP_LOGI(TAG, "Display overlay set to: %s", display_overlay[0] ? display_overlay : "(none)");
+}
+
+const char *config_manager_get_display_overlay(void)
+{
+    return display_overlay;
+}
+
 void config_manager_set_wifi_ssid(const char *ssid)
 {
     if (ssid == NULL) {
@@ -412,12 +568,7 @@ void config_manager_set_wifi_ssid(const char *ssid)
     strncpy(wifi_ssid, ssid, WIFI_SSID_MAX_LEN - 1);
     wifi_ssid[WIFI_SSID_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_WIFI_SSID_KEY, wifi_ssid);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_WIFI_SSID_KEY, wifi_ssid);
 
     ESP_LOGI(TAG, "WiFi SSID set to: %s", wifi_ssid);
 }
@@ -436,12 +587,7 @@ void config_manager_set_wifi_password(const char *password)
     strncpy(wifi_password, password, WIFI_PASS_MAX_LEN - 1);
     wifi_password[WIFI_PASS_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_WIFI_PASS_KEY, wifi_password);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_WIFI_PASS_KEY, wifi_password);
 
     ESP_LOGI(TAG, "WiFi password set (length: %zu)", strlen(wifi_password));
 }
@@ -458,12 +604,7 @@ void config_manager_set_auto_rotate(bool enabled)
 {
     auto_rotate_enabled = enabled;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_AUTO_ROTATE_KEY, enabled ? 1 : 0);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_AUTO_ROTATE_KEY, enabled ? 1 : 0);
 
     ESP_LOGI(TAG, "Auto-rotate %s", enabled ? "enabled" : "disabled");
 }
@@ -477,12 +618,7 @@ void config_manager_set_rotate_interval(int seconds)
 {
     rotate_interval = seconds;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_i32(nvs_handle, NVS_ROTATE_INTERVAL_KEY, seconds);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_i32(NVS_ROTATE_INTERVAL_KEY, seconds);
 
     ESP_LOGI(TAG, "Rotate interval set to %d seconds", seconds);
 }
@@ -496,12 +632,7 @@ void config_manager_set_auto_rotate_aligned(bool enabled)
 {
     auto_rotate_aligned = enabled;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_AUTO_ROTATE_ALIGNED_KEY, enabled ? 1 : 0);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_AUTO_ROTATE_ALIGNED_KEY, enabled ? 1 : 0);
 
     ESP_LOGI(TAG, "Auto-rotate aligned %s", enabled ? "enabled" : "disabled");
 }
@@ -515,12 +646,7 @@ void config_manager_set_sleep_schedule_enabled(bool enabled)
 {
     sleep_schedule_enabled = enabled;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_SLEEP_SCHEDULE_ENABLED_KEY, enabled ? 1 : 0);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_SLEEP_SCHEDULE_ENABLED_KEY, enabled ? 1 : 0);
 
     ESP_LOGI(TAG, "Sleep schedule %s", enabled ? "enabled" : "disabled");
 }
@@ -534,12 +660,7 @@ void config_manager_set_sleep_schedule_start(int minutes)
 {
     sleep_schedule_start = minutes;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_i32(nvs_handle, NVS_SLEEP_SCHEDULE_START_KEY, minutes);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_i32(NVS_SLEEP_SCHEDULE_START_KEY, minutes);
 
     ESP_LOGI(TAG, "Sleep schedule start set to: %d minutes (%02d:%02d)", minutes, minutes / 60,
              minutes % 60);
@@ -554,12 +675,7 @@ void config_manager_set_sleep_schedule_end(int minutes)
 {
     sleep_schedule_end = minutes;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_i32(nvs_handle, NVS_SLEEP_SCHEDULE_END_KEY, minutes);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_i32(NVS_SLEEP_SCHEDULE_END_KEY, minutes);
 
     ESP_LOGI(TAG, "Sleep schedule end set to: %d minutes (%02d:%02d)", minutes, minutes / 60,
              minutes % 60);
@@ -603,12 +719,7 @@ void config_manager_set_rotation_mode(rotation_mode_t mode)
 
     rotation_mode = mode;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_ROTATION_MODE_KEY, (uint8_t) mode);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_ROTATION_MODE_KEY, (uint8_t) mode);
 
     ESP_LOGI(TAG, "Rotation mode set to: %s", mode == ROTATION_MODE_URL ? "url" : "sdcard");
 }
@@ -625,12 +736,7 @@ void config_manager_set_sd_rotation_mode(sd_rotation_mode_t mode)
 {
     sd_rotation_mode = mode;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_SD_ROTATION_MODE_KEY, (uint8_t) mode);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_SD_ROTATION_MODE_KEY, (uint8_t) mode);
 
     ESP_LOGI(TAG, "SD rotation mode set to: %s",
              mode == SD_ROTATION_SEQUENTIAL ? "sequential" : "random");
@@ -645,12 +751,7 @@ void config_manager_set_last_index(int32_t index)
 {
     last_index = index;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_i32(nvs_handle, NVS_LAST_INDEX_KEY, index);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_i32(NVS_LAST_INDEX_KEY, index);
 }
 
 int32_t config_manager_get_last_index(void)
@@ -670,15 +771,10 @@ void config_manager_set_image_url(const char *url)
         image_url[0] = '\0';
     }
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        if (image_url[0] != '\0') {
-            nvs_set_str(nvs_handle, NVS_IMAGE_URL_KEY, image_url);
-        } else {
-            nvs_erase_key(nvs_handle, NVS_IMAGE_URL_KEY);
-        }
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
+    if (image_url[0] != '\0') {
+        config_set_str(NVS_IMAGE_URL_KEY, image_url);
+    } else {
+        config_erase(NVS_IMAGE_URL_KEY);
     }
 
     ESP_LOGI(TAG, "Image URL set to: %s", image_url[0] ? image_url : "(empty)");
@@ -697,12 +793,7 @@ void config_manager_set_access_token(const char *token)
     strncpy(access_token, token, ACCESS_TOKEN_MAX_LEN - 1);
     access_token[ACCESS_TOKEN_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_ACCESS_TOKEN_KEY, access_token);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_ACCESS_TOKEN_KEY, access_token);
 
     ESP_LOGI(TAG, "Access token set (length: %zu)", strlen(access_token));
 }
@@ -720,12 +811,7 @@ void config_manager_set_http_header_key(const char *key)
     strncpy(http_header_key, key, HTTP_HEADER_KEY_MAX_LEN - 1);
     http_header_key[HTTP_HEADER_KEY_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_HTTP_HEADER_KEY_KEY, http_header_key);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_HTTP_HEADER_KEY_KEY, http_header_key);
 
     ESP_LOGI(TAG, "HTTP header key set to: %s", http_header_key);
 }
@@ -743,12 +829,7 @@ void config_manager_set_http_header_value(const char *value)
     strncpy(http_header_value, value, HTTP_HEADER_VALUE_MAX_LEN - 1);
     http_header_value[HTTP_HEADER_VALUE_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_HTTP_HEADER_VALUE_KEY, http_header_value);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_HTTP_HEADER_VALUE_KEY, http_header_value);
 
     ESP_LOGI(TAG, "HTTP header value set (length: %zu)", strlen(http_header_value));
 }
@@ -761,12 +842,7 @@ void config_manager_set_save_downloaded_images(bool enabled)
 {
     save_downloaded_images = enabled;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_SAVE_DOWNLOADED_KEY, enabled ? 1 : 0);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_SAVE_DOWNLOADED_KEY, enabled ? 1 : 0);
 
     ESP_LOGI(TAG, "Save downloaded images %s", enabled ? "enabled" : "disabled");
 }
@@ -775,6 +851,20 @@ bool config_manager_get_save_downloaded_images(void)
 {
     return save_downloaded_images;
 }
+
+void config_manager_set_prefetch_next_image(bool enabled)
+{
+    prefetch_next_image = enabled;
+
+    config_set_u8(NVS_PREFETCH_NEXT_KEY, enabled ? 1 : 0);
+
+    ESP_LOGI(TAG, "Prefetch next image %s", enabled ? "enabled" : "disabled");
+}
+
+bool config_manager_get_prefetch_next_image(void)
+{
+    return prefetch_next_image;
+}
 // ============================================================================
 // Home Assistant
 // ============================================================================
@@ -785,12 +875,7 @@ void config_manager_set_ha_url(const char *url)
         strncpy(ha_url, url, HA_URL_MAX_LEN - 1);
         ha_url[HA_URL_MAX_LEN - 1] = '\0';
 
-        nvs_handle_t nvs_handle;
-        if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-            nvs_set_str(nvs_handle, NVS_HA_URL_KEY, ha_url);
-            nvs_commit(nvs_handle);
-            nvs_close(nvs_handle);
-        }
+        config_set_str(NVS_HA_URL_KEY, ha_url);
 
         ESP_LOGI(TAG, "HA URL set to: %s", ha_url);
     }
@@ -813,12 +898,7 @@ void config_manager_set_openai_api_key(const char *key)
     strncpy(openai_api_key, key, AI_API_KEY_MAX_LEN - 1);
     openai_api_key[AI_API_KEY_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_OPENAI_API_KEY_KEY, openai_api_key);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_OPENAI_API_KEY_KEY, openai_api_key);
 
     ESP_LOGI(TAG, "OpenAI API Key set");
 }
@@ -837,12 +917,7 @@ void config_manager_set_google_api_key(const char *key)
     strncpy(google_api_key, key, AI_API_KEY_MAX_LEN - 1);
     google_api_key[AI_API_KEY_MAX_LEN - 1] = '\0';
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_GOOGLE_API_KEY_KEY, google_api_key);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_str(NVS_GOOGLE_API_KEY_KEY, google_api_key);
 
     ESP_LOGI(TAG, "Google API Key set");
 }
@@ -856,12 +931,7 @@ void config_manager_set_deep_sleep_enabled(bool enabled)
 {
     deep_sleep_enabled = enabled;
 
-    nvs_handle_t nvs_handle;
-    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-        nvs_set_u8(nvs_handle, NVS_DEEP_SLEEP_KEY, enabled ? 1 : 0);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-    }
+    config_set_u8(NVS_DEEP_SLEEP_KEY, enabled ? 1 : 0);
 
     ESP_LOGI(TAG, "Deep sleep %s", enabled ? "enabled" : "disabled");
 }
@@ -2,12 +2,30 @@
 #define CONFIG_MANAGER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "config.h"
 #include "esp_err.h"
 
 esp_err_t config_manager_init(void);
 
+/**
+ * @brief Start a batch of settings that are saved together
+ *
+ * Until config_manager_commit(), setters called from this task update the settings in RAM as
+ * usual but only stage their NVS writes. Setters called from other tasks still save right away.
+ * Waits while another task has a batch open.
+ */
+void config_manager_begin(void);
+
+/**
+ * @brief Write the staged settings to NVS with a single commit and end the batch
+ *
+ * @param duration_us Optional output: time spent writing and committing
+ * @return ESP_OK, or the first NVS error (the remaining settings are still written)
+ */
+esp_err_t config_manager_commit(int64_t *duration_us);
+
 // ============================================================================
 // General
 // ============================================================================
@@ -27,6 +45,11 @@ display_orientation_t config_manager_get_display_orientation(void);
 void config_manager_set_display_rotation_deg(int rotation_deg);
 int config_manager_get_display_rotation_deg(void);
 
+// Overlay stamped on every displayed image, as a JSON array (see display_manager_set_overlay()).
+// An empty string means no overlay.
+void config_manager_set_display_overlay(const char *spec);
+const char *config_manager_get_display_overlay(void);
+
 void config_manager_set_wifi_ssid(const char *ssid);
 const char *config_manager_get_wifi_ssid(void);
 
@@ -88,6 +111,9 @@ const char *config_manager_get_http_header_value(void);
 
 void config_manager_set_save_downloaded_images(bool enabled);
 bool config_manager_get_save_downloaded_images(void);
+// Render the next URL image before sleeping and show it on the following wake
+void config_manager_set_prefetch_next_image(bool enabled);
+bool config_manager_get_prefetch_next_image(void);
 
 // ============================================================================
 // Home Assistant
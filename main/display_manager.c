@@ -4,25 +4,34 @@
 #include <string.h>
 #include <strings.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "GUI_BMPfile.h"
 #include "GUI_PNGfile.h"
 #include "GUI_Paint.h"
 #include "GUI_RawBuffer.h"
+#include "GUI_TextOverlay.h"
 #include "album_manager.h"
 #include "board_hal.h"
+#include "cJSON.h"
 #include "config.h"
 #include "config_manager.h"
 #include "epaper.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "esp_rom_crc.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "metrics.h"
 #include "nvs.h"
 #include "storage.h"
+#include "testable_utils.h"
+#include "timeline.h"
 
 static const char *TAG = "display_manager";
 #define NVS_LAST_IMAGE_KEY "last_image"
@@ -34,6 +43,66 @@ static char last_displayed_image[256] = {0};  // Internal state: last displayed
 static uint8_t *epd_image_buffer = NULL;
 static uint32_t image_buffer_size;
 
+#define DISPLAY_OVERLAY_MAX_ITEMS 8
+#define DISPLAY_OVERLAY_TEXT_MAX 48
+#define DISPLAY_OVERLAY_TRANSPARENT 0xFF
+
+// One text run of the overlay. Negative x/y are measured from the right/bottom edge to the far
+// edge of the text.
+typedef struct {
+    char text[DISPLAY_OVERLAY_TEXT_MAX];
+    int x;
+    int y;
+    uint8_t scale;       // Font magnification (1-8)
+    uint8_t color;       // Panel colour index (EPD_7IN3E_*)
+    uint8_t background;  // Panel colour index, or DISPLAY_OVERLAY_TRANSPARENT
+    uint8_t padding;     // Background box padding in pixels
+} display_overlay_item_t;
+
+// Overlay stamped by every show call. It has its own mutex so it can be changed while a show
+// call holds display_mutex for the panel refresh.
+static SemaphoreHandle_t overlay_mutex = NULL;
+static display_overlay_item_t overlay_items[DISPLAY_OVERLAY_MAX_ITEMS];
+static int overlay_count = 0;
+
+static int parse_overlay_spec(const char *spec, display_overlay_item_t *items);
+
+// Digest of the framebuffer currently shown on the panel. Kept in RTC memory so a wake from
+// deep sleep that renders the same frame can skip the refresh; reset on power-on.
+RTC_DATA_ATTR static uint32_t panel_digest = 0;
+RTC_DATA_ATTR static bool panel_digest_valid = false;
+
+// Random rotation shuffle state, kept across deep sleep: only the seed and position are needed
+// to continue the current cycle (see shuffle_permute_index()).
+RTC_DATA_ATTR static uint32_t shuffle_seed = 0;
+RTC_DATA_ATTR static uint32_t shuffle_cursor = 0;
+RTC_DATA_ATTR static uint32_t shuffle_signature = 0;
+
+// Display job queue. There is only one panel, so a newly submitted job supersedes every job
+// still waiting for it: at most one job is running and one is queued at any time, and the
+// remaining slots keep the status of recently finished jobs.
+#define DISPLAY_JOB_HISTORY 8
+#define DISPLAY_JOB_TASK_STACK 16384  // Jobs may run the full image processing pipeline
+
+typedef struct {
+    uint32_t id;
+    display_job_state_t state;
+    esp_err_t result;
+    uint32_t superseded_by;
+    display_job_callback_t callback;
+    display_job_free_t free_arg;
+    void *arg;
+} display_job_t;
+
+static display_job_t jobs[DISPLAY_JOB_HISTORY];
+static uint32_t next_job_id = 1;
+static TaskHandle_t job_task_handle = NULL;
+static portMUX_TYPE jobs_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t running_job_id = 0;
+
+// Time the last show call spent drawing the image into the framebuffer, 0 if it failed
+static int64_t last_paint_us = 0;
+
 // Load last displayed image from NVS
 static void load_last_displayed_image(void)
 {
@@ -82,6 +151,62 @@ static void create_image_link(const char *target_path)
     }
 }
 
+// Oldest queued job, or NULL. Must be called with jobs_lock held.
+static display_job_t *find_next_queued_job(void)
+{
+    display_job_t *next = NULL;
+    for (int i = 0; i < DISPLAY_JOB_HISTORY; i++) {
+        if (jobs[i].id != 0 && jobs[i].state == DISPLAY_JOB_QUEUED &&
+            (!next || jobs[i].id < next->id)) {
+            next = &jobs[i];
+        }
+    }
+    return next;
+}
+
+static void display_job_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (1) {
+            taskENTER_CRITICAL(&jobs_lock);
+            display_job_t *job = find_next_queued_job();
+            if (!job) {
+                taskEXIT_CRITICAL(&jobs_lock);
+                break;
+            }
+            job->state = DISPLAY_JOB_RUNNING;
+            uint32_t job_id = job->id;
+            display_job_callback_t callback = job->callback;
+            display_job_free_t free_arg = job->free_arg;
+            void *arg = job->arg;
+            taskEXIT_CRITICAL(&jobs_lock);
+
+            ESP_LOGI(TAG, "Running display job %lu", job_id);
+            running_job_id = job_id;
+            int64_t start_time = esp_timer_get_time();
+
+            esp_err_t err = callback(arg);
+            running_job_id = 0;
+            if (free_arg) {
+                free_arg(arg);
+            }
+
+            taskENTER_CRITICAL(&jobs_lock);
+            job->result = err;
+            job->state = (err == ESP_OK) ? DISPLAY_JOB_DONE : DISPLAY_JOB_FAILED;
+            job->callback = NULL;
+            job->free_arg = NULL;
+            job->arg = NULL;
+            taskEXIT_CRITICAL(&jobs_lock);
+
+            ESP_LOGI(TAG, "Display job %lu finished in %lld ms: %s", job_id,
+                     (esp_timer_get_time() - start_time) / 1000, esp_err_to_name(err));
+        }
+    }
+}
+
 esp_err_t display_manager_init(void)
 {
     display_mutex = xSemaphoreCreateMutex();
@@ -90,6 +215,19 @@ esp_err_t display_manager_init(void)
         return ESP_FAIL;
     }
 
+    if (!overlay_mutex) {
+        overlay_mutex = xSemaphoreCreateMutex();
+        if (!overlay_mutex) {
+            ESP_LOGE(TAG, "Failed to create overlay mutex");
+            return ESP_FAIL;
+        }
+    }
+    overlay_count = parse_overlay_spec(config_manager_get_display_overlay(), overlay_items);
+    if (overlay_count < 0) {
+        ESP_LOGW(TAG, "Ignoring invalid overlay in settings");
+        overlay_count = 0;
+    }
+
     // epaper_port_init() is now called by board_hal_init()
 
     image_buffer_size = ((BOARD_HAL_DISPLAY_WIDTH % 2 == 0) ? (BOARD_HAL_DISPLAY_WIDTH / 2)
@@ -103,11 +241,266 @@ esp_err_t display_manager_init(void)
 
     display_manager_initialize_paint();
 
+    if (xTaskCreate(display_job_task, "display_jobs", DISPLAY_JOB_TASK_STACK, NULL, 5,
+                    &job_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create display job task");
+        return ESP_FAIL;
+    }
+
     ESP_LOGI(TAG, "Display manager initialized");
     ESP_LOGI(TAG, "Auto-rotate uses timer-based wake-up (only works during sleep cycles)");
     return ESP_OK;
 }
 
+// Push epd_image_buffer to the panel unless it is identical to what is already shown.
+// Must be called with display_mutex held. Returns true if the panel was refreshed.
+static bool refresh_panel(bool allow_skip)
+{
+    uint32_t digest = esp_rom_crc32_le(0, epd_image_buffer, image_buffer_size);
+
+    if (allow_skip && panel_digest_valid && digest == panel_digest) {
+        ESP_LOGI(TAG, "Framebuffer unchanged (digest %08lx), skipping e-paper refresh", digest);
+        metrics_add(METRICS_DISPLAY_REFRESH_SKIPPED, 1);
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Starting e-paper display update (this takes ~30 seconds)");
+    ESP_LOGI(TAG, "Free heap before epaper_display: %lu bytes", esp_get_free_heap_size());
+
+    // This is a blocking call that takes ~25-30 seconds for 7-color e-paper
+    // It handles: Power On -> Send Data -> Refresh -> Power Off
+    ESP_LOGI(TAG, "Calling epaper_display...");
+    timeline_begin(TIMELINE_DISPLAY);
+    int64_t refresh_start = esp_timer_get_time();
+    epaper_display(epd_image_buffer);
+    metrics_display_refresh(esp_timer_get_time() - refresh_start);
+    timeline_end(TIMELINE_DISPLAY);
+    ESP_LOGI(TAG, "epaper_display returned successfully");
+
+    panel_digest = digest;
+    panel_digest_valid = true;
+    return true;
+}
+
+bool display_manager_get_panel_digest(uint32_t *digest)
+{
+    *digest = panel_digest;
+    return panel_digest_valid;
+}
+
+// Expand {time}, {date} and {battery} in an overlay template
+static void expand_overlay_text(const char *template, char *out, size_t out_size)
+{
+    time_t now;
+    struct tm timeinfo;
+    time(&now);
+    localtime_r(&now, &timeinfo);
+    bool time_valid = timeinfo.tm_year >= (2025 - 1900);
+
+    size_t len = 0;
+    out[0] = '\0';
+    while (*template && len + 1 < out_size) {
+        char value[16];
+        size_t skip = 0;
+
+        if (strncmp(template, "{time}", 6) == 0) {
+            if (time_valid) {
+                strftime(value, sizeof(value), "%H:%M", &timeinfo);
+            } else {
+                strcpy(value, "--:--");
+            }
+            skip = 6;
+        } else if (strncmp(template, "{date}", 6) == 0) {
+            if (time_valid) {
+                strftime(value, sizeof(value), "%Y-%m-%d", &timeinfo);
+            } else {
+                strcpy(value, "----------");
+            }
+            skip = 6;
+        } else if (strncmp(template, "{battery}", 9) == 0) {
+            if (board_hal_is_battery_connected()) {
+                snprintf(value, sizeof(value), "%d%%", board_hal_get_battery_percent());
+            } else {
+                strcpy(value, "--%");
+            }
+            skip = 9;
+        }
+
+        if (skip) {
+            len += strlcpy(out + len, value, out_size - len);
+            if (len >= out_size) {
+                len = out_size - 1;
+            }
+            template += skip;
+        } else {
+            out[len++] = *template++;
+            out[len] = '\0';
+        }
+    }
+}
+
+// Stamp the overlay onto the selected framebuffer. Must be called with display_mutex held.
+static void apply_overlay(void)
+{
+    xSemaphoreTake(overlay_mutex, portMAX_DELAY);
+    if (overlay_count == 0) {
+        xSemaphoreGive(overlay_mutex);
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < overlay_count; i++) {
+        const display_overlay_item_t *item = &overlay_items[i];
+        char text[DISPLAY_OVERLAY_TEXT_MAX + 16];
+        expand_overlay_text(item->text, text, sizeof(text));
+
+        int scale = item->scale ? item->scale : 1;
+        int x = item->x;
+        int y = item->y;
+        if (x < 0) {
+            x += Paint.Width - GUI_TextRunWidth(text, &Font24, scale);
+        }
+        if (y < 0) {
+            y += Paint.Height - Font24.Height * scale;
+        }
+
+        if (GUI_DrawTextRun(x, y, text, &Font24, scale, item->color, item->background,
+                            item->padding) != 0) {
+            ESP_LOGW(TAG, "Failed to draw overlay text '%s'", text);
+        }
+    }
+    ESP_LOGI(TAG, "Stamped %d overlay item(s) in %lld us", overlay_count,
+             esp_timer_get_time() - start);
+    xSemaphoreGive(overlay_mutex);
+}
+
+static bool parse_overlay_color(const cJSON *item, const char *key, uint8_t *color)
+{
+    static const struct {
+        const char *name;
+        uint8_t index;
+    } colors[] = {
+        {"black", EPD_7IN3E_BLACK}, {"white", EPD_7IN3E_WHITE}, {"yellow", EPD_7IN3E_YELLOW},
+        {"red", EPD_7IN3E_RED},     {"blue", EPD_7IN3E_BLUE},   {"green", EPD_7IN3E_GREEN},
+        {"none", DISPLAY_OVERLAY_TRANSPARENT},
+    };
+
+    const cJSON *value = cJSON_GetObjectItem(item, key);
+    if (!value) {
+        return true;  // Keep the default
+    }
+    if (!cJSON_IsString(value)) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(colors) / sizeof(colors[0]); i++) {
+        if (strcasecmp(value->valuestring, colors[i].name) == 0) {
+            *color = colors[i].index;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parse an overlay spec (see display_manager_set_overlay()). An empty spec is no overlay.
+// Returns the number of items, or -1 if the spec is malformed.
+static int parse_overlay_spec(const char *spec, display_overlay_item_t *items)
+{
+    if (!spec || spec[0] == '\0') {
+        return 0;
+    }
+
+    cJSON *overlay = cJSON_Parse(spec);
+    if (!cJSON_IsArray(overlay) || cJSON_GetArraySize(overlay) > DISPLAY_OVERLAY_MAX_ITEMS) {
+        cJSON_Delete(overlay);
+        return -1;
+    }
+
+    int count = 0;
+    const cJSON *entry;
+    cJSON_ArrayForEach(entry, overlay)
+    {
+        display_overlay_item_t *item = &items[count];
+        const cJSON *text = cJSON_GetObjectItem(entry, "text");
+        if (!cJSON_IsString(text) || strlen(text->valuestring) >= sizeof(item->text)) {
+            count = -1;
+            break;
+        }
+
+        memset(item, 0, sizeof(*item));
+        strlcpy(item->text, text->valuestring, sizeof(item->text));
+        item->scale = 2;
+        item->color = EPD_7IN3E_WHITE;
+        item->background = DISPLAY_OVERLAY_TRANSPARENT;
+        item->padding = 4;
+
+        const cJSON *value;
+        if ((value = cJSON_GetObjectItem(entry, "x")) && cJSON_IsNumber(value)) {
+            item->x = value->valueint;
+        }
+        if ((value = cJSON_GetObjectItem(entry, "y")) && cJSON_IsNumber(value)) {
+            item->y = value->valueint;
+        }
+        if ((value = cJSON_GetObjectItem(entry, "scale")) && cJSON_IsNumber(value)) {
+            if (value->valueint < 1 || value->valueint > 8) {
+                count = -1;
+                break;
+            }
+            item->scale = value->valueint;
+        }
+        if ((value = cJSON_GetObjectItem(entry, "padding")) && cJSON_IsNumber(value)) {
+            item->padding = value->valueint < 0 ? 0 : (value->valueint > 32 ? 32 : value->valueint);
+        }
+        if (!parse_overlay_color(entry, "color", &item->color) ||
+            item->color == DISPLAY_OVERLAY_TRANSPARENT ||
+            !parse_overlay_color(entry, "background", &item->background)) {
+            count = -1;
+            break;
+        }
+        count++;
+    }
+    cJSON_Delete(overlay);
+    return count;
+}
+
+esp_err_t display_manager_set_overlay(const char *spec)
+{
+    if (!overlay_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (spec && strlen(spec) >= DISPLAY_OVERLAY_SPEC_MAX_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    display_overlay_item_t items[DISPLAY_OVERLAY_MAX_ITEMS];
+    int count = parse_overlay_spec(spec, items);
+    if (count < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(overlay_mutex, portMAX_DELAY);
+    memcpy(overlay_items, items, count * sizeof(items[0]));
+    overlay_count = count;
+    xSemaphoreGive(overlay_mutex);
+
+    config_manager_set_display_overlay(count > 0 ? spec : "");
+    return ESP_OK;
+}
+
+bool display_manager_overlay_has_placeholders(void)
+{
+    if (!overlay_mutex) {
+        return false;
+    }
+
+    bool found = false;
+    xSemaphoreTake(overlay_mutex, portMAX_DELAY);
+    for (int i = 0; i < overlay_count && !found; i++) {
+        found = strchr(overlay_items[i].text, '{') != NULL;
+    }
+    xSemaphoreGive(overlay_mutex);
+    return found;
+}
+
 void display_manager_initialize_paint(void)
 {
     Paint_NewImage(epd_image_buffer, BOARD_HAL_DISPLAY_WIDTH, BOARD_HAL_DISPLAY_HEIGHT,
@@ -116,7 +509,23 @@ void display_manager_initialize_paint(void)
     Paint_SelectImage(epd_image_buffer);
 }
 
-esp_err_t display_manager_show_image(const char *filename)
+static void paint_done(int64_t start_us)
+{
+    last_paint_us = esp_timer_get_time() - start_us;
+    metrics_image_stage(IMAGE_STAGE_PAINT, last_paint_us);
+}
+
+int64_t display_manager_get_last_paint_us(void)
+{
+    return last_paint_us;
+}
+
+uint32_t display_manager_get_running_job_id(void)
+{
+    return running_job_id;
+}
+
+esp_err_t display_manager_show_image(const char *filename, bool force_refresh)
 {
     if (!filename || strlen(filename) == 0) {
         return ESP_ERR_INVALID_ARG;
@@ -132,6 +541,8 @@ esp_err_t display_manager_show_image(const char *filename)
     ESP_LOGI(TAG, "Free heap before display: %lu bytes", esp_get_free_heap_size());
 
     ESP_LOGI(TAG, "Clearing display buffer");
+    last_paint_us = 0;
+    int64_t paint_start = esp_timer_get_time();
     Paint_Clear(EPD_7IN3E_WHITE);
 
     // Detect file type by extension
@@ -153,19 +564,15 @@ esp_err_t display_manager_show_image(const char *filename)
             return ESP_FAIL;
         }
     }
+    paint_done(paint_start);
 
-    ESP_LOGI(TAG, "Starting e-paper display update (this takes ~30 seconds)");
-    ESP_LOGI(TAG, "Free heap before epaper_display: %lu bytes", esp_get_free_heap_size());
+    apply_overlay();
 
     // 4. Update E-Paper Display
-    // This is a blocking call that takes ~25-30 seconds for 7-color e-paper
-    // It handles: Power On -> Send Data -> Refresh -> Power Off
-    ESP_LOGI(TAG, "Calling epaper_display...");
-    epaper_display(epd_image_buffer);
-    ESP_LOGI(TAG, "epaper_display returned successfully");
-
-    ESP_LOGI(TAG, "E-paper display update complete");
-    ESP_LOGI(TAG, "Free heap after display: %lu bytes", esp_get_free_heap_size());
+    if (refresh_panel(!force_refresh)) {
+        ESP_LOGI(TAG, "E-paper display update complete");
+        ESP_LOGI(TAG, "Free heap after display: %lu bytes", esp_get_free_heap_size());
+    }
 
     strncpy(current_image, filename, sizeof(current_image) - 1);
 
@@ -178,7 +585,8 @@ esp_err_t display_manager_show_image(const char *filename)
     return ESP_OK;
 }
 
-esp_err_t display_manager_show_rgb_buffer(const uint8_t *rgb_buffer, int width, int height)
+esp_err_t display_manager_show_rgb_buffer(const uint8_t *rgb_buffer, int width, int height,
+                                          bool force_refresh)
 {
     if (!rgb_buffer || width <= 0 || height <= 0) {
         return ESP_ERR_INVALID_ARG;
@@ -193,6 +601,8 @@ esp_err_t display_manager_show_rgb_buffer(const uint8_t *rgb_buffer, int width,
     ESP_LOGI(TAG, "Free heap before display: %lu bytes", esp_get_free_heap_size());
 
     ESP_LOGI(TAG, "Clearing display buffer");
+    last_paint_us = 0;
+    int64_t paint_start = esp_timer_get_time();
     Paint_Clear(EPD_7IN3E_WHITE);
 
     ESP_LOGI(TAG, "Painting RGB buffer to display");
@@ -201,16 +611,14 @@ esp_err_t display_manager_show_rgb_buffer(const uint8_t *rgb_buffer, int width,
         xSemaphoreGive(display_mutex);
         return ESP_FAIL;
     }
+    paint_done(paint_start);
 
-    ESP_LOGI(TAG, "Starting e-paper display update (this takes ~30 seconds)");
-    ESP_LOGI(TAG, "Free heap before epaper_display: %lu bytes", esp_get_free_heap_size());
+    apply_overlay();
 
-    ESP_LOGI(TAG, "Calling epaper_display...");
-    epaper_display(epd_image_buffer);
-    ESP_LOGI(TAG, "epaper_display returned successfully");
-
-    ESP_LOGI(TAG, "E-paper display update complete");
-    ESP_LOGI(TAG, "Free heap after display: %lu bytes", esp_get_free_heap_size());
+    if (refresh_panel(!force_refresh)) {
+        ESP_LOGI(TAG, "E-paper display update complete");
+        ESP_LOGI(TAG, "Free heap after display: %lu bytes", esp_get_free_heap_size());
+    }
 
     // Clear current_image since we displayed from buffer, not file
     current_image[0] = '\0';
@@ -221,6 +629,86 @@ esp_err_t display_manager_show_rgb_buffer(const uint8_t *rgb_buffer, int width,
     return ESP_OK;
 }
 
+esp_err_t display_manager_render_image(const char *filename, uint8_t **frame)
+{
+    if (!filename || !frame) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t *buffer = heap_caps_malloc(image_buffer_size, MALLOC_CAP_SPIRAM);
+    if (!buffer) {
+        ESP_LOGE(TAG, "Failed to allocate render buffer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Paint is shared with the panel framebuffer, so wait out a refresh that may be running
+    if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(60000)) != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to acquire display mutex for rendering");
+        heap_caps_free(buffer);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Rendering %s off-screen", filename);
+    Paint_SelectImage(buffer);
+    Paint_Clear(EPD_7IN3E_WHITE);
+
+    const char *ext = strrchr(filename, '.');
+    int ret;
+    if (ext != NULL && strcasecmp(ext, ".png") == 0) {
+        ret = GUI_ReadPng_RGB_6Color(filename, 0, 0);
+    } else {
+        ret = GUI_ReadBmp_RGB_6Color(filename, 0, 0);
+    }
+
+    Paint_SelectImage(epd_image_buffer);
+    xSemaphoreGive(display_mutex);
+
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to render %s", filename);
+        heap_caps_free(buffer);
+        return ESP_FAIL;
+    }
+
+    *frame = buffer;
+    return ESP_OK;
+}
+
+size_t display_manager_get_frame_size(void)
+{
+    return image_buffer_size;
+}
+
+esp_err_t display_manager_show_packed_frame(uint8_t **frame, bool force_refresh)
+{
+    if (!frame || !*frame) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to acquire display mutex");
+        return ESP_FAIL;
+    }
+
+    // The frame is already in panel format: adopt it as the framebuffer instead of copying it
+    uint8_t *previous = epd_image_buffer;
+    epd_image_buffer = *frame;
+    *frame = previous;
+    Paint_SelectImage(epd_image_buffer);
+
+    apply_overlay();
+
+    if (refresh_panel(!force_refresh)) {
+        ESP_LOGI(TAG, "E-paper display update complete");
+    }
+
+    current_image[0] = '\0';
+
+    xSemaphoreGive(display_mutex);
+
+    ESP_LOGI(TAG, "Packed frame displayed successfully");
+    return ESP_OK;
+}
+
 esp_err_t display_manager_clear(void)
 {
     if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
@@ -228,7 +716,7 @@ esp_err_t display_manager_clear(void)
     }
 
     epaper_clear(epd_image_buffer, EPD_7IN3E_WHITE);
-    epaper_display(epd_image_buffer);
+    refresh_panel(false);
 
     // Remove the current image link so API returns 404
     unlink(CURRENT_IMAGE_LINK);
@@ -255,7 +743,7 @@ esp_err_t display_manager_show_calibration(void)
     Paint_DrawCalibrationPattern();
 
     // Display the buffer
-    epaper_display(epd_image_buffer);
+    refresh_panel(false);
 
     xSemaphoreGive(display_mutex);
 
@@ -369,7 +857,7 @@ esp_err_t display_manager_show_setup_screen(void)
     }
 
     // Display the buffer
-    epaper_display(epd_image_buffer);
+    refresh_panel(false);
 
     xSemaphoreGive(display_mutex);
 
@@ -394,202 +882,307 @@ const char *display_manager_get_current_image(void)
     return current_image;
 }
 
-static void rotate_sequential(char **enabled_albums, int album_count)
+void display_manager_current_image_moved(const char *old_path, const char *new_path)
 {
-    ESP_LOGI(TAG, "Sequential rotation mode");
-    int32_t last_idx = config_manager_get_last_index();
-    int32_t target_idx = last_idx + 1;
-    int32_t current_idx = 0;
-    char first_image[512] = {0};
-    bool found_target = false;
+    if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGW(TAG, "Could not update current image after move to %s", new_path);
+        return;
+    }
+    // Only if nothing else was displayed in the meantime
+    if (strcmp(current_image, old_path) == 0) {
+        snprintf(current_image, sizeof(current_image), "%s", new_path);
+        create_image_link(new_path);
+    }
+    xSemaphoreGive(display_mutex);
+}
 
-    for (int i = 0; i < album_count; i++) {
-        char album_path[256];
-        album_manager_get_album_path(enabled_albums[i], album_path, sizeof(album_path));
-
-        DIR *dir = opendir(album_path);
-        if (!dir) {
-            continue;
-        }
-
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (entry->d_type == DT_REG) {
-                if (entry->d_name[0] == '.' && entry->d_name[1] == '_') {
-                    continue;
-                }
-
-                const char *ext = strrchr(entry->d_name, '.');
-                if (ext && (strcmp(ext, ".bmp") == 0 || strcmp(ext, ".BMP") == 0 ||
-                            strcmp(ext, ".png") == 0 || strcmp(ext, ".PNG") == 0)) {
-                    char fullpath[512];
-                    snprintf(fullpath, sizeof(fullpath), "%s/%s", album_path, entry->d_name);
-                    ESP_LOGD(TAG, "  Found image [%ld]: %s", (long) current_idx, fullpath);
-
-                    // Keep track of the very first image in case we need to wrap
-                    if (first_image[0] == '\0') {
-                        strncpy(first_image, fullpath, sizeof(first_image) - 1);
-                    }
-
-                    if (current_idx == target_idx) {
-                        ESP_LOGI(TAG, "Found target index %ld: %s", (long) target_idx, fullpath);
-                        display_manager_show_image(fullpath);
-                        save_last_displayed_image(fullpath);
-                        config_manager_set_last_index(target_idx);
-                        found_target = true;
-                        closedir(dir);
-                        return;
-                    }
-                    current_idx++;
-                }
-            }
+esp_err_t display_manager_submit_job(display_job_callback_t callback, void *arg,
+                                     display_job_free_t free_arg, uint32_t *job_id)
+{
+    if (!callback) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!job_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Jobs superseded by this one; their arguments are released outside the critical section
+    display_job_free_t superseded_free[DISPLAY_JOB_HISTORY];
+    void *superseded_args[DISPLAY_JOB_HISTORY];
+    int superseded_count = 0;
+
+    taskENTER_CRITICAL(&jobs_lock);
+
+    uint32_t id = next_job_id++;
+
+    // Only the most recent request is rendered once the panel is free
+    for (int i = 0; i < DISPLAY_JOB_HISTORY; i++) {
+        if (jobs[i].id != 0 && jobs[i].state == DISPLAY_JOB_QUEUED) {
+            superseded_free[superseded_count] = jobs[i].free_arg;
+            superseded_args[superseded_count] = jobs[i].arg;
+            superseded_count++;
+
+            jobs[i].state = DISPLAY_JOB_SUPERSEDED;
+            jobs[i].superseded_by = id;
+            jobs[i].callback = NULL;
+            jobs[i].free_arg = NULL;
+            jobs[i].arg = NULL;
         }
-        closedir(dir);
     }
 
-    ESP_LOGI(
-        TAG,
-        "Sequential rotation finished traversal. current_idx=%ld, target_idx=%ld, found_target=%d",
-        (long) current_idx, (long) target_idx, found_target);
+    // Reuse the oldest slot that isn't running (nothing is queued any more)
+    display_job_t *job = NULL;
+    for (int i = 0; i < DISPLAY_JOB_HISTORY; i++) {
+        if (jobs[i].state != DISPLAY_JOB_RUNNING && (!job || jobs[i].id < job->id)) {
+            job = &jobs[i];
+        }
+    }
 
-    // If we reached here, we didn't find the target index (or the list has changed and is
-    // shorter) Wrap around to the first image
-    if (!found_target) {
-        if (first_image[0] != '\0') {
-            ESP_LOGI(TAG, "Wrapping around to start. Displaying: %s", first_image);
-            display_manager_show_image(first_image);
-            save_last_displayed_image(first_image);
-            config_manager_set_last_index(0);  // Reset index to 0
-        } else {
-            ESP_LOGW(TAG, "No images found in any enabled albums.");
+    job->id = id;
+    job->state = DISPLAY_JOB_QUEUED;
+    job->result = ESP_OK;
+    job->superseded_by = 0;
+    job->callback = callback;
+    job->free_arg = free_arg;
+    job->arg = arg;
+
+    taskEXIT_CRITICAL(&jobs_lock);
+
+    for (int i = 0; i < superseded_count; i++) {
+        if (superseded_free[i]) {
+            superseded_free[i](superseded_args[i]);
         }
     }
+
+    if (superseded_count > 0) {
+        ESP_LOGI(TAG, "Queued display job %lu (superseded %d pending job(s))", id,
+                 superseded_count);
+    } else {
+        ESP_LOGI(TAG, "Queued display job %lu", id);
+    }
+
+    xTaskNotifyGive(job_task_handle);
+
+    if (job_id) {
+        *job_id = id;
+    }
+    return ESP_OK;
 }
 
-static void rotate_random(char **enabled_albums, int album_count)
+esp_err_t display_manager_get_job_status(uint32_t job_id, display_job_status_t *status)
 {
-    ESP_LOGI(TAG, "Random rotation mode");
+    if (!status || job_id == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    // Count total images across all enabled albums
-    int total_image_count = 0;
-    for (int i = 0; i < album_count; i++) {
-        char album_path[256];
-        album_manager_get_album_path(enabled_albums[i], album_path, sizeof(album_path));
-
-        DIR *dir = opendir(album_path);
-        if (!dir) {
-            ESP_LOGW(TAG, "Failed to open album: %s", enabled_albums[i]);
-            continue;
-        }
-
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (entry->d_type == DT_REG) {
-                if (entry->d_name[0] == '.' && entry->d_name[1] == '_') {
-                    continue;
-                }
-                const char *ext = strrchr(entry->d_name, '.');
-                if (ext && (strcmp(ext, ".bmp") == 0 || strcmp(ext, ".BMP") == 0 ||
-                            strcmp(ext, ".png") == 0 || strcmp(ext, ".PNG") == 0)) {
-                    total_image_count++;
-                }
-            }
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    taskENTER_CRITICAL(&jobs_lock);
+    for (int i = 0; i < DISPLAY_JOB_HISTORY; i++) {
+        if (jobs[i].id == job_id) {
+            status->id = jobs[i].id;
+            status->state = jobs[i].state;
+            status->result = jobs[i].result;
+            status->superseded_by = jobs[i].superseded_by;
+            ret = ESP_OK;
+            break;
         }
-        closedir(dir);
     }
+    taskEXIT_CRITICAL(&jobs_lock);
 
-    if (total_image_count == 0) {
-        ESP_LOGW(TAG, "No images found in enabled albums");
-        return;
+    return ret;
+}
+
+uint32_t display_manager_get_last_job_id(void)
+{
+    taskENTER_CRITICAL(&jobs_lock);
+    uint32_t id = next_job_id - 1;
+    taskEXIT_CRITICAL(&jobs_lock);
+    return id;
+}
+
+const char *display_manager_job_state_to_string(display_job_state_t state)
+{
+    switch (state) {
+    case DISPLAY_JOB_QUEUED:
+        return "queued";
+    case DISPLAY_JOB_RUNNING:
+        return "running";
+    case DISPLAY_JOB_DONE:
+        return "done";
+    case DISPLAY_JOB_FAILED:
+        return "failed";
+    case DISPLAY_JOB_SUPERSEDED:
+        return "superseded";
+    default:
+        return "unknown";
     }
+}
 
-    // Build image list with absolute paths from all enabled albums
-    char **image_list = malloc(total_image_count * sizeof(char *));
-    if (!image_list) {
-        ESP_LOGE(TAG, "Failed to allocate image list");
-        return;
+// Resolve a global image index across the enabled albums (in album order) to an absolute path,
+// using the album indexes. Returns the total number of images, or 0 if there are none.
+static int resolve_image_index(char **enabled_albums, int album_count, int32_t image_idx,
+                               char *path, size_t path_len)
+{
+    int total = 0;
+    int *counts = calloc(album_count, sizeof(int));
+    if (!counts) {
+        return 0;
     }
-    int idx = 0;
 
     for (int i = 0; i < album_count; i++) {
-        char album_path[256];
-        album_manager_get_album_path(enabled_albums[i], album_path, sizeof(album_path));
-
-        DIR *dir = opendir(album_path);
-        if (!dir) {
-            continue;
-        }
-
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL && idx < total_image_count) {
-            if (entry->d_type == DT_REG) {
-                if (entry->d_name[0] == '.' && entry->d_name[1] == '_') {
-                    continue;
-                }
-
-                const char *ext = strrchr(entry->d_name, '.');
-                if (ext && (strcmp(ext, ".bmp") == 0 || strcmp(ext, ".BMP") == 0 ||
-                            strcmp(ext, ".png") == 0 || strcmp(ext, ".PNG") == 0)) {
-                    char *fullpath = malloc(512);
-                    if (!fullpath) {
-                        ESP_LOGE(TAG, "Failed to allocate path buffer");
-                        continue;
-                    }
-                    snprintf(fullpath, 512, "%s/%s", album_path, entry->d_name);
-                    image_list[idx] = fullpath;
-                    idx++;
-                }
+        if (album_manager_index_get_count(enabled_albums[i], &counts[i]) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to read index of album: %s", enabled_albums[i]);
+            counts[i] = 0;
+        }
+        total += counts[i];
+    }
+
+    if (total > 0 && image_idx >= 0 && image_idx < total) {
+        for (int i = 0; i < album_count; i++) {
+            if (image_idx >= counts[i]) {
+                image_idx -= counts[i];
+                continue;
             }
+
+            album_index_entry_t entry;
+            int read = 0;
+            char album_path[256];
+            if (album_manager_index_read(enabled_albums[i], image_idx, &entry, 1, &read) ==
+                    ESP_OK &&
+                read == 1 &&
+                album_manager_get_album_path(enabled_albums[i], album_path,
+                                             sizeof(album_path)) == ESP_OK) {
+                snprintf(path, path_len, "%s/%s", album_path, entry.filename);
+            } else {
+                path[0] = '\0';
+            }
+            break;
         }
-        closedir(dir);
     }
 
-    // Update total_image_count to actual number of images found
-    total_image_count = idx;
+    free(counts);
+    return total;
+}
+
+// Like resolve_image_index(), but if the entry no longer exists on disk (e.g. it was deleted
+// behind our back), discard the album indexes and resolve again from a fresh scan.
+static int resolve_existing_image_index(char **enabled_albums, int album_count, int32_t image_idx,
+                                        char *path, size_t path_len)
+{
+    path[0] = '\0';
+    int total = resolve_image_index(enabled_albums, album_count, image_idx, path, path_len);
+
+    struct stat st;
+    if (total > 0 && image_idx >= 0 && image_idx < total &&
+        (path[0] == '\0' || stat(path, &st) != 0)) {
+        ESP_LOGW(TAG, "Album index out of date (%s missing), rebuilding", path);
+        for (int i = 0; i < album_count; i++) {
+            album_manager_index_invalidate(enabled_albums[i]);
+        }
+        path[0] = '\0';
+        total = resolve_image_index(enabled_albums, album_count, image_idx, path, path_len);
+    }
+    return total;
+}
+
+static void rotate_sequential(char **enabled_albums, int album_count)
+{
+    ESP_LOGI(TAG, "Sequential rotation mode");
+    int32_t target_idx = config_manager_get_last_index() + 1;
+    char fullpath[512];
 
-    if (total_image_count == 0) {
-        ESP_LOGW(TAG, "No displayable images found in enabled albums");
-        free(image_list);
+    int total = resolve_existing_image_index(enabled_albums, album_count, target_idx, fullpath,
+                                             sizeof(fullpath));
+    if (total == 0) {
+        ESP_LOGW(TAG, "No images found in any enabled albums.");
         return;
     }
 
-    // Load last displayed image if not already loaded
-    if (last_displayed_image[0] == '\0') {
-        load_last_displayed_image();
+    // Wrap around to the first image once we run past the end (or the library shrank)
+    if (target_idx < 0 || target_idx >= total || fullpath[0] == '\0') {
+        ESP_LOGI(TAG, "Sequential rotation reached the end (%d images), wrapping around", total);
+        target_idx = 0;
+        total = resolve_existing_image_index(enabled_albums, album_count, target_idx, fullpath,
+                                             sizeof(fullpath));
+        if (total == 0 || fullpath[0] == '\0') {
+            ESP_LOGW(TAG, "No images found in any enabled albums.");
+            return;
+        }
     }
 
-    // Select random image, avoiding the last displayed image if possible
-    int random_index = esp_random() % total_image_count;
+    ESP_LOGI(TAG, "Displaying image %ld/%d: %s", (long) target_idx + 1, total, fullpath);
+    display_manager_show_image(fullpath, false);
+    save_last_displayed_image(fullpath);
+    config_manager_set_last_index(target_idx);
+}
 
-    // If we have more than one image and the random selection matches the last image,
-    // try to pick a different one (up to 10 attempts)
-    if (total_image_count > 1 && last_displayed_image[0] != '\0') {
-        int attempts = 0;
-        while (attempts < 10 && strcmp(image_list[random_index], last_displayed_image) == 0) {
-            random_index = esp_random() % total_image_count;
-            attempts++;
+// Identifies the set of images the shuffle was built for: the enabled albums and their total
+// image count. Any change starts a new shuffle cycle.
+static uint32_t shuffle_library_signature(char **enabled_albums, int album_count, int total)
+{
+    uint32_t signature = esp_rom_crc32_le(0, (const uint8_t *) &total, sizeof(total));
+    for (int i = 0; i < album_count; i++) {
+        signature = esp_rom_crc32_le(signature, (const uint8_t *) enabled_albums[i],
+                                     strlen(enabled_albums[i]) + 1);
+    }
+    return signature;
+}
+
+static void rotate_random(char **enabled_albums, int album_count)
+{
+    ESP_LOGI(TAG, "Random rotation mode");
+
+    char fullpath[512];
+    int total = resolve_image_index(enabled_albums, album_count, -1, fullpath, sizeof(fullpath));
+    if (total == 0) {
+        ESP_LOGW(TAG, "No images found in enabled albums");
+        return;
+    }
+
+    uint32_t signature = shuffle_library_signature(enabled_albums, album_count, total);
+    if (shuffle_seed == 0 || shuffle_signature != signature || shuffle_cursor >= (uint32_t) total) {
+        // Load last displayed image if not already loaded
+        if (last_displayed_image[0] == '\0') {
+            load_last_displayed_image();
         }
 
-        if (strcmp(image_list[random_index], last_displayed_image) == 0) {
-            ESP_LOGW(TAG, "Could not avoid repeating last image after 10 attempts");
-        } else {
-            ESP_LOGI(TAG, "Successfully avoided repeating last image");
+        // Start a new cycle, avoiding opening it with the image that closed the previous one
+        for (int attempt = 0; attempt < 4; attempt++) {
+            shuffle_seed = esp_random() | 1;
+            if (total == 1 || last_displayed_image[0] == '\0') {
+                break;
+            }
+            resolve_image_index(enabled_albums, album_count,
+                                shuffle_permute_index(0, total, shuffle_seed), fullpath,
+                                sizeof(fullpath));
+            if (strcmp(fullpath, last_displayed_image) != 0) {
+                break;
+            }
         }
+        shuffle_signature = signature;
+        shuffle_cursor = 0;
+        ESP_LOGI(TAG, "Starting new shuffle cycle over %d image(s)", total);
+    }
+
+    int32_t image_idx = shuffle_permute_index(shuffle_cursor, total, shuffle_seed);
+    total = resolve_existing_image_index(enabled_albums, album_count, image_idx, fullpath,
+                                         sizeof(fullpath));
+    if (total == 0 || fullpath[0] == '\0') {
+        // The library changed under us; the signature check restarts the cycle next time
+        ESP_LOGW(TAG, "Shuffled image %ld no longer exists", (long) image_idx);
+        shuffle_seed = 0;
+        return;
     }
+    shuffle_cursor++;
 
-    // Display random image
-    ESP_LOGI(TAG, "Auto-rotate: Displaying random image %d/%d: %s", random_index + 1,
-             total_image_count, image_list[random_index]);
-    display_manager_show_image(image_list[random_index]);
+    ESP_LOGI(TAG, "Auto-rotate: Displaying shuffled image %lu/%d: %s",
+             (unsigned long) shuffle_cursor, total, fullpath);
+    display_manager_show_image(fullpath, false);
 
     // Store the displayed image filename in NVS
-    save_last_displayed_image(image_list[random_index]);
-
-    // Free image list
-    for (int i = 0; i < total_image_count; i++) {
-        free(image_list[i]);
-    }
-    free(image_list);
+    save_last_displayed_image(fullpath);
 }
 
 void display_manager_rotate_from_storage(void)
@@ -7,8 +7,49 @@
 
 #include "esp_err.h"
 
+/**
+ * @brief Lifecycle of a queued display job
+ */
+typedef enum {
+    DISPLAY_JOB_QUEUED,
+    DISPLAY_JOB_RUNNING,
+    DISPLAY_JOB_DONE,
+    DISPLAY_JOB_FAILED,
+    DISPLAY_JOB_SUPERSEDED,  // Replaced by a newer request before it started
+} display_job_state_t;
+
+/**
+ * @brief Display job callback, executed on the display job task
+ *
+ * @param arg Argument passed to display_manager_submit_job()
+ * @return ESP_OK if the job completed successfully, error code otherwise
+ */
+typedef esp_err_t (*display_job_callback_t)(void *arg);
+
+/**
+ * @brief Release function for a job argument, called once the job is finished
+ */
+typedef void (*display_job_free_t)(void *arg);
+
+/**
+ * @brief Snapshot of a display job's status
+ */
+typedef struct {
+    uint32_t id;
+    display_job_state_t state;
+    esp_err_t result;        // Result of the callback (valid once DONE or FAILED)
+    uint32_t superseded_by;  // Id of the job that replaced this one (SUPERSEDED only)
+} display_job_status_t;
+
 esp_err_t display_manager_init(void);
-esp_err_t display_manager_show_image(const char *filename);
+/**
+ * @brief Show a PNG or BMP file
+ *
+ * The ~30 second refresh is skipped when the rendered framebuffer is identical
+ * to what the panel already shows, unless @p force_refresh is set (e.g. to
+ * clean up ghosting).
+ */
+esp_err_t display_manager_show_image(const char *filename, bool force_refresh);
 
 esp_err_t display_manager_show_calibration(void);
 esp_err_t display_manager_clear(void);
@@ -16,6 +57,14 @@ esp_err_t display_manager_show_setup_screen(void);
 bool display_manager_is_busy(void);
 void display_manager_rotate_from_storage(void);
 const char *display_manager_get_current_image(void);
+
+/**
+ * @brief Follow the displayed image file to a new location
+ *
+ * For callers that move the file after showing it (e.g. into the Downloads album). Does nothing
+ * if another image has been displayed since.
+ */
+void display_manager_current_image_moved(const char *old_path, const char *new_path);
 void display_manager_initialize_paint(void);
 
 /**
@@ -28,8 +77,122 @@ void display_manager_initialize_paint(void);
  * @param rgb_buffer RGB888 buffer (3 bytes per pixel, already dithered to palette)
  * @param width Image width
  * @param height Image height
+ * @param force_refresh Refresh even if the panel already shows this frame
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t display_manager_show_rgb_buffer(const uint8_t *rgb_buffer, int width, int height,
+                                          bool force_refresh);
+
+/**
+ * @brief Display a framebuffer that is already in panel format
+ *
+ * @p *frame must be a PSRAM buffer of the panel framebuffer size, e.g. from
+ * raw_frame_decoder_finish(). It becomes the display framebuffer without being
+ * copied; in exchange *frame receives the previous framebuffer, which the caller
+ * frees with heap_caps_free().
+ *
+ * @param frame In: frame to show. Out: buffer to release.
+ * @param force_refresh Refresh even if the panel already shows this frame
  * @return esp_err_t ESP_OK on success
  */
-esp_err_t display_manager_show_rgb_buffer(const uint8_t *rgb_buffer, int width, int height);
+esp_err_t display_manager_show_packed_frame(uint8_t **frame, bool force_refresh);
+
+/**
+ * @brief Render a PNG or BMP file into a new framebuffer without displaying it
+ *
+ * Produces the same framebuffer display_manager_show_image() would, for later
+ * use with display_manager_show_packed_frame(). Waits for a refresh in progress.
+ *
+ * @param filename Image to render
+ * @param frame Output: framebuffer of display_manager_get_frame_size() bytes,
+ *              freed with heap_caps_free()
+ */
+esp_err_t display_manager_render_image(const char *filename, uint8_t **frame);
+
+/**
+ * @brief Size in bytes of the panel framebuffer
+ */
+size_t display_manager_get_frame_size(void);
+
+/**
+ * @brief CRC of the framebuffer the panel currently shows
+ *
+ * Survives deep sleep. Lets callers tell whether the panel still shows an image
+ * they displayed earlier.
+ *
+ * @return false if unknown (e.g. after power-on)
+ */
+bool display_manager_get_panel_digest(uint32_t *digest);
+
+/**
+ * @brief Set the text stamped on top of every displayed image
+ *
+ * Applies to every show call from the next one on (files, RGB buffers and
+ * packed frames alike) and is saved in NVS. @p spec is a JSON array of up to
+ * 8 items such as {"text": "{time}", "x": 20, "y": -20, "scale": 3,
+ * "color": "white", "background": "black", "padding": 4}; see docs/API.md.
+ * Text may contain {time}, {date} and {battery}, expanded when the frame is
+ * rendered. Negative x/y are measured from the right/bottom edge.
+ *
+ * @param spec Overlay spec, NULL, "" or "[]" to remove the overlay
+ * @return ESP_ERR_INVALID_ARG if the spec is malformed,
+ *         ESP_ERR_INVALID_SIZE if it is longer than DISPLAY_OVERLAY_SPEC_MAX_LEN
+ */
+esp_err_t display_manager_set_overlay(const char *spec);
+
+/**
+ * @brief Whether the overlay contains placeholders, i.e. changes between renders
+ */
+bool display_manager_overlay_has_placeholders(void);
+
+/**
+ * @brief Queue work that updates the display and return immediately
+ *
+ * Jobs are executed one at a time on a dedicated task, so callers (e.g. HTTP
+ * handlers) don't block for the ~30 second panel refresh. Requests are coalesced:
+ * a new job supersedes any job that is still waiting, so only the most recent
+ * request is rendered once the panel becomes free.
+ * On success the job owns @p arg and releases it with @p free_arg when done or
+ * superseded. On failure ownership stays with the caller.
+ *
+ * @param callback Work to run on the display job task
+ * @param arg Argument for the callback (may be NULL)
+ * @param free_arg Release function for arg (may be NULL)
+ * @param job_id Output: id that can be passed to display_manager_get_job_status()
+ * @return ESP_OK if queued, ESP_ERR_INVALID_STATE if the display manager isn't initialized
+ */
+esp_err_t display_manager_submit_job(display_job_callback_t callback, void *arg,
+                                     display_job_free_t free_arg, uint32_t *job_id);
+
+/**
+ * @brief Look up the status of a recently submitted display job
+ *
+ * @param job_id Job id returned by display_manager_submit_job()
+ * @param status Output status
+ * @return ESP_OK if found, ESP_ERR_NOT_FOUND if the id is unknown or too old
+ */
+esp_err_t display_manager_get_job_status(uint32_t job_id, display_job_status_t *status);
+
+/**
+ * @brief Get the id of the most recently submitted display job (0 if none)
+ */
+uint32_t display_manager_get_last_job_id(void);
+
+/**
+ * @brief Get the id of the job whose callback is running (0 outside of job callbacks)
+ */
+uint32_t display_manager_get_running_job_id(void);
+
+/**
+ * @brief Time the last show call took to draw its image into the framebuffer
+ *
+ * Covers clearing and painting (including reading the file for display_manager_show_image()),
+ * not the panel refresh. Lets callers complete an image_profile_t with its paint stage.
+ *
+ * @return Microseconds, 0 if the last show call failed before painting finished
+ */
+int64_t display_manager_get_last_paint_us(void);
+
+const char *display_manager_job_state_to_string(display_job_state_t state);
 
 #endif
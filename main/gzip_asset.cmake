@@ -0,0 +1,3 @@
+# Compress one web asset for embedding: cmake -DINPUT=<file> -DOUTPUT=<file.gz> -P gzip_asset.cmake
+file(ARCHIVE_CREATE OUTPUT "${OUTPUT}" PATHS "${INPUT}" FORMAT raw COMPRESSION GZip
+     COMPRESSION_LEVEL 9)
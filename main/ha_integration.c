@@ -11,6 +11,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "ota_manager.h"
+#include "timeline.h"
 #include "utils.h"
 
 static const char *TAG = "ha_integration";
@@ -77,7 +78,9 @@ static esp_err_t ha_send_notification(const char *state, const char *log_message
     esp_http_client_set_post_field(client, json_str, strlen(json_str));
 
     // Perform request
+    timeline_begin(TIMELINE_HA_NOTIFY);
     esp_err_t err = esp_http_client_perform(client);
+    timeline_end(TIMELINE_HA_NOTIFY);
     int status_code = esp_http_client_get_status_code(client);
 
     esp_http_client_cleanup(client);
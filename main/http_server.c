@@ -17,25 +17,36 @@
 #include "config.h"
 #include "config_manager.h"
 #include "display_manager.h"
+#include "epaper.h"
 #include "esp_app_desc.h"
 #include "esp_heap_caps.h"
 #include "esp_http_server.h"
 #include "esp_littlefs.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
 #include "esp_vfs.h"
 #include "esp_vfs_fat.h"
 #include "freertos/task.h"
 #include "ha_integration.h"
 #include "image_processor.h"
+#include "lwip/sockets.h"
 #include "mdns_service.h"
+#include "metrics.h"
 #include "nvs_flash.h"
 #include "ota_manager.h"
 #include "periodic_tasks.h"
+#include "pipeline_arena.h"
 #include "power_manager.h"
 #include "processing_settings.h"
+#include "raw_frame.h"
+#include "rom/miniz.h"
 #include "sdcard.h"
 #include "storage.h"
+#include "testable_utils.h"
+#include "timeline.h"
 #include "utils.h"
+#include "webapp_assets.h"
 #include "wifi_manager.h"
 
 #ifndef MIN
@@ -66,791 +77,941 @@ static bool is_path_safe(const char *path)
     return true;
 }
 
-extern const uint8_t index_html_start[] asm("_binary_index_html_start");
-extern const uint8_t index_html_end[] asm("_binary_index_html_end");
-extern const uint8_t index_css_start[] asm("_binary_index_css_start");
-extern const uint8_t index_css_end[] asm("_binary_index_css_end");
-extern const uint8_t index_js_start[] asm("_binary_index_js_start");
-extern const uint8_t index_js_end[] asm("_binary_index_js_end");
-extern const uint8_t index2_js_start[] asm("_binary_index2_js_start");
-extern const uint8_t index2_js_end[] asm("_binary_index2_js_end");
-extern const uint8_t exif_reader_js_start[] asm("_binary_exif_reader_js_start");
-extern const uint8_t exif_reader_js_end[] asm("_binary_exif_reader_js_end");
-extern const uint8_t browser_js_start[] asm("_binary_browser_js_start");
-extern const uint8_t browser_js_end[] asm("_binary_browser_js_end");
-extern const uint8_t vite_browser_external_js_start[] asm(
-    "_binary___vite_browser_external_js_start");
-extern const uint8_t vite_browser_external_js_end[] asm("_binary___vite_browser_external_js_end");
-extern const uint8_t favicon_svg_start[] asm("_binary_favicon_svg_start");
-extern const uint8_t favicon_svg_end[] asm("_binary_favicon_svg_end");
 extern const uint8_t measurement_sample_jpg_start[] asm("_binary_measurement_sample_jpg_start");
 extern const uint8_t measurement_sample_jpg_end[] asm("_binary_measurement_sample_jpg_end");
 
-static esp_err_t index_handler(httpd_req_t *req)
+static esp_err_t measurement_sample_handler(httpd_req_t *req)
 {
-    const size_t index_html_size = (index_html_end - index_html_start);
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, (const char *) index_html_start, index_html_size);
+    const size_t measurement_sample_jpg_size =
+        (measurement_sample_jpg_end - measurement_sample_jpg_start);
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_send(req, (const char *) measurement_sample_jpg_start, measurement_sample_jpg_size);
     return ESP_OK;
 }
 
-static esp_err_t index_css_handler(httpd_req_t *req)
-{
-    const size_t index_css_size = (index_css_end - index_css_start);
-    httpd_resp_set_type(req, "text/css");
-    httpd_resp_send(req, (const char *) index_css_start, index_css_size);
-    return ESP_OK;
-}
+// Shared multipart parsing helper
+typedef struct {
+    char image_path[512];
+    char thumbnail_path[512];
+    char original_filename[256];  // Original filename from upload
+    bool has_image;
+    bool has_thumbnail;
+} multipart_result_t;
 
-static esp_err_t index_js_handler(httpd_req_t *req)
-{
-    const size_t index_js_size = (index_js_end - index_js_start);
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *) index_js_start, index_js_size);
-    return ESP_OK;
-}
+#define MULTIPART_RECV_SIZE (16 * 1024)
+#define MULTIPART_WRITE_BATCH (32 * 1024)
+#define MULTIPART_HEADERS_MAX 1024
+#define MULTIPART_PADDING_MAX 256
+// Chunk size for feeding a direct upload to the stream decoder
+#define UPLOAD_FEED_SIZE 4096
 
-static esp_err_t index2_js_handler(httpd_req_t *req)
-{
-    const size_t index2_js_size = (index2_js_end - index2_js_start);
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *) index2_js_start, index2_js_size);
-    return ESP_OK;
-}
+// Part data is collected into whole MULTIPART_WRITE_BATCH blocks so the filesystem sees large,
+// cluster-aligned writes instead of whatever each TCP read happened to return
+typedef struct {
+    FILE *fp;
+    uint8_t *batch;
+    size_t used;
+    bool failed;
+} upload_writer_t;
 
-static esp_err_t exif_reader_js_handler(httpd_req_t *req)
+static void upload_writer_flush(upload_writer_t *writer)
 {
-    const size_t exif_reader_js_size = (exif_reader_js_end - exif_reader_js_start);
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *) exif_reader_js_start, exif_reader_js_size);
-    return ESP_OK;
+    if (writer->used > 0 && fwrite(writer->batch, 1, writer->used, writer->fp) != writer->used) {
+        writer->failed = true;
+    }
+    metrics_add(METRICS_STORAGE_BYTES_WRITTEN, writer->used);
+    writer->used = 0;
 }
 
-static esp_err_t browser_js_handler(httpd_req_t *req)
+static void upload_writer_append(upload_writer_t *writer, const uint8_t *data, size_t len)
 {
-    const size_t browser_js_size = (browser_js_end - browser_js_start);
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *) browser_js_start, browser_js_size);
-    return ESP_OK;
+    if (!writer->fp) {
+        return;  // a part we do not keep
+    }
+
+    // Receive reads (MULTIPART_RECV_SIZE) are smaller than a batch, so everything is staged
+    while (len > 0 && !writer->failed) {
+        size_t n = MIN(len, MULTIPART_WRITE_BATCH - writer->used);
+        memcpy(writer->batch + writer->used, data, n);
+        writer->used += n;
+        data += n;
+        len -= n;
+        if (writer->used == MULTIPART_WRITE_BATCH) {
+            upload_writer_flush(writer);
+        }
+    }
 }
 
-static esp_err_t vite_browser_external_js_handler(httpd_req_t *req)
+static void upload_writer_close(upload_writer_t *writer)
 {
-    const size_t vite_browser_external_js_size =
-        (vite_browser_external_js_end - vite_browser_external_js_start);
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *) vite_browser_external_js_start,
-                    vite_browser_external_js_size);
-    return ESP_OK;
+    if (writer->fp) {
+        upload_writer_flush(writer);
+        fclose(writer->fp);
+        writer->fp = NULL;
+    }
 }
 
-static esp_err_t favicon_handler(httpd_req_t *req)
+static FILE *upload_writer_open(const char *path)
 {
-    const size_t favicon_svg_size = (favicon_svg_end - favicon_svg_start);
-    httpd_resp_set_type(req, "image/svg+xml");
-    httpd_resp_send(req, (const char *) favicon_svg_start, favicon_svg_size);
-    return ESP_OK;
+    FILE *fp = fopen(path, "wb");
+    if (fp) {
+        // Writes already arrive in large blocks; stdio buffering would only add a copy
+        setvbuf(fp, NULL, _IONBF, 0);
+    }
+    return fp;
 }
 
-static esp_err_t measurement_sample_handler(httpd_req_t *req)
+static long find_blank_line(const uint8_t *data, size_t len)
 {
-    const size_t measurement_sample_jpg_size =
-        (measurement_sample_jpg_end - measurement_sample_jpg_start);
-    httpd_resp_set_type(req, "image/jpeg");
-    httpd_resp_send(req, (const char *) measurement_sample_jpg_start, measurement_sample_jpg_size);
-    return ESP_OK;
+    for (size_t i = 0; i + 3 < len; i++) {
+        if (data[i] == '\r' && data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') {
+            return (long) i;
+        }
+    }
+    return -1;
 }
 
-// Shared multipart parsing helper
-typedef struct {
-    char image_path[512];
-    char thumbnail_path[512];
-    char original_filename[256];  // Original filename from upload
-    bool has_image;
-    bool has_thumbnail;
-} multipart_result_t;
-
+typedef enum {
+    MULTIPART_PREAMBLE,       // before the first delimiter
+    MULTIPART_DELIMITER_END,  // after a delimiter: "--" or padding up to CRLF
+    MULTIPART_HEADERS,
+    MULTIPART_BODY,
+    MULTIPART_DONE,
+} multipart_state_t;
+
+// Stream a multipart/form-data body to files: the "image" part to base_dir/image_filename and
+// the "thumbnail" part to base_dir/thumb_filename. Other parts are skipped. On failure an error
+// response has already been sent and no part files are left behind.
 static esp_err_t parse_multipart_upload(httpd_req_t *req, const char *base_dir,
                                         const char *image_filename, const char *thumb_filename,
                                         multipart_result_t *result, bool require_png)
 {
     result->has_image = false;
     result->has_thumbnail = false;
+    result->original_filename[0] = '\0';
 
-    char *buf = malloc(4096);
-    if (!buf) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
-        return ESP_FAIL;
-    }
-
-    ESP_LOGI(TAG, "Processing multipart upload, content length: %d", req->content_len);
-
-    int buf_len = 0;
-    int remaining = req->content_len;
-
-    char boundary[128] = {0};
-    if (httpd_req_get_hdr_value_str(req, "Content-Type", boundary, sizeof(boundary)) != ESP_OK) {
-        free(buf);
+    char content_type[256];
+    if (httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type)) !=
+        ESP_OK) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No Content-Type header");
         return ESP_FAIL;
     }
 
-    char *boundary_start = strstr(boundary, "boundary=");
-    if (!boundary_start) {
-        free(buf);
+    char boundary[MULTIPART_BOUNDARY_MAX + 1];
+    multipart_delimiter_t delimiter;
+    if (!multipart_get_boundary(content_type, boundary, sizeof(boundary)) ||
+        !multipart_delimiter_init(&delimiter, boundary)) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No boundary found");
         return ESP_FAIL;
     }
 
-    boundary_start += 9;
-    char *boundary_end = strchr(boundary_start, '\r');
-    if (!boundary_end)
-        boundary_end = strchr(boundary_start, '\n');
-    if (!boundary_end)
-        boundary_end = strchr(boundary_start, ';');
-    if (!boundary_end)
-        boundary_end = boundary_start + strlen(boundary_start);
-
-    int boundary_value_len = boundary_end - boundary_start;
-    snprintf(boundary, sizeof(boundary), "--%.*s", boundary_value_len, boundary_start);
-    int full_boundary_len = strlen(boundary);
+    uint8_t *buf = heap_caps_malloc(MULTIPART_RECV_SIZE, MALLOC_CAP_SPIRAM);
+    uint8_t *batch = heap_caps_malloc(MULTIPART_WRITE_BATCH, MALLOC_CAP_SPIRAM);
+    if (!buf) {
+        buf = malloc(MULTIPART_RECV_SIZE);
+    }
+    if (!batch) {
+        batch = malloc(MULTIPART_WRITE_BATCH);
+    }
+    if (!buf || !batch) {
+        heap_caps_free(buf);
+        heap_caps_free(batch);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+        return ESP_FAIL;
+    }
 
-    char current_field[64] = {0};
-    bool header_parsed = false;
-    FILE *fp = NULL;
+    ESP_LOGI(TAG, "Processing multipart upload, content length: %d", req->content_len);
 
-    while (remaining > 0 || buf_len > 0) {
-        if (remaining > 0 && buf_len < 2048) {
-            int to_read = MIN(remaining, 4096 - buf_len);
-            int received = httpd_req_recv(req, buf + buf_len, to_read);
+    // The first delimiter of a body has no CRLF in front of it; pretend it does so that every
+    // delimiter looks the same to the search
+    memcpy(buf, "\r\n", 2);
+    size_t start = 0;
+    size_t end = 2;
+    int remaining = req->content_len;
 
-            if (received <= 0) {
-                if (received == HTTPD_SOCK_ERR_TIMEOUT)
-                    continue;
-                if (fp)
-                    fclose(fp);
-                free(buf);
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive file");
-                return ESP_FAIL;
+    multipart_state_t state = MULTIPART_PREAMBLE;
+    upload_writer_t writer = {.batch = batch};
+    const char *bad_request = NULL;
+    const char *server_error = NULL;
+
+    while (state != MULTIPART_DONE && !bad_request && !server_error) {
+        uint8_t *data = buf + start;
+        size_t avail = end - start;
+        bool need_more = false;
+
+        switch (state) {
+        case MULTIPART_PREAMBLE:
+        case MULTIPART_BODY: {
+            long pos = multipart_delimiter_find(&delimiter, data, avail);
+            if (pos >= 0) {
+                if (state == MULTIPART_BODY) {
+                    upload_writer_append(&writer, data, pos);
+                    upload_writer_close(&writer);
+                }
+                start += pos + delimiter.length;
+                state = MULTIPART_DELIMITER_END;
+            } else {
+                // Everything but a delimiter cut off at the end of the buffer is part data
+                size_t safe = avail >= delimiter.length ? avail - (delimiter.length - 1) : 0;
+                if (state == MULTIPART_BODY) {
+                    upload_writer_append(&writer, data, safe);
+                }
+                start += safe;
+                need_more = true;
             }
-
-            buf_len += received;
-            remaining -= received;
+            if (writer.failed) {
+                server_error = "Failed to write file";
+            }
+            break;
         }
 
-        if (!header_parsed) {
-            char *name_start = strstr(buf, "name=\"");
-            if (name_start && name_start < buf + buf_len) {
-                name_start += 6;
-                char *name_end = strchr(name_start, '"');
-                if (name_end && name_end < buf + buf_len) {
-                    int name_len = name_end - name_start;
-                    strncpy(current_field, name_start, MIN(name_len, sizeof(current_field) - 1));
-                    current_field[MIN(name_len, sizeof(current_field) - 1)] = '\0';
+        case MULTIPART_DELIMITER_END: {
+            if (avail >= 2 && data[0] == '-' && data[1] == '-') {
+                state = MULTIPART_DONE;
+                break;
+            }
+            uint8_t *lf = memchr(data, '\n', avail);
+            if (!lf) {
+                if (avail > MULTIPART_PADDING_MAX) {
+                    bad_request = "Malformed multipart body";
                 }
+                need_more = true;
+                break;
             }
+            start += lf - data + 1;
+            state = MULTIPART_HEADERS;
+            break;
+        }
 
-            char *filename_start = strstr(buf, "filename=\"");
-            if (filename_start && filename_start < buf + buf_len) {
-                filename_start += 10;
-                char *filename_end = strchr(filename_start, '"');
-                if (filename_end && filename_end < buf + buf_len) {
-                    int name_len = filename_end - filename_start;
-
-                    if (strcmp(current_field, "image") == 0) {
-                        // Capture original filename
-                        strncpy(result->original_filename, filename_start,
-                                MIN(name_len, sizeof(result->original_filename) - 1));
-                        result->original_filename[MIN(
-                            name_len, sizeof(result->original_filename) - 1)] = '\0';
-
-                        if (require_png) {
-                            // Check PNG extension for image field
-                            char *ext = strrchr(result->original_filename, '.');
-                            if (!ext || strcasecmp(ext, ".png") != 0) {
-                                if (fp)
-                                    fclose(fp);
-                                free(buf);
-                                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
-                                                    "Only PNG files are allowed");
-                                return ESP_FAIL;
-                            }
-                        }
-
-                        snprintf(result->image_path, sizeof(result->image_path), "%s/%s", base_dir,
-                                 image_filename);
-                        fp = fopen(result->image_path, "wb");
-                        if (!fp) {
-                            free(buf);
-                            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                                "Failed to create file");
-                            return ESP_FAIL;
-                        }
-                        result->has_image = true;
-                    } else if (strcmp(current_field, "thumbnail") == 0) {
-                        snprintf(result->thumbnail_path, sizeof(result->thumbnail_path), "%s/%s",
-                                 base_dir, thumb_filename);
-                        fp = fopen(result->thumbnail_path, "wb");
-                        if (!fp) {
-                            free(buf);
-                            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                                "Failed to create file");
-                            return ESP_FAIL;
-                        }
-                        result->has_thumbnail = true;
+        case MULTIPART_HEADERS: {
+            size_t headers_len;
+            size_t consumed;
+            if (avail >= 2 && data[0] == '\r' && data[1] == '\n') {
+                headers_len = 0;  // part without headers
+                consumed = 2;
+            } else {
+                long blank = find_blank_line(data, avail);
+                if (blank < 0) {
+                    if (avail >= MULTIPART_HEADERS_MAX) {
+                        bad_request = "Part headers too large";
                     }
+                    need_more = true;
+                    break;
                 }
+                headers_len = blank;
+                consumed = blank + 4;
             }
 
-            char *data_start = strstr(buf, "\r\n\r\n");
-            if (data_start && data_start < buf + buf_len) {
-                data_start += 4;
-                int header_len = data_start - buf;
-                header_parsed = true;
-                buf_len -= header_len;
-                memmove(buf, data_start, buf_len);
-            } else if (remaining == 0) {
+            char field[32];
+            char filename[sizeof(result->original_filename)];
+            multipart_parse_part_headers((const char *) data, headers_len, field, sizeof(field),
+                                         filename, sizeof(filename));
+            start += consumed;
+            state = MULTIPART_BODY;
+
+            if (strcmp(field, "image") == 0 && !result->has_image) {
+                strlcpy(result->original_filename, filename, sizeof(result->original_filename));
+                if (require_png) {
+                    char *ext = strrchr(filename, '.');
+                    if (!ext || strcasecmp(ext, ".png") != 0) {
+                        bad_request = "Only PNG files are allowed";
+                        break;
+                    }
+                }
+                snprintf(result->image_path, sizeof(result->image_path), "%s/%s", base_dir,
+                         image_filename);
+                writer.fp = upload_writer_open(result->image_path);
+                result->has_image = writer.fp != NULL;
+            } else if (strcmp(field, "thumbnail") == 0 && !result->has_thumbnail) {
+                snprintf(result->thumbnail_path, sizeof(result->thumbnail_path), "%s/%s",
+                         base_dir, thumb_filename);
+                writer.fp = upload_writer_open(result->thumbnail_path);
+                result->has_thumbnail = writer.fp != NULL;
+            } else {
                 break;
             }
-        } else {
-            char *boundary_pos = NULL;
-            for (int i = 0; i <= buf_len - full_boundary_len; i++) {
-                if (memcmp(buf + i, boundary, full_boundary_len) == 0) {
-                    boundary_pos = buf + i;
-                    break;
-                }
+
+            if (!writer.fp) {
+                server_error = "Failed to create file";
             }
+            break;
+        }
 
-            if (boundary_pos) {
-                int data_len = boundary_pos - buf;
-                if (fp && data_len > 0) {
-                    fwrite(buf, 1, data_len, fp);
-                }
+        case MULTIPART_DONE:
+            break;
+        }
 
-                if (fp) {
-                    fclose(fp);
-                    fp = NULL;
-                }
+        if (!need_more || bad_request || server_error) {
+            continue;
+        }
 
-                int consumed = (boundary_pos - buf) + full_boundary_len;
-                buf_len -= consumed;
-                memmove(buf, buf + consumed, buf_len);
-                header_parsed = false;
-                current_field[0] = '\0';
-            } else {
-                int safe_write = buf_len - (full_boundary_len - 1);
-                if (safe_write > 0 && remaining > 0) {
-                    if (fp) {
-                        fwrite(buf, 1, safe_write, fp);
-                    }
-                    buf_len -= safe_write;
-                    memmove(buf, buf + safe_write, buf_len);
-                } else if (remaining == 0 && buf_len > 0) {
-                    if (fp) {
-                        fwrite(buf, 1, buf_len, fp);
-                    }
-                    buf_len = 0;
-                }
+        if (remaining <= 0) {
+            // The body ended without a closing delimiter, e.g. the client went away mid-upload:
+            // the last part is incomplete
+            bad_request = "Truncated multipart body";
+            break;
+        }
+
+        // Keep the unparsed tail (at most a partial delimiter or header block) and refill
+        if (start > 0) {
+            memmove(buf, buf + start, end - start);
+            end -= start;
+            start = 0;
+        }
+        while (end < MULTIPART_RECV_SIZE && remaining > 0) {
+            int received =
+                httpd_req_recv(req, (char *) buf + end, MIN(remaining, MULTIPART_RECV_SIZE - end));
+            if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;
             }
+            if (received <= 0) {
+                server_error = "Failed to receive file";
+                break;
+            }
+            end += received;
+            remaining -= received;
         }
     }
 
-    if (fp) {
-        fclose(fp);
+    upload_writer_close(&writer);
+    if (writer.failed && !server_error) {
+        server_error = "Failed to write file";
     }
-    free(buf);
+    heap_caps_free(buf);
+    heap_caps_free(batch);
 
+    if (bad_request || server_error) {
+        // Never leave a partial part behind for the caller to index or display
+        if (result->has_image) {
+            unlink(result->image_path);
+            result->has_image = false;
+        }
+        if (result->has_thumbnail) {
+            unlink(result->thumbnail_path);
+            result->has_thumbnail = false;
+        }
+    }
+    if (bad_request) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, bad_request);
+        return ESP_FAIL;
+    }
+    if (server_error) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, server_error);
+        return ESP_FAIL;
+    }
     return ESP_OK;
 }
 
-static esp_err_t display_image_direct_handler(httpd_req_t *req)
+// Reply for a display request that was handed to the display job queue
+static esp_err_t send_display_job_accepted(httpd_req_t *req, uint32_t job_id)
 {
-    if (!system_ready) {
-        httpd_resp_set_status(req, HTTPD_503);
-        httpd_resp_sendstr(req, "System is still initializing");
-        return ESP_FAIL;
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "status", "queued");
+    cJSON_AddNumberToObject(response, "job_id", job_id);
+    cJSON_AddStringToObject(response, "message", "Display update queued");
+
+    char *json_str = cJSON_Print(response);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_status(req, "202 Accepted");
+
+    esp_err_t send_err = httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(response);
+
+    if (send_err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to send response (connection likely closed): %d", send_err);
     }
 
-    power_manager_reset_sleep_timer();
+    return ESP_OK;
+}
 
-    // Check if display is already busy
-    if (display_manager_is_busy()) {
-        ESP_LOGW(TAG, "Display is busy, rejecting request");
-        cJSON *response = cJSON_CreateObject();
-        cJSON_AddStringToObject(response, "status", "busy");
-        cJSON_AddStringToObject(response, "message", "Display is currently updating, please wait");
+static esp_err_t send_display_busy(httpd_req_t *req)
+{
+    ESP_LOGW(TAG, "Display job could not be queued, rejecting request");
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "status", "busy");
+    cJSON_AddStringToObject(response, "message", "Display is currently updating, please wait");
 
-        char *json_str = cJSON_Print(response);
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_set_status(req, "503 Service Unavailable");
-        httpd_resp_sendstr(req, json_str);
+    char *json_str = cJSON_Print(response);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_status(req, HTTPD_503);
+    httpd_resp_sendstr(req, json_str);
 
-        free(json_str);
-        cJSON_Delete(response);
-        return ESP_OK;
+    free(json_str);
+    cJSON_Delete(response);
+    return ESP_OK;
+}
+
+// Upload received by display_image_direct_handler, rendered and displayed on the display job
+// task. Each upload is staged under its own name so a new upload can be received while the
+// previous one is still being displayed.
+typedef struct {
+    char image_path[64];
+    char thumbnail_path[64];
+    bool has_thumbnail;
+    bool force_refresh;
+    image_format_t format;
+    image_stream_decoder_t *decoder;  // decoding while receiving; NULL when staged to a file
+    uint8_t *rgb_data;                // decoder output, set when the job runs
+    int width;
+    int height;
+    image_profile_t profile;
+} display_upload_job_t;
+
+static uint32_t upload_sequence = 0;
+
+static void display_upload_job_free(void *arg)
+{
+    display_upload_job_t *job = (display_upload_job_t *) arg;
+
+    // Staged files are moved into place when the job runs; remove whatever is left
+    unlink(job->image_path);
+    if (job->has_thumbnail) {
+        unlink(job->thumbnail_path);
     }
+    image_processor_stream_decoder_free(job->decoder);
+    pipeline_arena_free(job->rgb_data);
+    free(job);
+}
 
-    // Get content type to determine if it's JPG, BMP, PNG, or multipart
-    char content_type[128] = {0};
-    if (httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type)) !=
-        ESP_OK) {
-        strcpy(content_type, "image/jpeg");  // Default to JPEG
+// Make .current.jpg match the image being displayed: use the uploaded thumbnail if any,
+// otherwise the original JPEG.
+static void display_upload_job_save_thumbnail(display_upload_job_t *job)
+{
+    const char *source = NULL;
+    if (job->has_thumbnail) {
+        source = job->thumbnail_path;
+    } else if (job->format == IMAGE_FORMAT_JPG) {
+        source = job->image_path;
     }
 
-    image_format_t image_format = IMAGE_FORMAT_UNKNOWN;
+    unlink(CURRENT_JPG_PATH);
+    if (!source) {
+        return;
+    }
 
-    // Check if this is a multipart upload (with optional thumbnail)
-    bool is_multipart = (strstr(content_type, "multipart/form-data") != NULL);
+    if (rename(source, CURRENT_JPG_PATH) != 0) {
+        ESP_LOGW(TAG, "Failed to save thumbnail");
+    } else {
+        ESP_LOGI(TAG, "Thumbnail saved: %s", CURRENT_JPG_PATH);
+    }
+}
 
-    if (is_multipart) {
-        // Handle multipart upload with optional thumbnail using shared helper
-        multipart_result_t result;
-        esp_err_t err = parse_multipart_upload(req, FS_MOUNT_POINT, ".current_upload.tmp",
-                                               ".current_thumb.tmp", &result, false);
-        if (err != ESP_OK) {
-            return ESP_FAIL;
-        }
+// Temporary/No-storage system: decode straight out of the RAM file, process to RGB, display
+// directly
+static esp_err_t display_upload_job_show_from_buffer(display_upload_job_t *job,
+                                                     dither_algorithm_t algo)
+{
+    image_process_rgb_result_t result;
+    esp_err_t err =
+        image_processor_process_file_to_rgb(job->image_path, job->format, algo, &result,
+                                            &job->profile);
 
-        if (!result.has_image) {
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No image file in multipart upload");
-            return ESP_FAIL;
-        }
+    // Free the staged upload (or keep it as thumbnail) before the RGB buffer is displayed
+    display_upload_job_save_thumbnail(job);
+    unlink(job->image_path);
 
-        image_format = image_processor_detect_format(result.image_path);
-        if (image_format == IMAGE_FORMAT_UNKNOWN) {
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unsupported image format");
-            return ESP_FAIL;
-        }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
+        return err;
+    }
 
-        const char *temp_bmp_path = CURRENT_BMP_PATH;
-        const char *temp_png_path = CURRENT_PNG_PATH;
-        const char *temp_jpg_path = CURRENT_JPG_PATH;
-        const char *display_path = NULL;
+    err = display_manager_show_rgb_buffer(result.rgb_data, result.width, result.height,
+                                          job->force_refresh);
+    pipeline_arena_free(result.rgb_data);
 
-        // Load processing settings to get dithering algorithm
-        processing_settings_t proc_settings;
-        if (processing_settings_load(&proc_settings) != ESP_OK) {
-            processing_settings_get_defaults(&proc_settings);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Image displayed from buffer");
+    }
+    return err;
+}
+
+// Streamed upload: the image was decoded while it was received, only processing is left
+static esp_err_t display_upload_job_show_decoded(display_upload_job_t *job)
+{
+    // Waits for the decoder task, which is still busy with a JPEG collected while receiving
+    image_process_rgb_result_t decoded;
+    esp_err_t finish_err =
+        image_processor_stream_decoder_finish(job->decoder, &decoded, &job->profile);
+    image_processor_stream_decoder_free(job->decoder);
+    job->decoder = NULL;
+    if (finish_err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to decode upload: %s", esp_err_to_name(finish_err));
+        return finish_err;
+    }
+    job->rgb_data = decoded.rgb_data;
+    job->width = decoded.width;
+    job->height = decoded.height;
+
+    uint8_t *rgb_data = job->rgb_data;
+    int width = job->width;
+    int height = job->height;
+    job->rgb_data = NULL;
+
+    // Nothing was stored for this upload, so the previous thumbnail no longer matches
+    unlink(CURRENT_JPG_PATH);
+
+    if (job->format == IMAGE_FORMAT_PNG &&
+        image_processor_is_processed_rgb(rgb_data, width, height)) {
+        ESP_LOGI(TAG, "Image is already processed, skipping processing");
+    } else {
+        image_process_rgb_result_t result;
+        esp_err_t err =
+            image_processor_process_rgb(rgb_data, width, height,
+                                        processing_settings_get_dithering_algorithm(), &result,
+                                        &job->profile);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
+            return err;
         }
+        rgb_data = result.rgb_data;
+        width = result.width;
+        height = result.height;
+    }
 
-        // Process the uploaded image
-        if (image_format == IMAGE_FORMAT_PNG) {
-            unlink(temp_png_path);
+    esp_err_t err = display_manager_show_rgb_buffer(rgb_data, width, height, job->force_refresh);
+    pipeline_arena_free(rgb_data);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-            bool already_processed = image_processor_is_processed(result.image_path);
-            if (already_processed) {
-                ESP_LOGI(TAG, "PNG is already processed, skipping processing");
-                if (rename(result.image_path, temp_png_path) != 0) {
-                    ESP_LOGE(TAG, "Failed to move PNG");
-                    unlink(result.image_path);
-                    if (result.has_thumbnail)
-                        unlink(result.thumbnail_path);
-                    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                        "Failed to process PNG");
-                    return ESP_FAIL;
-                }
-            } else {
-                ESP_LOGI(TAG, "PNG needs processing");
-                // Use default settings if not provided
-                processing_settings_t settings;
-                if (processing_settings_load(&settings) != ESP_OK) {
-                    processing_settings_get_defaults(&settings);
-                }
-                dither_algorithm_t algo = processing_settings_get_dithering_algorithm();
-
-                esp_err_t err = image_processor_process(result.image_path, temp_png_path, algo);
-                unlink(result.image_path);
-                if (err != ESP_OK) {
-                    ESP_LOGE(TAG, "Failed to process PNG: %s", esp_err_to_name(err));
-                    if (result.has_thumbnail)
-                        unlink(result.thumbnail_path);
-                    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                        "Failed to process PNG");
-                    return ESP_FAIL;
-                }
-            }
-            display_path = temp_png_path;
-        } else if (image_format == IMAGE_FORMAT_BMP) {
-            unlink(temp_bmp_path);
-            if (rename(result.image_path, temp_bmp_path) != 0) {
-                ESP_LOGE(TAG, "Failed to move BMP");
-                unlink(result.image_path);
-                if (result.has_thumbnail)
-                    unlink(result.thumbnail_path);
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to process BMP");
-                return ESP_FAIL;
-            }
-            display_path = temp_bmp_path;
-        } else {
-            // PNG or JPG
-            processing_settings_t settings;
-            if (processing_settings_load(&settings) != ESP_OK) {
-                processing_settings_get_defaults(&settings);
-            }
-            dither_algorithm_t algo = processing_settings_get_dithering_algorithm();
+    ha_notify_update();
+    ESP_LOGI(TAG, "Image displayed from upload stream");
+    return ESP_OK;
+}
 
-            err = image_processor_process(result.image_path, temp_png_path, algo);
-            unlink(result.image_path);
-            if (err != ESP_OK) {
-                if (result.has_thumbnail)
-                    unlink(result.thumbnail_path);
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                    "Failed to process image");
-                return ESP_FAIL;
-            }
-            display_path = temp_png_path;
+static esp_err_t display_upload_job_show(display_upload_job_t *job)
+{
+    const char *temp_bmp_path = CURRENT_BMP_PATH;
+    const char *temp_png_path = CURRENT_PNG_PATH;
+    const char *display_path = temp_png_path;
+    esp_err_t err = ESP_OK;
+
+    unlink(temp_bmp_path);
+    unlink(temp_png_path);
+
+    if (job->decoder) {
+        return display_upload_job_show_decoded(job);
+    }
+
+    if (job->format == IMAGE_FORMAT_BMP) {
+        if (rename(job->image_path, temp_bmp_path) != 0) {
+            ESP_LOGE(TAG, "Failed to move uploaded BMP to temp location");
+            return ESP_FAIL;
+        }
+        display_path = temp_bmp_path;
+    } else if (job->format == IMAGE_FORMAT_PNG && image_processor_is_processed(job->image_path)) {
+        ESP_LOGI(TAG, "Image is already processed, skipping processing");
+        if (rename(job->image_path, temp_png_path) != 0) {
+            ESP_LOGE(TAG, "Failed to move uploaded PNG to temp location");
+            return ESP_FAIL;
         }
+    } else {
+        // Needs processing (JPG or raw PNG)
+        dither_algorithm_t algo = processing_settings_get_dithering_algorithm();
 
-        // Handle thumbnail if provided
-        if (result.has_thumbnail) {
-            unlink(temp_jpg_path);
-            if (rename(result.thumbnail_path, temp_jpg_path) != 0) {
-                ESP_LOGW(TAG, "Failed to save thumbnail");
-                unlink(result.thumbnail_path);
-            } else {
-                ESP_LOGI(TAG, "Thumbnail saved: %s", temp_jpg_path);
+        if (!storage_has_persistent_storage()) {
+            err = display_upload_job_show_from_buffer(job, algo);
+            if (err == ESP_OK) {
+                ha_notify_update();
             }
+            return err;
         }
 
-        // Display the image
-        err = display_manager_show_image(display_path);
+        // Persistent storage system: process to file
+        err = image_processor_process(job->image_path, temp_png_path, algo, &job->profile);
         if (err != ESP_OK) {
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to display image");
-            return ESP_FAIL;
+            ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
+            return err;
         }
+    }
 
-        // Delete rendered temp image after display to save storage space.
-        // Keep the thumbnail (.current.jpg) for the web UI.
-        unlink(temp_bmp_path);
-        unlink(temp_png_path);
+    display_upload_job_save_thumbnail(job);
 
-        ha_notify_update();
+    // Display the image (PNG or BMP) - display_manager handles both
+    err = display_manager_show_image(display_path, job->force_refresh);
 
-        cJSON *response = cJSON_CreateObject();
-        cJSON_AddStringToObject(response, "status", "success");
-        char *json_str = cJSON_Print(response);
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_sendstr(req, json_str);
-        free(json_str);
-        cJSON_Delete(response);
+    // Delete rendered temp image after display to save storage space.
+    // Keep the thumbnail (.current.jpg) for the web UI.
+    unlink(temp_bmp_path);
+    unlink(temp_png_path);
 
-        return ESP_OK;
+    if (err != ESP_OK) {
+        return err;
     }
 
-    if (strstr(content_type, "image/png")) {
-        image_format = IMAGE_FORMAT_PNG;
-    } else if (strstr(content_type, "image/bmp")) {
-        image_format = IMAGE_FORMAT_BMP;
-    } else if (strstr(content_type, "image/jpeg")) {
-        image_format = IMAGE_FORMAT_JPG;
-    }
+    ha_notify_update();
 
-    // Get content length
-    size_t content_len = req->content_len;
-    const size_t MAX_UPLOAD_SIZE = 5 * 1024 * 1024;  // 5MB max
+    ESP_LOGI(TAG, "Image displayed: %s", display_path);
+    return ESP_OK;
+}
 
-    if (content_len == 0) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty request body");
-        return ESP_FAIL;
-    }
+static esp_err_t display_upload_job_run(void *arg)
+{
+    display_upload_job_t *job = (display_upload_job_t *) arg;
 
-    if (content_len > MAX_UPLOAD_SIZE) {
-        ESP_LOGW(TAG, "Upload rejected: %zu bytes exceeds limit of %zu bytes", content_len,
-                 MAX_UPLOAD_SIZE);
-        char error_msg[128];
-        snprintf(error_msg, sizeof(error_msg),
-                 "File too large: %zu KB (max: %zu KB). Please compress or resize your image.",
-                 content_len / 1024, MAX_UPLOAD_SIZE / 1024);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error_msg);
-        return ESP_FAIL;
+    esp_err_t err = display_upload_job_show(job);
+
+    // Kept for GET /api/display/status, also for uploads that were displayed unprocessed
+    job->profile.job_id = display_manager_get_running_job_id();
+    if (job->profile.format == IMAGE_FORMAT_UNKNOWN) {
+        job->profile.format = job->format;
     }
+    if (err == ESP_OK) {
+        image_processor_profile_add_stage(&job->profile, IMAGE_STAGE_PAINT,
+                                          display_manager_get_last_paint_us());
+    }
+    image_processor_profile_save(&job->profile);
+    return err;
+}
 
-    ESP_LOGI(TAG, "Receiving image for direct display, size: %zu bytes (%.1f KB)", content_len,
-             content_len / 1024.0);
+typedef struct {
+    httpd_req_t *req;
+    size_t remaining;
+} upload_stream_t;
 
-    const char *temp_upload_path = CURRENT_UPLOAD_PATH;
-    const char *temp_jpg_path = CURRENT_JPG_PATH;
-    const char *temp_bmp_path = CURRENT_BMP_PATH;
-    const char *temp_png_path = CURRENT_PNG_PATH;
+static int upload_stream_read(void *ctx, uint8_t *buf, size_t len)
+{
+    upload_stream_t *stream = (upload_stream_t *) ctx;
+    if (stream->remaining == 0) {
+        return 0;
+    }
 
-    // Delete old files to prevent caching issues
-    unlink(temp_upload_path);
-    unlink(temp_jpg_path);
-    unlink(temp_bmp_path);
-    unlink(temp_png_path);
+    for (;;) {
+        int ret = httpd_req_recv(stream->req, (char *) buf, MIN(len, stream->remaining));
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return -1;
+        }
+        stream->remaining -= ret;
+        return ret;
+    }
+}
 
-    // Open file for writing
-    FILE *fp = fopen(temp_upload_path, "wb");
-    if (!fp) {
-        ESP_LOGE(TAG, "Failed to create temporary file");
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                            "Failed to create temporary file");
+static esp_err_t display_image_direct_handler(httpd_req_t *req)
+{
+    if (!system_ready) {
+        httpd_resp_set_status(req, HTTPD_503);
+        httpd_resp_sendstr(req, "System is still initializing");
         return ESP_FAIL;
     }
 
-    // Receive and write data in chunks
-    char *buf = malloc(4096);
-    if (!buf) {
-        fclose(fp);
+    power_manager_reset_sleep_timer();
+
+    // Get content type to determine if it's JPG, BMP, PNG, or multipart
+    char content_type[128] = {0};
+    if (httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type)) !=
+        ESP_OK) {
+        strcpy(content_type, "image/jpeg");  // Default to JPEG
+    }
+
+    display_upload_job_t *job = calloc(1, sizeof(display_upload_job_t));
+    if (!job) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
         return ESP_FAIL;
     }
 
-    size_t received = 0;
-    while (received < content_len) {
-        size_t to_read = MIN(4096, content_len - received);
-        int ret = httpd_req_recv(req, buf, to_read);
-        if (ret <= 0) {
-            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-                continue;
-            }
-            ESP_LOGE(TAG, "Failed to receive data");
+    uint32_t seq = ++upload_sequence;
+    char image_filename[32];
+    char thumb_filename[32];
+    snprintf(image_filename, sizeof(image_filename), ".upload_%lu.tmp", seq);
+    snprintf(thumb_filename, sizeof(thumb_filename), ".upthumb_%lu.tmp", seq);
+    snprintf(job->image_path, sizeof(job->image_path), "%s/%s", FS_MOUNT_POINT, image_filename);
+    snprintf(job->thumbnail_path, sizeof(job->thumbnail_path), "%s/%s", FS_MOUNT_POINT,
+             thumb_filename);
+
+    job->format = IMAGE_FORMAT_UNKNOWN;
+
+    // ?force=true refreshes the panel even if the image is identical to what is shown
+    char query[64];
+    char force_param[8];
+    char persist_param[8];
+    bool persist = false;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "force", force_param, sizeof(force_param)) == ESP_OK) {
+            job->force_refresh =
+                (strcmp(force_param, "true") == 0 || strcmp(force_param, "1") == 0);
+        }
+        // ?persist=true stages the upload to a file first so a JPEG is kept as the thumbnail
+        if (httpd_query_key_value(query, "persist", persist_param, sizeof(persist_param)) ==
+            ESP_OK) {
+            persist = (strcmp(persist_param, "true") == 0 || strcmp(persist_param, "1") == 0);
+        }
+    }
+
+    // Check if this is a multipart upload (with optional thumbnail)
+    bool is_multipart = (strstr(content_type, "multipart/form-data") != NULL);
+    const size_t MAX_UPLOAD_SIZE = 5 * 1024 * 1024;  // 5MB max
+
+    if (!is_multipart && !persist &&
+        (strstr(content_type, "image/jpeg") || strstr(content_type, "image/png")) &&
+        req->content_len > 0 && req->content_len <= MAX_UPLOAD_SIZE) {
+        // Feed the body to a decoder task as it arrives; nothing is written to the filesystem.
+        // This task only receives: the display job waits for the decode and processes it.
+        job->format = strstr(content_type, "image/png") ? IMAGE_FORMAT_PNG : IMAGE_FORMAT_JPG;
+        ESP_LOGI(TAG, "Decoding %s upload while receiving, size: %d bytes", content_type,
+                 req->content_len);
+
+        job->decoder = image_processor_stream_decoder_start(job->format, req->content_len);
+        uint8_t *buf = malloc(UPLOAD_FEED_SIZE);
+        if (!job->decoder || !buf) {
             free(buf);
-            fclose(fp);
-            unlink(temp_upload_path);
+            display_upload_job_free(job);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+            return ESP_FAIL;
+        }
+
+        upload_stream_t stream = {.req = req, .remaining = req->content_len};
+        esp_err_t err = ESP_OK;
+        int got;
+        while (err == ESP_OK && (got = upload_stream_read(&stream, buf, UPLOAD_FEED_SIZE)) > 0) {
+            err = image_processor_stream_decoder_feed(job->decoder, buf, got);
+        }
+        free(buf);
+        if (err == ESP_OK && stream.remaining > 0) {
+            ESP_LOGE(TAG, "Failed to receive data");
+            display_upload_job_free(job);
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive data");
             return ESP_FAIL;
         }
+        if (err != ESP_OK) {
+            display_upload_job_free(job);
+            if (err == ESP_ERR_NO_MEM) {
+                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                    "Not enough memory to decode image");
+            } else {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Failed to decode image");
+            }
+            return ESP_FAIL;
+        }
+    } else if (is_multipart) {
+        // Handle multipart upload with optional thumbnail using shared helper
+        multipart_result_t result;
+        esp_err_t err = parse_multipart_upload(req, FS_MOUNT_POINT, image_filename,
+                                               thumb_filename, &result, false);
+        job->has_thumbnail = result.has_thumbnail;
+        if (err != ESP_OK) {
+            display_upload_job_free(job);
+            return ESP_FAIL;
+        }
 
-        fwrite(buf, 1, ret, fp);
-        received += ret;
-    }
+        if (!result.has_image) {
+            display_upload_job_free(job);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No image file in multipart upload");
+            return ESP_FAIL;
+        }
+    } else {
+        if (strstr(content_type, "image/png")) {
+            job->format = IMAGE_FORMAT_PNG;
+        } else if (strstr(content_type, "image/bmp")) {
+            job->format = IMAGE_FORMAT_BMP;
+        } else if (strstr(content_type, "image/jpeg")) {
+            job->format = IMAGE_FORMAT_JPG;
+        }
 
-    free(buf);
-    fclose(fp);
+        // Get content length
+        size_t content_len = req->content_len;
 
-    ESP_LOGI(TAG, "Image received successfully");
-
-    // Helper function to detect format
-    if (image_format == IMAGE_FORMAT_UNKNOWN) {
-        image_format = image_processor_detect_format(temp_upload_path);
-        if (image_format == IMAGE_FORMAT_PNG) {
-            ESP_LOGI(TAG, "Detected PNG format from file");
-        } else if (image_format == IMAGE_FORMAT_BMP) {
-            ESP_LOGI(TAG, "Detected BMP format from file");
-        } else if (image_format == IMAGE_FORMAT_JPG) {
-            ESP_LOGI(TAG, "Detected JPG format from file");
-        } else {
-            ESP_LOGE(TAG, "Unsupported image format or format detection failed");
-            unlink(temp_upload_path);
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unsupported image format");
+        if (content_len == 0) {
+            free(job);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty request body");
             return ESP_FAIL;
         }
-    }
 
-    // Load processing settings to get dithering algorithm
-    processing_settings_t proc_settings;
-    if (processing_settings_load(&proc_settings) != ESP_OK) {
-        processing_settings_get_defaults(&proc_settings);
-    }
+        if (content_len > MAX_UPLOAD_SIZE) {
+            free(job);
+            ESP_LOGW(TAG, "Upload rejected: %zu bytes exceeds limit of %zu bytes", content_len,
+                     MAX_UPLOAD_SIZE);
+            char error_msg[128];
+            snprintf(error_msg, sizeof(error_msg),
+                     "File too large: %zu KB (max: %zu KB). Please compress or resize your image.",
+                     content_len / 1024, MAX_UPLOAD_SIZE / 1024);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error_msg);
+            return ESP_FAIL;
+        }
 
-    esp_err_t err = ESP_OK;
-    const char *display_path = NULL;
+        ESP_LOGI(TAG, "Receiving image for direct display, size: %zu bytes (%.1f KB)",
+                 content_len, content_len / 1024.0);
 
-    if (image_format == IMAGE_FORMAT_BMP) {
-        // Move uploaded BMP to temp location
-        if (rename(temp_upload_path, temp_bmp_path) != 0) {
-            ESP_LOGE(TAG, "Failed to move uploaded BMP to temp location");
-            unlink(temp_upload_path);
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to process BMP");
+        // Open file for writing
+        FILE *fp = fopen(job->image_path, "wb");
+        if (!fp) {
+            ESP_LOGE(TAG, "Failed to create temporary file");
+            free(job);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                "Failed to create temporary file");
             return ESP_FAIL;
         }
-        display_path = temp_bmp_path;
-    } else {
-        // PNG or JPG - unified processing logic
-        bool needs_processing = true;
 
-        if (image_format == IMAGE_FORMAT_PNG) {
-            if (image_processor_is_processed(temp_upload_path)) {
-                needs_processing = false;
-            } else {
-                ESP_LOGI(TAG, "PNG needs processing");
-            }
+        // Receive and write data in chunks
+        char *buf = malloc(4096);
+        if (!buf) {
+            fclose(fp);
+            display_upload_job_free(job);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+            return ESP_FAIL;
         }
 
-        if (!needs_processing) {
-            ESP_LOGI(TAG, "Image is already processed, skipping processing");
-            if (rename(temp_upload_path, temp_png_path) != 0) {
-                ESP_LOGE(TAG, "Failed to move uploaded PNG to temp location");
-                unlink(temp_upload_path);
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to process PNG");
+        size_t received = 0;
+        while (received < content_len) {
+            size_t to_read = MIN(4096, content_len - received);
+            int ret = httpd_req_recv(req, buf, to_read);
+            if (ret <= 0) {
+                if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                    continue;
+                }
+                ESP_LOGE(TAG, "Failed to receive data");
+                free(buf);
+                fclose(fp);
+                display_upload_job_free(job);
+                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                    "Failed to receive data");
                 return ESP_FAIL;
             }
-        } else {
-            // Needs processing (JPG or raw PNG)
-            dither_algorithm_t algo = processing_settings_get_dithering_algorithm();
-
-            if (storage_has_persistent_storage()) {
-                // Persistent storage system: process to file
-                err = image_processor_process(temp_upload_path, temp_png_path, algo);
-
-                if (err != ESP_OK) {
-                    ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
-                    unlink(temp_upload_path);
-
-                    // Provide specific error messages based on error type
-                    if (err == ESP_ERR_INVALID_SIZE) {
-                        httpd_resp_send_err(
-                            req, HTTPD_400_BAD_REQUEST,
-                            "Image is too large (max: 6400x3840). Please resize your "
-                            "image and try again.");
-                    } else if (err == ESP_ERR_NO_MEM) {
-                        httpd_resp_send_err(
-                            req, HTTPD_400_BAD_REQUEST,
-                            "Image requires too much memory to process. Please use a "
-                            "smaller image.");
-                    } else {
-                        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                            "Failed to process image");
-                    }
-                    return ESP_FAIL;
-                }
 
-                // For JPEG: use original as thumbnail; for PNG: delete original
-                if (image_format == IMAGE_FORMAT_JPG) {
-                    unlink(temp_jpg_path);
-                    if (rename(temp_upload_path, temp_jpg_path) != 0) {
-                        ESP_LOGW(TAG, "Failed to save original JPEG as thumbnail");
-                        unlink(temp_upload_path);
-                    } else {
-                        ESP_LOGI(TAG, "Using original JPEG as thumbnail: %s", temp_jpg_path);
-                    }
-                } else {
-                    unlink(temp_upload_path);
-                }
-            } else {
-                // Temporary/No-storage system: read file to buffer, process to RGB, display
-                // directly
-                FILE *fp = fopen(temp_upload_path, "rb");
-                if (!fp) {
-                    ESP_LOGE(TAG, "Failed to open uploaded file");
-                    unlink(temp_upload_path);
-                    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                        "Failed to process image");
-                    return ESP_FAIL;
-                }
+            fwrite(buf, 1, ret, fp);
+            metrics_add(METRICS_STORAGE_BYTES_WRITTEN, ret);
+            received += ret;
+        }
 
-                fseek(fp, 0, SEEK_END);
-                long file_size = ftell(fp);
-                fseek(fp, 0, SEEK_SET);
-
-                uint8_t *file_buffer = heap_caps_malloc(file_size, MALLOC_CAP_SPIRAM);
-                if (!file_buffer) {
-                    ESP_LOGE(TAG, "Failed to allocate buffer for image");
-                    fclose(fp);
-                    unlink(temp_upload_path);
-                    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
-                                        "Image requires too much memory to process");
-                    return ESP_FAIL;
-                }
+        free(buf);
+        fclose(fp);
 
-                size_t bytes_read = fread(file_buffer, 1, file_size, fp);
-                fclose(fp);
+        ESP_LOGI(TAG, "Image received successfully");
+    }
 
-                if (bytes_read != (size_t) file_size) {
-                    ESP_LOGE(TAG, "Incomplete file read: %zu of %ld bytes", bytes_read, file_size);
-                    heap_caps_free(file_buffer);
-                    unlink(temp_upload_path);
-                    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                        "Failed to read image file");
-                    return ESP_FAIL;
-                }
+    if (job->format == IMAGE_FORMAT_UNKNOWN) {
+        job->format = image_processor_detect_format(job->image_path);
+        if (job->format == IMAGE_FORMAT_UNKNOWN) {
+            ESP_LOGE(TAG, "Unsupported image format or format detection failed");
+            display_upload_job_free(job);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unsupported image format");
+            return ESP_FAIL;
+        }
+    }
 
-                // For JPEG: save as thumbnail; for PNG: delete original
-                if (image_format == IMAGE_FORMAT_JPG) {
-                    unlink(temp_jpg_path);
-                    if (rename(temp_upload_path, temp_jpg_path) != 0) {
-                        ESP_LOGW(TAG, "Failed to save original JPEG as thumbnail");
-                        unlink(temp_upload_path);
-                    } else {
-                        ESP_LOGI(TAG, "Using original JPEG as thumbnail: %s", temp_jpg_path);
-                    }
-                } else {
-                    unlink(temp_upload_path);
-                }
+    uint32_t job_id = 0;
+    if (display_manager_submit_job(display_upload_job_run, job, display_upload_job_free,
+                                   &job_id) != ESP_OK) {
+        display_upload_job_free(job);
+        return send_display_busy(req);
+    }
 
-                // Process to RGB buffer
-                image_process_rgb_result_t result;
-                err = image_processor_process_to_rgb(file_buffer, file_size, image_format, algo,
-                                                     &result);
-                heap_caps_free(file_buffer);
-
-                if (err != ESP_OK) {
-                    ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
-                    if (err == ESP_ERR_INVALID_SIZE) {
-                        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
-                                            "Image is too large. Please resize and try again.");
-                    } else if (err == ESP_ERR_NO_MEM) {
-                        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
-                                            "Image requires too much memory to process.");
-                    } else {
-                        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                            "Failed to process image");
-                    }
-                    return ESP_FAIL;
-                }
+    return send_display_job_accepted(req, job_id);
+}
 
-                // Display directly from RGB buffer
-                err = display_manager_show_rgb_buffer(result.rgb_data, result.width, result.height);
-                heap_caps_free(result.rgb_data);
+// Frame received by display_raw_handler, shown on the display job task
+typedef struct {
+    uint8_t *frame;
+    bool force_refresh;
+} display_raw_job_t;
 
-                if (err != ESP_OK) {
-                    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
-                                        "Failed to display image");
-                    return ESP_FAIL;
-                }
+static void display_raw_job_free(void *arg)
+{
+    display_raw_job_t *job = (display_raw_job_t *) arg;
+    heap_caps_free(job->frame);
+    free(job);
+}
 
-                ha_notify_update();
-                ESP_LOGI(TAG, "Image displayed from buffer");
-
-                cJSON *response = cJSON_CreateObject();
-                cJSON_AddStringToObject(response, "status", "success");
-                cJSON_AddStringToObject(response, "message", "Image displayed successfully");
-                char *json_str = cJSON_Print(response);
-                httpd_resp_set_type(req, "application/json");
-                httpd_resp_sendstr(req, json_str);
-                free(json_str);
-                cJSON_Delete(response);
-            }
-        }
-        display_path = temp_png_path;
+static esp_err_t display_raw_job_run(void *arg)
+{
+    display_raw_job_t *job = (display_raw_job_t *) arg;
+
+    // There is no JPEG for a packed frame; drop the thumbnail of the previous image
+    unlink(CURRENT_JPG_PATH);
+
+    // On success job->frame is swapped for the previous framebuffer, freed with the job
+    esp_err_t err = display_manager_show_packed_frame(&job->frame, job->force_refresh);
+    if (err == ESP_OK) {
+        ha_notify_update();
     }
+    return err;
+}
 
-    // Display the image (PNG or BMP) - display_manager handles both
-    err = display_manager_show_image(display_path);
-    if (err != ESP_OK) {
-        unlink(temp_bmp_path);
-        unlink(temp_png_path);
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to display image");
+static esp_err_t display_raw_handler(httpd_req_t *req)
+{
+    if (!system_ready) {
+        httpd_resp_set_status(req, HTTPD_503);
+        httpd_resp_sendstr(req, "System is still initializing");
         return ESP_FAIL;
     }
 
-    // Delete rendered temp image after display to save storage space.
-    // Keep the thumbnail (.current.jpg) for the web UI.
-    unlink(temp_bmp_path);
-    unlink(temp_png_path);
+    power_manager_reset_sleep_timer();
 
-    ha_notify_update();
+    if (req->content_len <= RAW_FRAME_HEADER_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing frame");
+        return ESP_FAIL;
+    }
 
-    ESP_LOGI(TAG, "Image displayed: %s", display_path);
+    display_raw_job_t *job = calloc(1, sizeof(display_raw_job_t));
+    raw_frame_decoder_t *decoder = raw_frame_decoder_create();
+    char *buf = malloc(4096);
+    if (!job || !decoder || !buf) {
+        free(job);
+        raw_frame_decoder_free(decoder);
+        free(buf);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+        return ESP_FAIL;
+    }
 
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "status", "success");
-    cJSON_AddStringToObject(response, "message", "Image displayed successfully");
+    char query[64];
+    char force_param[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "force", force_param, sizeof(force_param)) == ESP_OK) {
+        job->force_refresh = (strcmp(force_param, "true") == 0 || strcmp(force_param, "1") == 0);
+    }
 
-    char *json_str = cJSON_Print(response);
-    httpd_resp_set_type(req, "application/json");
+    ESP_LOGI(TAG, "Receiving packed frame, size: %d bytes", req->content_len);
 
-    esp_err_t send_err = httpd_resp_sendstr(req, json_str);
+    // Each piece is unpacked into the framebuffer as soon as it arrives
+    esp_err_t err = ESP_OK;
+    size_t remaining = req->content_len;
+    while (remaining > 0 && err == ESP_OK) {
+        int ret = httpd_req_recv(req, buf, MIN(4096, remaining));
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            ESP_LOGE(TAG, "Failed to receive frame");
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        remaining -= ret;
+        err = raw_frame_decoder_feed(decoder, (const uint8_t *) buf, ret);
+    }
+    free(buf);
 
-    free(json_str);
-    cJSON_Delete(response);
+    if (err == ESP_OK) {
+        err = raw_frame_decoder_finish(decoder, &job->frame);
+    }
+    raw_frame_decoder_free(decoder);
 
-    if (send_err != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to send response (connection likely closed): %d", send_err);
+    if (err != ESP_OK) {
+        display_raw_job_free(job);
+        if (err == ESP_ERR_NO_MEM || err == ESP_ERR_INVALID_STATE) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                err == ESP_ERR_NO_MEM ? "Memory allocation failed"
+                                                      : "Failed to receive frame");
+        } else {
+            char error_msg[96];
+            snprintf(error_msg, sizeof(error_msg), "Invalid frame for %dx%d panel: %s",
+                     BOARD_HAL_DISPLAY_WIDTH, BOARD_HAL_DISPLAY_HEIGHT, esp_err_to_name(err));
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error_msg);
+        }
+        return ESP_FAIL;
     }
 
-    return ESP_OK;
+    uint32_t job_id = 0;
+    if (display_manager_submit_job(display_raw_job_run, job, display_raw_job_free, &job_id) !=
+        ESP_OK) {
+        display_raw_job_free(job);
+        return send_display_busy(req);
+    }
+
+    return send_display_job_accepted(req, job_id);
 }
 
 // URL decode helper function to handle encoded characters like %20 for space
@@ -957,7 +1118,7 @@ static esp_err_t upload_image_handler(httpd_req_t *req)
     snprintf(final_png_path, sizeof(final_png_path), "%s/%s", album_path, png_filename);
     snprintf(final_thumb_path, sizeof(final_thumb_path), "%s/%s", album_path, jpg_filename);
 
-    // Remove old files
+    // Remove old files. The index is only touched once we know how the move went.
     unlink(final_png_path);
     unlink(final_thumb_path);
 
@@ -967,16 +1128,22 @@ static esp_err_t upload_image_handler(httpd_req_t *req)
         ESP_LOGE(TAG, "Failed to move PNG to album");
         unlink(result.image_path);
         unlink(result.thumbnail_path);
+        // An earlier upload of the same name is gone now, so it must not stay in the index
+        album_manager_index_remove(album_name, png_filename);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save image");
         return ESP_FAIL;
     }
 
     // Move thumbnail to final location
+    bool thumbnail_saved = true;
     if (rename(result.thumbnail_path, final_thumb_path) != 0) {
         ESP_LOGW(TAG, "Failed to move thumbnail");
         unlink(result.thumbnail_path);
+        thumbnail_saved = false;
     }
 
+    album_manager_index_add(album_name, png_filename, thumbnail_saved);
+
     ESP_LOGI(TAG, "Image saved successfully: %s (thumbnail: %s)", png_filename, jpg_filename);
 
     cJSON *response = cJSON_CreateObject();
@@ -992,6 +1159,361 @@ static esp_err_t upload_image_handler(httpd_req_t *req)
 
     return ESP_OK;
 }
+
+// File responses are read straight into this buffer (stdio buffering disabled), sized for
+// efficient SD card transfers and allocated from DMA-capable memory when possible.
+#define FILE_SEND_BUFFER_SIZE (16 * 1024)
+
+typedef enum {
+    BYTE_RANGE_IGNORE,         // not a single "bytes=" range we understand: send the whole file
+    BYTE_RANGE_SATISFIABLE,
+    BYTE_RANGE_UNSATISFIABLE,  // starts past the end of the file
+} byte_range_t;
+
+// Parse a Range header against a file size. Multiple ranges, other units and malformed specs are
+// ignored rather than rejected, as RFC 9110 allows; only a range past EOF is unsatisfiable.
+static byte_range_t parse_byte_range(const char *range, long size, long *start, long *end)
+{
+    if (strncmp(range, "bytes=", 6) != 0 || strchr(range, ',') != NULL) {
+        return BYTE_RANGE_IGNORE;
+    }
+    range += 6;
+
+    char *dash;
+    long first;
+    long last = size - 1;
+    if (*range == '-') {
+        // Suffix range: the last N bytes
+        long suffix = strtol(range + 1, &dash, 10);
+        if (suffix <= 0 || *dash != '\0' || size <= 0) {
+            return BYTE_RANGE_IGNORE;
+        }
+        first = suffix >= size ? 0 : size - suffix;
+    } else {
+        first = strtol(range, &dash, 10);
+        if (dash == range || *dash != '-' || first < 0) {
+            return BYTE_RANGE_IGNORE;
+        }
+        if (dash[1] != '\0') {
+            char *tail;
+            last = strtol(dash + 1, &tail, 10);
+            if (*tail != '\0' || last < first) {
+                return BYTE_RANGE_IGNORE;
+            }
+            if (last >= size) {
+                last = size - 1;
+            }
+        }
+        if (first >= size) {
+            return BYTE_RANGE_UNSATISFIABLE;
+        }
+    }
+
+    *start = first;
+    *end = last;
+    return BYTE_RANGE_SATISFIABLE;
+}
+
+// Does an If-None-Match header value match our ETag (or "*")?
+static bool etag_matches(const char *if_none_match, const char *etag)
+{
+    return strcmp(if_none_match, "*") == 0 || strstr(if_none_match, etag) != NULL;
+}
+
+// Send an open file with a strong ETag, answering If-None-Match with 304 and a single byte
+// Range with 206. Takes ownership of fp.
+static esp_err_t send_file_response(httpd_req_t *req, FILE *fp, const char *path,
+                                    const char *content_type, const char *cache_control)
+{
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0) {
+        fclose(fp);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read image");
+        return ESP_FAIL;
+    }
+
+    // Size and mtime identify the content; the path hash distinguishes files that share both
+    char etag[48];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lx-%llx\"",
+             (unsigned long) esp_rom_crc32_le(0, (const uint8_t *) path, strlen(path)),
+             (unsigned long) st.st_size, (unsigned long long) st.st_mtime);
+
+    httpd_resp_set_type(req, content_type);
+    httpd_resp_set_hdr(req, "Cache-Control", cache_control);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+
+    char header[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", header, sizeof(header)) == ESP_OK &&
+        etag_matches(header, etag)) {
+        fclose(fp);
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    long size = st.st_size;
+    long start = 0;
+    long end = size - 1;
+    char content_range[64];
+    byte_range_t range = BYTE_RANGE_IGNORE;
+    if (httpd_req_get_hdr_value_str(req, "Range", header, sizeof(header)) == ESP_OK) {
+        range = parse_byte_range(header, size, &start, &end);
+    }
+    if (range == BYTE_RANGE_UNSATISFIABLE) {
+        fclose(fp);
+        snprintf(content_range, sizeof(content_range), "bytes */%ld", size);
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    if (range == BYTE_RANGE_SATISFIABLE) {
+        snprintf(content_range, sizeof(content_range), "bytes %ld-%ld/%ld", start, end, size);
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        httpd_resp_set_status(req, "206 Partial Content");
+        if (start > 0 && fseek(fp, start, SEEK_SET) != 0) {
+            fclose(fp);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read image");
+            return ESP_FAIL;
+        }
+    }
+
+    char *buffer = heap_caps_malloc(FILE_SEND_BUFFER_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    size_t buffer_size = FILE_SEND_BUFFER_SIZE;
+    if (!buffer) {
+        buffer_size = FILE_SEND_BUFFER_SIZE / 4;
+        buffer = malloc(buffer_size);
+    }
+    if (!buffer) {
+        fclose(fp);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    esp_err_t err = ESP_OK;
+    long remaining = end - start + 1;
+    while (remaining > 0) {
+        size_t to_read = remaining < (long) buffer_size ? (size_t) remaining : buffer_size;
+        size_t read_bytes = fread(buffer, 1, to_read, fp);
+        if (read_bytes == 0) {
+            break;
+        }
+        metrics_add(METRICS_STORAGE_BYTES_READ, read_bytes);
+        if (httpd_resp_send_chunk(req, buffer, read_bytes) != ESP_OK) {
+            err = ESP_FAIL;
+            break;
+        }
+        remaining -= read_bytes;
+    }
+
+    heap_caps_free(buffer);
+    fclose(fp);
+
+    if (err == ESP_OK) {
+        httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return err;
+}
+
+// Web UI files, embedded gzip-compressed by main/CMakeLists.txt
+typedef struct {
+    const char *uri;
+    const char *content_type;
+    const uint8_t *gz_start;
+    const uint8_t *gz_end;
+    bool immutable;  // content-hashed filename, never changes behind the same URI
+} web_asset_t;
+
+static const web_asset_t web_assets[] = {WEBAPP_ASSET_TABLE};
+
+#define WEB_ASSET_COUNT (sizeof(web_assets) / sizeof(web_assets[0]))
+#define GZIP_HEADER_SIZE 10
+#define GZIP_TRAILER_SIZE 8
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+           ((uint32_t) p[3] << 24);
+}
+
+static bool client_accepts_gzip(httpd_req_t *req)
+{
+    size_t len = httpd_req_get_hdr_value_len(req, "Accept-Encoding");
+    if (len == 0) {
+        return false;
+    }
+
+    char *value = malloc(len + 1);
+    if (!value) {
+        return false;
+    }
+    bool gzip = httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, len + 1) == ESP_OK &&
+                strstr(value, "gzip") != NULL;
+    free(value);
+    return gzip;
+}
+
+// Locate the raw deflate stream inside a single gzip member (RFC 1952)
+static const uint8_t *gzip_deflate_data(const uint8_t *gz, size_t gz_len, size_t *deflate_len)
+{
+    if (gz_len < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE || gz[0] != 0x1f || gz[1] != 0x8b ||
+        gz[2] != 8) {
+        return NULL;
+    }
+
+    uint8_t flags = gz[3];
+    size_t limit = gz_len - GZIP_TRAILER_SIZE;
+    size_t pos = GZIP_HEADER_SIZE;
+
+    if (flags & 0x04) {  // FEXTRA
+        if (pos + 2 > limit) {
+            return NULL;
+        }
+        pos += 2 + (gz[pos] | (gz[pos + 1] << 8));
+    }
+    if (flags & 0x08) {  // FNAME
+        while (pos < limit && gz[pos] != 0) {
+            pos++;
+        }
+        pos++;
+    }
+    if (flags & 0x10) {  // FCOMMENT
+        while (pos < limit && gz[pos] != 0) {
+            pos++;
+        }
+        pos++;
+    }
+    if (flags & 0x02) {  // FHCRC
+        pos += 2;
+    }
+    if (pos > limit) {
+        return NULL;
+    }
+
+    *deflate_len = limit - pos;
+    return gz + pos;
+}
+
+// Fallback for clients that do not accept gzip: inflate through the 32 KB window with the ROM
+// decompressor and send each filled stretch as a chunk
+static esp_err_t send_inflated_asset(httpd_req_t *req, const web_asset_t *asset)
+{
+    size_t in_len;
+    const uint8_t *in = gzip_deflate_data(asset->gz_start, asset->gz_end - asset->gz_start, &in_len);
+    if (!in) {
+        ESP_LOGE(TAG, "Embedded asset %s is not valid gzip", asset->uri);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Corrupt asset");
+        return ESP_FAIL;
+    }
+
+    tinfl_decompressor *inflator = malloc(sizeof(tinfl_decompressor));
+    uint8_t *window = heap_caps_malloc(TINFL_LZ_DICT_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!window) {
+        window = malloc(TINFL_LZ_DICT_SIZE);
+    }
+    if (!inflator || !window) {
+        free(inflator);
+        heap_caps_free(window);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    tinfl_init(inflator);
+
+    esp_err_t err = ESP_OK;
+    size_t out_pos = 0;
+    tinfl_status status;
+    do {
+        size_t in_bytes = in_len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - out_pos;
+        status = tinfl_decompress(inflator, in, &in_bytes, window, window + out_pos, &out_bytes, 0);
+        in += in_bytes;
+        in_len -= in_bytes;
+
+        if (out_bytes > 0 &&
+            httpd_resp_send_chunk(req, (const char *) window + out_pos, out_bytes) != ESP_OK) {
+            err = ESP_FAIL;
+            break;
+        }
+        out_pos = (out_pos + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+    } while (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+
+    if (err == ESP_OK && status != TINFL_STATUS_DONE) {
+        ESP_LOGE(TAG, "Failed to inflate %s (status %d)", asset->uri, (int) status);
+        err = ESP_FAIL;
+    }
+
+    free(inflator);
+    heap_caps_free(window);
+
+    if (err == ESP_OK) {
+        httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return err;
+}
+
+#define WEB_ASSET_DIR "/assets/"
+
+// Look up an asset by request URI, ignoring any query string
+static const web_asset_t *find_web_asset(const char *uri)
+{
+    size_t uri_len = strcspn(uri, "?");
+    for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        if (strlen(web_assets[i].uri) == uri_len &&
+            strncmp(web_assets[i].uri, uri, uri_len) == 0) {
+            return &web_assets[i];
+        }
+    }
+    return NULL;
+}
+
+// Root files have a route each; everything under /assets/ shares one wildcard route (no
+// user_ctx), so the number of hashed Vite chunks doesn't eat into max_uri_handlers
+static esp_err_t web_asset_handler(httpd_req_t *req)
+{
+    const web_asset_t *asset = (const web_asset_t *) req->user_ctx;
+    if (!asset) {
+        asset = find_web_asset(req->uri);
+    }
+    if (!asset) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        return ESP_FAIL;
+    }
+    size_t gz_len = asset->gz_end - asset->gz_start;
+    if (gz_len < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Corrupt asset");
+        return ESP_FAIL;
+    }
+
+    bool gzip = client_accepts_gzip(req);
+
+    // The gzip trailer carries the CRC32 and length of the original file, which makes a
+    // content hash that stays the same across firmware builds as long as the file does
+    const uint8_t *trailer = asset->gz_end - GZIP_TRAILER_SIZE;
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lx%s\"", (unsigned long) read_le32(trailer),
+             (unsigned long) read_le32(trailer + 4), gzip ? "-gz" : "");
+
+    httpd_resp_set_type(req, asset->content_type);
+    httpd_resp_set_hdr(req, "Cache-Control",
+                       asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    char header[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", header, sizeof(header)) == ESP_OK &&
+        etag_matches(header, etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    if (!gzip) {
+        return send_inflated_asset(req, asset);
+    }
+
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *) asset->gz_start, gz_len);
+}
+
 static esp_err_t serve_image_handler(httpd_req_t *req)
 {
     if (!system_ready) {
@@ -1084,23 +1606,8 @@ static esp_err_t serve_image_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    httpd_resp_set_type(req, content_type);
-    // Cache images for 1 hour to reduce server load
-    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=3600");
-
-    char buffer[1024];
-    size_t read_bytes;
-    while ((read_bytes = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
-        if (httpd_resp_send_chunk(req, buffer, read_bytes) != ESP_OK) {
-            fclose(fp);
-            return ESP_FAIL;
-        }
-    }
-
-    fclose(fp);
-    httpd_resp_send_chunk(req, NULL, 0);
-
-    return ESP_OK;
+    // Cache images for 1 hour to reduce server load; revalidation is cheap thanks to the ETag
+    return send_file_response(req, fp, filepath, content_type, "public, max-age=3600");
 }
 
 static esp_err_t delete_image_handler(httpd_req_t *req)
@@ -1177,6 +1684,14 @@ static esp_err_t delete_image_handler(httpd_req_t *req)
     // Delete thumbnail (ignore errors if it doesn't exist)
     unlink(jpg_path);
 
+    // filepath_copy is "album/file.bmp"
+    char *slash = strchr(filepath_copy, '/');
+    if (slash) {
+        *slash = '\0';
+        album_manager_index_remove(filepath_copy, slash + 1);
+        *slash = '/';
+    }
+
     ESP_LOGI(TAG, "Image deleted successfully: %s", filepath_copy);
 
     cJSON *response = cJSON_CreateObject();
@@ -1192,6 +1707,43 @@ static esp_err_t delete_image_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+typedef struct {
+    char filepath[512];
+    bool force_refresh;
+} display_file_job_t;
+
+// Set the overlay stamped on every displayed image from a request field: a JSON array, or null
+// to remove it
+static esp_err_t set_display_overlay(const cJSON *overlay)
+{
+    if (cJSON_IsNull(overlay)) {
+        return display_manager_set_overlay(NULL);
+    }
+
+    char *spec = cJSON_PrintUnformatted(overlay);
+    if (!spec) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = display_manager_set_overlay(spec);
+    free(spec);
+    return err;
+}
+
+static esp_err_t display_file_job_run(void *arg)
+{
+    display_file_job_t *job = (display_file_job_t *) arg;
+
+    esp_err_t err = display_manager_show_image(job->filepath, job->force_refresh);
+    if (err == ESP_OK) {
+        image_profile_t profile = {.job_id = display_manager_get_running_job_id()};
+        image_processor_profile_add_stage(&profile, IMAGE_STAGE_PAINT,
+                                          display_manager_get_last_paint_us());
+        image_processor_profile_save(&profile);
+        ha_notify_update();
+    }
+    return err;
+}
+
 static esp_err_t display_image_handler(httpd_req_t *req)
 {
     if (!system_ready) {
@@ -1202,32 +1754,36 @@ static esp_err_t display_image_handler(httpd_req_t *req)
 
     power_manager_reset_sleep_timer();
 
-    // Check if display is already busy
-    if (display_manager_is_busy()) {
-        ESP_LOGW(TAG, "Display is busy, rejecting request");
-        cJSON *response = cJSON_CreateObject();
-        cJSON_AddStringToObject(response, "status", "busy");
-        cJSON_AddStringToObject(response, "message", "Display is currently updating, please wait");
-
-        char *json_str = cJSON_Print(response);
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_set_status(req, "503 Service Unavailable");
-        httpd_resp_sendstr(req, json_str);
-
-        free(json_str);
-        cJSON_Delete(response);
-        return ESP_OK;
-    }
-
-    char buf[256];
-    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
-    if (ret <= 0) {
+    // Large enough for a filepath plus a full overlay spec
+    size_t buf_size = req->content_len + 1;
+    if (req->content_len == 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No data received");
         return ESP_FAIL;
     }
-    buf[ret] = '\0';
+    if (buf_size > 4096) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Request body too large");
+        return ESP_FAIL;
+    }
+    char *buf = malloc(buf_size);
+    if (!buf) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    int received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret <= 0) {
+            free(buf);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No data received");
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    buf[received] = '\0';
 
     cJSON *root = cJSON_Parse(buf);
+    free(buf);
     if (!root) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
         return ESP_FAIL;
@@ -1248,35 +1804,99 @@ static esp_err_t display_image_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
+    display_file_job_t *job = calloc(1, sizeof(display_file_job_t));
+    if (!job) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+        return ESP_FAIL;
+    }
+
     // Build absolute path - filepath is "album/file.bmp" format
-    char filepath[512];
-    snprintf(filepath, sizeof(filepath), "%s/%s", IMAGE_DIRECTORY, filepath_str);
+    snprintf(job->filepath, sizeof(job->filepath), "%s/%s", IMAGE_DIRECTORY, filepath_str);
 
-    esp_err_t err = display_manager_show_image(filepath);
+    // Optional: refresh even if the image is identical to what is shown
+    cJSON *force_obj = cJSON_GetObjectItem(root, "force");
+    job->force_refresh = cJSON_IsTrue(force_obj);
 
-    cJSON_Delete(root);
-    if (err != ESP_OK) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to display image");
+    // Fail fast on a bad path, the job itself only reports its result asynchronously
+    struct stat st;
+    if (stat(job->filepath, &st) != 0) {
+        cJSON_Delete(root);
+        free(job);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Image not found");
         return ESP_FAIL;
     }
 
-    ha_notify_update();
+    // Optional: replace the text stamped on top of this and later images, e.g. time and battery
+    cJSON *overlay_obj = cJSON_GetObjectItem(root, "overlay");
+    if (overlay_obj && set_display_overlay(overlay_obj) != ESP_OK) {
+        cJSON_Delete(root);
+        free(job);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid overlay");
+        return ESP_FAIL;
+    }
+    cJSON_Delete(root);
+
+    uint32_t job_id = 0;
+    if (display_manager_submit_job(display_file_job_run, job, free, &job_id) != ESP_OK) {
+        free(job);
+        return send_display_busy(req);
+    }
+
+    return send_display_job_accepted(req, job_id);
+}
+
+static esp_err_t display_status_handler(httpd_req_t *req)
+{
+    uint32_t job_id = display_manager_get_last_job_id();
+
+    char query[64];
+    char id_param[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "id", id_param, sizeof(id_param)) == ESP_OK) {
+        job_id = strtoul(id_param, NULL, 10);
+    }
+
+    display_job_status_t status;
+    if (job_id == 0 || display_manager_get_job_status(job_id, &status) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Display job not found");
+        return ESP_FAIL;
+    }
 
     cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "status", "success");
+    cJSON_AddNumberToObject(response, "job_id", status.id);
+    cJSON_AddStringToObject(response, "state", display_manager_job_state_to_string(status.state));
+
+    if (status.state == DISPLAY_JOB_SUPERSEDED) {
+        cJSON_AddNumberToObject(response, "superseded_by", status.superseded_by);
+    } else if (status.state == DISPLAY_JOB_FAILED) {
+        cJSON_AddStringToObject(response, "error", esp_err_to_name(status.result));
+        if (status.result == ESP_ERR_INVALID_SIZE) {
+            cJSON_AddStringToObject(response, "message",
+                                    "Image is too large. Please resize and try again.");
+        } else if (status.result == ESP_ERR_NO_MEM) {
+            cJSON_AddStringToObject(response, "message",
+                                    "Image requires too much memory to process.");
+        } else {
+            cJSON_AddStringToObject(response, "message", "Failed to display image");
+        }
+    }
+
+    image_profile_t profile;
+    if (image_processor_profile_find_job(status.id, &profile)) {
+        cJSON *profile_json = image_processor_profile_to_json(&profile);
+        if (profile_json) {
+            cJSON_AddItemToObject(response, "profile", profile_json);
+        }
+    }
 
     char *json_str = cJSON_Print(response);
     httpd_resp_set_type(req, "application/json");
-
-    esp_err_t send_err = httpd_resp_sendstr(req, json_str);
+    httpd_resp_sendstr(req, json_str);
 
     free(json_str);
     cJSON_Delete(response);
 
-    if (send_err != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to send response (connection likely closed): %d", send_err);
-    }
-
     return ESP_OK;
 }
 
@@ -1430,22 +2050,12 @@ static esp_err_t rotate_handler(httpd_req_t *req)
 
     power_manager_reset_sleep_timer();
 
-    // Synchronous rotation as requested by maintainer
-    trigger_image_rotation();
-    ha_notify_update();
-
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "status", "success");
-    cJSON_AddStringToObject(response, "message", "Image rotation triggered");
-
-    char *json_str = cJSON_Print(response);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, json_str);
-
-    free(json_str);
-    cJSON_Delete(response);
+    uint32_t job_id = 0;
+    if (queue_image_rotation(&job_id) != ESP_OK) {
+        return send_display_busy(req);
+    }
 
-    return ESP_OK;
+    return send_display_job_accepted(req, job_id);
 }
 
 static esp_err_t current_image_handler(httpd_req_t *req)
@@ -1514,23 +2124,8 @@ static esp_err_t current_image_handler(httpd_req_t *req)
         ESP_LOGI(TAG, "Serving thumbnail image %s for %s", thumbnail_path, image_to_serve);
     }
 
-    httpd_resp_set_type(req, content_type);
     // Cache for 30 seconds since current image changes infrequently
-    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=30");
-
-    char buffer[1024];
-    size_t read_bytes;
-    while ((read_bytes = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
-        if (httpd_resp_send_chunk(req, buffer, read_bytes) != ESP_OK) {
-            fclose(fp);
-            return ESP_FAIL;
-        }
-    }
-
-    fclose(fp);
-    httpd_resp_send_chunk(req, NULL, 0);
-
-    return ESP_OK;
+    return send_file_response(req, fp, image_to_serve, content_type, "public, max-age=30");
 }
 
 static esp_err_t config_handler(httpd_req_t *req)
@@ -1563,6 +2158,9 @@ static esp_err_t config_handler(httpd_req_t *req)
                                                                                       : "portrait");
         cJSON_AddNumberToObject(root, "display_rotation_deg",
                                 config_manager_get_display_rotation_deg());
+        cJSON *display_overlay = cJSON_Parse(config_manager_get_display_overlay());
+        cJSON_AddItemToObject(root, "display_overlay",
+                              display_overlay ? display_overlay : cJSON_CreateArray());
 
         // Auto Rotate
         cJSON_AddBoolToObject(root, "auto_rotate", config_manager_get_auto_rotate());
@@ -1603,6 +2201,8 @@ static esp_err_t config_handler(httpd_req_t *req)
 
         cJSON_AddBoolToObject(root, "save_downloaded_images",
                               config_manager_get_save_downloaded_images());
+        cJSON_AddBoolToObject(root, "prefetch_next_image",
+                              config_manager_get_prefetch_next_image());
 
         // Home Assistant
         const char *ha_url = config_manager_get_ha_url();
@@ -1656,6 +2256,17 @@ static esp_err_t config_handler(httpd_req_t *req)
             return ESP_FAIL;
         }
 
+        // Checked before anything else is applied, so an invalid spec rejects the whole request
+        cJSON *display_overlay_obj = cJSON_GetObjectItem(root, "display_overlay");
+        if (display_overlay_obj && set_display_overlay(display_overlay_obj) != ESP_OK) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid display_overlay");
+            return ESP_FAIL;
+        }
+
+        // Stage every setting below and save them with one NVS commit at the end
+        config_manager_begin();
+
         // General
         cJSON *device_name_obj = cJSON_GetObjectItem(root, "device_name");
         if (device_name_obj && cJSON_IsString(device_name_obj)) {
@@ -1722,6 +2333,9 @@ static esp_err_t config_handler(httpd_req_t *req)
                              "Failed to connect to new WiFi, reverting to previous credentials");
                     wifi_manager_connect(current_ssid, config_manager_get_wifi_password());
 
+                    // Keep the settings applied before the WiFi fields
+                    config_manager_commit(NULL);
+
                     // Return error response
                     cJSON_Delete(root);
                     cJSON *error_response = cJSON_CreateObject();
@@ -1847,6 +2461,11 @@ static esp_err_t config_handler(httpd_req_t *req)
             config_manager_set_save_downloaded_images(save_dl);
         }
 
+        cJSON *prefetch_obj = cJSON_GetObjectItem(root, "prefetch_next_image");
+        if (prefetch_obj && cJSON_IsBool(prefetch_obj)) {
+            config_manager_set_prefetch_next_image(cJSON_IsTrue(prefetch_obj));
+        }
+
         // Home Assistant
         cJSON *ha_url_obj = cJSON_GetObjectItem(root, "ha_url");
         if (ha_url_obj && cJSON_IsString(ha_url_obj)) {
@@ -1875,8 +2494,15 @@ static esp_err_t config_handler(httpd_req_t *req)
 
         cJSON_Delete(root);
 
+        int64_t commit_us = 0;
+        if (config_manager_commit(&commit_us) != ESP_OK) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save settings");
+            return ESP_FAIL;
+        }
+
         cJSON *response = cJSON_CreateObject();
         cJSON_AddStringToObject(response, "status", "success");
+        cJSON_AddNumberToObject(response, "commit_ms", commit_us / 1000.0);
 
         char *json_str = cJSON_Print(response);
         httpd_resp_set_type(req, "application/json");
@@ -2090,6 +2716,36 @@ static esp_err_t album_enabled_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Append a JSON string literal (with quotes) to buf, escaping as needed. Returns the new length,
+// or 0 if it doesn't fit.
+static size_t json_append_string(char *buf, size_t len, size_t size, const char *str)
+{
+    if (len + 2 >= size) {
+        return 0;
+    }
+    buf[len++] = '"';
+    for (const unsigned char *p = (const unsigned char *) str; *p; p++) {
+        if (len + 7 >= size) {
+            return 0;
+        }
+        if (*p == '"' || *p == '\\') {
+            buf[len++] = '\\';
+            buf[len++] = *p;
+        } else if (*p < 0x20) {
+            len += snprintf(buf + len, size - len, "\\u%04x", *p);
+        } else {
+            buf[len++] = *p;
+        }
+    }
+    buf[len++] = '"';
+    buf[len] = '\0';
+    return len;
+}
+
+#define ALBUM_IMAGES_BATCH 32
+#define ALBUM_IMAGES_CHUNK_SIZE 2048
+#define ALBUM_IMAGES_ITEM_SIZE 1024  // Fits any entry with escaped filename and album name
+
 static esp_err_t album_images_handler(httpd_req_t *req)
 {
     if (!system_ready) {
@@ -2104,15 +2760,28 @@ static esp_err_t album_images_handler(httpd_req_t *req)
 
     char query[256];
     char album_name[128] = "";
+    int offset = 0;
+    int limit = -1;  // No limit
 
     if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char param[16];
         httpd_query_key_value(query, "album", album_name, sizeof(album_name));
+        if (httpd_query_key_value(query, "offset", param, sizeof(param)) == ESP_OK) {
+            offset = atoi(param);
+        }
+        if (httpd_query_key_value(query, "limit", param, sizeof(param)) == ESP_OK) {
+            limit = atoi(param);
+        }
     }
 
     if (strlen(album_name) == 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing album parameter");
         return ESP_FAIL;
     }
+    if (offset < 0 || (limit < 0 && limit != -1)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid offset or limit");
+        return ESP_FAIL;
+    }
 
     // URL decode the album name to handle special characters like '+'
     char decoded_album_name[128];
@@ -2125,55 +2794,105 @@ static esp_err_t album_images_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    DIR *dir = opendir(album_path);
-    if (!dir) {
+    int total = 0;
+    if (album_manager_index_get_count(decoded_album_name, &total) != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to open album directory");
         return ESP_FAIL;
     }
 
-    cJSON *response = cJSON_CreateArray();
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_type == DT_REG) {
-            if (entry->d_name[0] == '.' && entry->d_name[1] == '_') {
+    album_index_entry_t *entries = malloc(ALBUM_IMAGES_BATCH * sizeof(album_index_entry_t));
+    char *chunk = malloc(ALBUM_IMAGES_CHUNK_SIZE + ALBUM_IMAGES_ITEM_SIZE);
+    if (!entries || !chunk) {
+        free(entries);
+        free(chunk);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    char total_str[16];
+    snprintf(total_str, sizeof(total_str), "%d", total);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "X-Total-Count", total_str);
+
+    // The response is streamed as a JSON array, one batch of index entries at a time
+    char *item = chunk + ALBUM_IMAGES_CHUNK_SIZE;
+    esp_err_t err = ESP_OK;
+    bool streaming = false;  // a chunk has gone out, so the status can no longer change
+    size_t len = 0;
+    int sent = 0;
+    int position = offset;
+    chunk[len++] = '[';
+
+    while (err == ESP_OK && (limit < 0 || sent < limit)) {
+        int want = ALBUM_IMAGES_BATCH;
+        if (limit >= 0 && limit - sent < want) {
+            want = limit - sent;
+        }
+        int got = 0;
+        if (album_manager_index_read(decoded_album_name, position, entries, want, &got) !=
+            ESP_OK) {
+            // Don't close the array: a 500, or a chunked body cut off without its terminating
+            // chunk, tells the client the list is incomplete
+            ESP_LOGE(TAG, "Failed to read index of album %s at %d", decoded_album_name, position);
+            if (!streaming) {
+                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                    "Failed to read album index");
+            }
+            err = ESP_FAIL;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        position += got;
+
+        for (int i = 0; i < got && err == ESP_OK; i++) {
+            const char *filename = entries[i].filename;
+            const char *ext = strrchr(filename, '.');
+            char thumbnail_name[ALBUM_INDEX_NAME_MAX];
+            snprintf(thumbnail_name, sizeof(thumbnail_name), "%.*s.jpg",
+                     (int) (ext ? ext - filename : strlen(filename)), filename);
+
+            size_t n = snprintf(item, ALBUM_IMAGES_ITEM_SIZE, "%s{\"filename\":",
+                                sent > 0 ? "," : "");
+            n = json_append_string(item, n, ALBUM_IMAGES_ITEM_SIZE, filename);
+            if (n) {
+                n += snprintf(item + n, ALBUM_IMAGES_ITEM_SIZE - n, ",\"album\":");
+                n = json_append_string(item, n, ALBUM_IMAGES_ITEM_SIZE, decoded_album_name);
+            }
+            // Thumbnail presence comes from the index, no stat() per image
+            if (n && (entries[i].flags & ALBUM_INDEX_FLAG_THUMBNAIL)) {
+                n += snprintf(item + n, ALBUM_IMAGES_ITEM_SIZE - n, ",\"thumbnail\":");
+                n = json_append_string(item, n, ALBUM_IMAGES_ITEM_SIZE, thumbnail_name);
+            }
+            if (!n || n + 1 >= ALBUM_IMAGES_ITEM_SIZE) {
+                ESP_LOGW(TAG, "Skipping oversized entry: %s", filename);
                 continue;
             }
-            const char *ext = strrchr(entry->d_name, '.');
-            if (ext && (strcmp(ext, ".bmp") == 0 || strcmp(ext, ".BMP") == 0 ||
-                        strcmp(ext, ".png") == 0 || strcmp(ext, ".PNG") == 0)) {
-                cJSON *image_obj = cJSON_CreateObject();
-                cJSON_AddStringToObject(image_obj, "filename", entry->d_name);
-                cJSON_AddStringToObject(image_obj, "album", decoded_album_name);
-
-                // Check if a corresponding JPG thumbnail exists for any image type
-                char thumbnail_name[256];
-                char thumbnail_path[512];
-
-                // Extract base name without extension
-                int base_len = ext - entry->d_name;
-                snprintf(thumbnail_name, sizeof(thumbnail_name), "%.*s.jpg", base_len,
-                         entry->d_name);
-                snprintf(thumbnail_path, sizeof(thumbnail_path), "%s/%s", album_path,
-                         thumbnail_name);
-
-                // Check if thumbnail file exists
-                struct stat st;
-                if (stat(thumbnail_path, &st) == 0) {
-                    cJSON_AddStringToObject(image_obj, "thumbnail", thumbnail_name);
-                }
+            item[n++] = '}';
 
-                cJSON_AddItemToArray(response, image_obj);
+            if (len + n + 1 > ALBUM_IMAGES_CHUNK_SIZE) {  // Keep room for the closing ']'
+                err = httpd_resp_send_chunk(req, chunk, len);
+                streaming = true;
+                len = 0;
             }
+            memcpy(chunk + len, item, n);
+            len += n;
+            sent++;
         }
     }
-    closedir(dir);
 
-    char *json_str = cJSON_Print(response);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, json_str);
-    free(json_str);
-    cJSON_Delete(response);
-    return ESP_OK;
+    if (err == ESP_OK) {
+        chunk[len++] = ']';
+        err = httpd_resp_send_chunk(req, chunk, len);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    free(entries);
+    free(chunk);
+    return err;
 }
 
 static esp_err_t system_info_handler(httpd_req_t *req)
@@ -2225,6 +2944,50 @@ static esp_err_t system_info_handler(httpd_req_t *req)
     cJSON_AddStringToObject(response, "compile_date", app_desc->date);
     cJSON_AddStringToObject(response, "idf_version", app_desc->idf_ver);
 
+    wifi_connect_stats_t wifi_stats;
+    wifi_manager_get_connect_stats(&wifi_stats);
+    cJSON_AddNumberToObject(response, "wifi_connect_ms", wifi_stats.connect_ms);
+    cJSON_AddBoolToObject(response, "wifi_fast_connect", wifi_stats.fast);
+    cJSON_AddBoolToObject(response, "wifi_cached_lease", wifi_stats.cached_lease);
+
+    char *json_str = cJSON_Print(response);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(response);
+    return ESP_OK;
+}
+
+static esp_err_t timeline_handler(httpd_req_t *req)
+{
+    cJSON *response = timeline_to_json();
+    if (!response) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    char *json_str = cJSON_Print(response);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(response);
+    return ESP_OK;
+}
+
+static esp_err_t pipeline_profiles_handler(httpd_req_t *req)
+{
+    cJSON *response = cJSON_CreateObject();
+    cJSON *profiles = image_processor_profile_history_to_json();
+    if (!response || !profiles) {
+        cJSON_Delete(response);
+        cJSON_Delete(profiles);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    cJSON_AddItemToObject(response, "profiles", profiles);
+
     char *json_str = cJSON_Print(response);
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, json_str);
@@ -2234,6 +2997,20 @@ static esp_err_t system_info_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    char *text = metrics_render();
+    if (!text) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+    httpd_resp_sendstr(req, text);
+    free(text);
+    return ESP_OK;
+}
+
 static esp_err_t ota_status_handler(httpd_req_t *req)
 {
     ota_status_t status;
@@ -2772,6 +3549,75 @@ static esp_err_t color_palette_handler(httpd_req_t *req)
     return ESP_FAIL;
 }
 
+// Every handler runs through metered_handler, which records its latency by URI and method
+typedef struct {
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+    int route;
+} metered_uri_t;
+
+static metered_uri_t metered_uris[METRICS_MAX_ROUTES];
+
+static esp_err_t metered_handler(httpd_req_t *req)
+{
+    const metered_uri_t *metered = req->user_ctx;
+    req->user_ctx = metered->user_ctx;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = metered->handler(req);
+    metrics_http_request(metered->route, esp_timer_get_time() - start);
+    return err;
+}
+
+static esp_err_t register_uri_handler(const httpd_uri_t *uri)
+{
+    int route = metrics_register_route(uri->uri, http_method_str(uri->method));
+    if (route < 0) {
+        return httpd_register_uri_handler(server, uri);
+    }
+
+    metered_uris[route] =
+        (metered_uri_t){.handler = uri->handler, .user_ctx = uri->user_ctx, .route = route};
+    httpd_uri_t metered = *uri;
+    metered.handler = metered_handler;
+    metered.user_ctx = &metered_uris[route];
+    return httpd_register_uri_handler(server, &metered);
+}
+
+// Same as the server's default socket I/O, plus byte counts
+static int metered_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    if (!buf) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+    int ret = send(sockfd, buf, buf_len, flags);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+    metrics_add(METRICS_HTTP_BYTES_SENT, ret);
+    return ret;
+}
+
+static int metered_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len, int flags)
+{
+    if (!buf) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+    int ret = recv(sockfd, buf, buf_len, flags);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+    metrics_add(METRICS_HTTP_BYTES_RECEIVED, ret);
+    return ret;
+}
+
+static esp_err_t http_session_open(httpd_handle_t hd, int sockfd)
+{
+    httpd_sess_set_send_override(hd, sockfd, metered_send);
+    httpd_sess_set_recv_override(hd, sockfd, metered_recv);
+    return ESP_OK;
+}
+
 esp_err_t http_server_init(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
@@ -2779,247 +3625,253 @@ esp_err_t http_server_init(void)
     config.stack_size = 12288;       // Increased from 8192 to 12KB
     config.max_open_sockets = 10;    // Limit concurrent connections to prevent memory exhaustion
     config.lru_purge_enable = true;  // Enable LRU purging of connections
+    config.open_fn = http_session_open;
+    config.uri_match_fn = httpd_uri_match_wildcard;  // for WEB_ASSET_DIR "*"
 
     if (httpd_start(&server, &config) == ESP_OK) {
-        httpd_uri_t index_uri = {
-            .uri = "/", .method = HTTP_GET, .handler = index_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &index_uri);
-
-        httpd_uri_t index_css_uri = {.uri = "/assets/index.css",
-                                     .method = HTTP_GET,
-                                     .handler = index_css_handler,
-                                     .user_ctx = NULL};
-        httpd_register_uri_handler(server, &index_css_uri);
-
-        httpd_uri_t index_js_uri = {.uri = "/assets/index.js",
-                                    .method = HTTP_GET,
-                                    .handler = index_js_handler,
-                                    .user_ctx = NULL};
-        httpd_register_uri_handler(server, &index_js_uri);
-
-        httpd_uri_t index2_js_uri = {.uri = "/assets/index2.js",
+        httpd_uri_t assets_uri = {.uri = WEB_ASSET_DIR "*",
+                                  .method = HTTP_GET,
+                                  .handler = web_asset_handler,
+                                  .user_ctx = NULL};
+        if (register_uri_handler(&assets_uri) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register %s", assets_uri.uri);
+        }
+        for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+            if (strncmp(web_assets[i].uri, WEB_ASSET_DIR, strlen(WEB_ASSET_DIR)) == 0) {
+                continue;
+            }
+            httpd_uri_t asset_uri = {.uri = web_assets[i].uri,
                                      .method = HTTP_GET,
-                                     .handler = index2_js_handler,
-                                     .user_ctx = NULL};
-        httpd_register_uri_handler(server, &index2_js_uri);
-
-        httpd_uri_t exif_reader_js_uri = {.uri = "/assets/exif-reader.js",
-                                          .method = HTTP_GET,
-                                          .handler = exif_reader_js_handler,
-                                          .user_ctx = NULL};
-        httpd_register_uri_handler(server, &exif_reader_js_uri);
-
-        httpd_uri_t browser_js_uri = {.uri = "/assets/browser.js",
-                                      .method = HTTP_GET,
-                                      .handler = browser_js_handler,
-                                      .user_ctx = NULL};
-        httpd_register_uri_handler(server, &browser_js_uri);
-
-        httpd_uri_t vite_browser_external_js_uri = {.uri = "/assets/__vite-browser-external.js",
-                                                    .method = HTTP_GET,
-                                                    .handler = vite_browser_external_js_handler,
-                                                    .user_ctx = NULL};
-        httpd_register_uri_handler(server, &vite_browser_external_js_uri);
-
-        httpd_uri_t favicon_uri = {.uri = "/favicon.svg",
-                                   .method = HTTP_GET,
-                                   .handler = favicon_handler,
-                                   .user_ctx = NULL};
-        httpd_register_uri_handler(server, &favicon_uri);
+                                     .handler = web_asset_handler,
+                                     .user_ctx = (void *) &web_assets[i]};
+            if (register_uri_handler(&asset_uri) != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to register %s", web_assets[i].uri);
+            }
+        }
 
         httpd_uri_t measurement_sample_uri = {.uri = "/measurement_sample.jpg",
                                               .method = HTTP_GET,
                                               .handler = measurement_sample_handler,
                                               .user_ctx = NULL};
-        httpd_register_uri_handler(server, &measurement_sample_uri);
+        register_uri_handler(&measurement_sample_uri);
 
         httpd_uri_t rotate_uri = {
             .uri = "/api/rotate", .method = HTTP_POST, .handler = rotate_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &rotate_uri);
+        register_uri_handler(&rotate_uri);
 
         httpd_uri_t current_image_uri = {.uri = "/api/current_image",
                                          .method = HTTP_GET,
                                          .handler = current_image_handler,
                                          .user_ctx = NULL};
-        httpd_register_uri_handler(server, &current_image_uri);
+        register_uri_handler(&current_image_uri);
 
         httpd_uri_t config_get_uri = {
             .uri = "/api/config", .method = HTTP_GET, .handler = config_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &config_get_uri);
+        register_uri_handler(&config_get_uri);
 
         httpd_uri_t config_post_uri = {
             .uri = "/api/config", .method = HTTP_POST, .handler = config_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &config_post_uri);
+        register_uri_handler(&config_post_uri);
 
         httpd_uri_t config_patch_uri = {.uri = "/api/config",
                                         .method = HTTP_PATCH,
                                         .handler = config_handler,
                                         .user_ctx = NULL};
-        httpd_register_uri_handler(server, &config_patch_uri);
+        register_uri_handler(&config_patch_uri);
 
         httpd_uri_t battery_uri = {.uri = "/api/battery",
                                    .method = HTTP_GET,
                                    .handler = battery_handler,
                                    .user_ctx = NULL};
-        httpd_register_uri_handler(server, &battery_uri);
+        register_uri_handler(&battery_uri);
 
         httpd_uri_t sensor_uri = {
             .uri = "/api/sensor", .method = HTTP_GET, .handler = sensor_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &sensor_uri);
+        register_uri_handler(&sensor_uri);
 
         httpd_uri_t sleep_uri = {
             .uri = "/api/sleep", .method = HTTP_POST, .handler = sleep_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &sleep_uri);
+        register_uri_handler(&sleep_uri);
 
         httpd_uri_t system_info_uri = {.uri = "/api/system-info",
                                        .method = HTTP_GET,
                                        .handler = system_info_handler,
                                        .user_ctx = NULL};
-        httpd_register_uri_handler(server, &system_info_uri);
+        register_uri_handler(&system_info_uri);
+
+        httpd_uri_t timeline_uri = {.uri = "/api/timeline",
+                                    .method = HTTP_GET,
+                                    .handler = timeline_handler,
+                                    .user_ctx = NULL};
+        register_uri_handler(&timeline_uri);
+
+        httpd_uri_t metrics_uri = {.uri = "/api/metrics",
+                                   .method = HTTP_GET,
+                                   .handler = metrics_handler,
+                                   .user_ctx = NULL};
+        register_uri_handler(&metrics_uri);
+
+        httpd_uri_t pipeline_profiles_uri = {.uri = "/api/pipeline-profiles",
+                                             .method = HTTP_GET,
+                                             .handler = pipeline_profiles_handler,
+                                             .user_ctx = NULL};
+        register_uri_handler(&pipeline_profiles_uri);
 
         httpd_uri_t time_uri = {
             .uri = "/api/time", .method = HTTP_GET, .handler = time_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &time_uri);
+        register_uri_handler(&time_uri);
 
         httpd_uri_t time_sync_uri = {.uri = "/api/time/sync",
                                      .method = HTTP_POST,
                                      .handler = time_sync_handler,
                                      .user_ctx = NULL};
-        httpd_register_uri_handler(server, &time_sync_uri);
+        register_uri_handler(&time_sync_uri);
 
         httpd_uri_t ota_status_uri = {.uri = "/api/ota/status",
                                       .method = HTTP_GET,
                                       .handler = ota_status_handler,
                                       .user_ctx = NULL};
-        httpd_register_uri_handler(server, &ota_status_uri);
+        register_uri_handler(&ota_status_uri);
 
         httpd_uri_t ota_check_uri = {.uri = "/api/ota/check",
                                      .method = HTTP_POST,
                                      .handler = ota_check_handler,
                                      .user_ctx = NULL};
-        httpd_register_uri_handler(server, &ota_check_uri);
+        register_uri_handler(&ota_check_uri);
 
         httpd_uri_t ota_update_uri = {.uri = "/api/ota/update",
                                       .method = HTTP_POST,
                                       .handler = ota_update_handler,
                                       .user_ctx = NULL};
-        httpd_register_uri_handler(server, &ota_update_uri);
+        register_uri_handler(&ota_update_uri);
 
         httpd_uri_t keep_alive_uri = {.uri = "/api/keep_alive",
                                       .method = HTTP_POST,
                                       .handler = keep_alive_handler,
                                       .user_ctx = NULL};
-        httpd_register_uri_handler(server, &keep_alive_uri);
+        register_uri_handler(&keep_alive_uri);
 
         httpd_uri_t format_storage_uri = {.uri = "/api/format-storage",
                                           .method = HTTP_POST,
                                           .handler = format_storage_handler,
                                           .user_ctx = NULL};
-        httpd_register_uri_handler(server, &format_storage_uri);
+        register_uri_handler(&format_storage_uri);
 
         httpd_uri_t display_image_direct_uri = {.uri = "/api/display-image",
                                                 .method = HTTP_POST,
                                                 .handler = display_image_direct_handler,
                                                 .user_ctx = NULL};
-        httpd_register_uri_handler(server, &display_image_direct_uri);
+        register_uri_handler(&display_image_direct_uri);
+
+        httpd_uri_t display_raw_uri = {.uri = "/api/display-raw",
+                                       .method = HTTP_POST,
+                                       .handler = display_raw_handler,
+                                       .user_ctx = NULL};
+        register_uri_handler(&display_raw_uri);
 
         httpd_uri_t albums_get_uri = {
             .uri = "/api/albums", .method = HTTP_GET, .handler = albums_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &albums_get_uri);
+        register_uri_handler(&albums_get_uri);
 
         httpd_uri_t albums_post_uri = {
             .uri = "/api/albums", .method = HTTP_POST, .handler = albums_handler, .user_ctx = NULL};
-        httpd_register_uri_handler(server, &albums_post_uri);
+        register_uri_handler(&albums_post_uri);
 
         httpd_uri_t album_delete_uri = {.uri = "/api/albums",
                                         .method = HTTP_DELETE,
                                         .handler = album_delete_handler,
                                         .user_ctx = NULL};
-        httpd_register_uri_handler(server, &album_delete_uri);
+        register_uri_handler(&album_delete_uri);
 
         httpd_uri_t album_enabled_uri = {.uri = "/api/albums/enabled",
                                          .method = HTTP_PUT,
                                          .handler = album_enabled_handler,
                                          .user_ctx = NULL};
-        httpd_register_uri_handler(server, &album_enabled_uri);
+        register_uri_handler(&album_enabled_uri);
 
         httpd_uri_t images_uri = {.uri = "/api/images",
                                   .method = HTTP_GET,
                                   .handler = album_images_handler,
                                   .user_ctx = NULL};
-        httpd_register_uri_handler(server, &images_uri);
+        register_uri_handler(&images_uri);
 
         httpd_uri_t upload_uri = {.uri = "/api/upload",
                                   .method = HTTP_POST,
                                   .handler = upload_image_handler,
                                   .user_ctx = NULL};
-        httpd_register_uri_handler(server, &upload_uri);
+        register_uri_handler(&upload_uri);
 
         httpd_uri_t display_uri = {.uri = "/api/display",
                                    .method = HTTP_POST,
                                    .handler = display_image_handler,
                                    .user_ctx = NULL};
-        httpd_register_uri_handler(server, &display_uri);
+        register_uri_handler(&display_uri);
+
+        httpd_uri_t display_status_uri = {.uri = "/api/display/status",
+                                          .method = HTTP_GET,
+                                          .handler = display_status_handler,
+                                          .user_ctx = NULL};
+        register_uri_handler(&display_status_uri);
 
         httpd_uri_t delete_uri = {.uri = "/api/delete",
                                   .method = HTTP_POST,
                                   .handler = delete_image_handler,
                                   .user_ctx = NULL};
-        httpd_register_uri_handler(server, &delete_uri);
+        register_uri_handler(&delete_uri);
 
         httpd_uri_t serve_image_uri = {.uri = "/api/image",
                                        .method = HTTP_GET,
                                        .handler = serve_image_handler,
                                        .user_ctx = NULL};
-        httpd_register_uri_handler(server, &serve_image_uri);
+        register_uri_handler(&serve_image_uri);
 
         httpd_uri_t processing_settings_get_uri = {.uri = "/api/settings/processing",
                                                    .method = HTTP_GET,
                                                    .handler = processing_settings_handler,
                                                    .user_ctx = NULL};
-        httpd_register_uri_handler(server, &processing_settings_get_uri);
+        register_uri_handler(&processing_settings_get_uri);
 
         httpd_uri_t processing_settings_post_uri = {.uri = "/api/settings/processing",
                                                     .method = HTTP_POST,
                                                     .handler = processing_settings_handler,
                                                     .user_ctx = NULL};
-        httpd_register_uri_handler(server, &processing_settings_post_uri);
+        register_uri_handler(&processing_settings_post_uri);
 
         httpd_uri_t processing_settings_delete_uri = {.uri = "/api/settings/processing",
                                                       .method = HTTP_DELETE,
                                                       .handler = processing_settings_handler,
                                                       .user_ctx = NULL};
-        httpd_register_uri_handler(server, &processing_settings_delete_uri);
+        register_uri_handler(&processing_settings_delete_uri);
 
         httpd_uri_t color_palette_get_uri = {.uri = "/api/settings/palette",
                                              .method = HTTP_GET,
                                              .handler = color_palette_handler,
                                              .user_ctx = NULL};
-        httpd_register_uri_handler(server, &color_palette_get_uri);
+        register_uri_handler(&color_palette_get_uri);
 
         httpd_uri_t color_palette_post_uri = {.uri = "/api/settings/palette",
                                               .method = HTTP_POST,
                                               .handler = color_palette_handler,
                                               .user_ctx = NULL};
-        httpd_register_uri_handler(server, &color_palette_post_uri);
+        register_uri_handler(&color_palette_post_uri);
 
         httpd_uri_t color_palette_delete_uri = {.uri = "/api/settings/palette",
                                                 .method = HTTP_DELETE,
                                                 .handler = color_palette_handler,
                                                 .user_ctx = NULL};
-        httpd_register_uri_handler(server, &color_palette_delete_uri);
+        register_uri_handler(&color_palette_delete_uri);
 
         httpd_uri_t factory_reset_uri = {.uri = "/api/factory-reset",
                                          .method = HTTP_POST,
                                          .handler = factory_reset_handler,
                                          .user_ctx = NULL};
-        httpd_register_uri_handler(server, &factory_reset_uri);
+        register_uri_handler(&factory_reset_uri);
 
         httpd_uri_t display_calibration_uri = {.uri = "/api/calibration/display",
                                                .method = HTTP_POST,
                                                .handler = display_calibration_handler,
                                                .user_ctx = NULL};
-        httpd_register_uri_handler(server, &display_calibration_uri);
+        register_uri_handler(&display_calibration_uri);
 
         ESP_LOGI(TAG, "HTTP server started");
         return ESP_OK;
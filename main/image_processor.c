@@ -9,16 +9,28 @@
 #include <string.h>
 
 #include "board_hal.h"
+#include "cJSON.h"
 #include "color_palette.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_task_wdt.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
 #include "freertos/task.h"
 #include "jpeg_decoder.h"
+#include "memfs.h"
+#include "metrics.h"
+#include "pipeline_arena.h"
+#include "timeline.h"
 
 static const char *TAG = "image_processor";
 
+#define STREAM_DECODER_TASK_STACK 12288
+#define STREAM_DECODER_BUFFER_SIZE 16384
+#define STREAM_DECODER_POLL_MS 50
+
 typedef struct {
     uint8_t r;
     uint8_t g;
@@ -112,7 +124,7 @@ static inline uint8_t linear_to_srgb(float lin)
 }
 
 static void fast_compress_dynamic_range(uint8_t *image, int width, int height,
-                                        const rgb_t *measured_palette)
+                                        const rgb_t *measured_palette, image_profile_t *profile)
 {
     init_gamma_luts();
 
@@ -168,6 +180,9 @@ static void fast_compress_dynamic_range(uint8_t *image, int width, int height,
         // Delay every 2000 pixels to allow IDLE task to feed watchdog
         if ((i % 2000) == 0) {
             vTaskDelay(1);
+            if (profile) {
+                profile->yields++;
+            }
         }
     }
 }
@@ -200,21 +215,16 @@ static void apply_error_diffusion_dither(uint8_t *image, int width, int height,
 {
     // Use three scanlines for error diffusion (current, next, and next+1 row)
     // This supports algorithms like Stucki and Sierra that diffuse to dy=2
-    // Memory usage: ~15KB for 800x480 (3 rows * 800 pixels * 3 channels * 4 bytes)
-    int *curr_errors = (int *) heap_caps_calloc(width * 3, sizeof(int), MALLOC_CAP_SPIRAM);
-    int *next_errors = (int *) heap_caps_calloc(width * 3, sizeof(int), MALLOC_CAP_SPIRAM);
-    int *next2_errors = (int *) heap_caps_calloc(width * 3, sizeof(int), MALLOC_CAP_SPIRAM);
-
-    if (!curr_errors || !next_errors || !next2_errors) {
+    // Memory usage: ~28KB for 800x480 (3 rows * 800 pixels * 3 channels * 4 bytes), which fits
+    // in the arena next to the frames
+    int *error_rows = (int *) pipeline_arena_calloc(3 * width * 3, sizeof(int));
+    if (!error_rows) {
         ESP_LOGE(TAG, "Failed to allocate error buffers");
-        if (curr_errors)
-            free(curr_errors);
-        if (next_errors)
-            free(next_errors);
-        if (next2_errors)
-            free(next2_errors);
         return;
     }
+    int *curr_errors = error_rows;
+    int *next_errors = error_rows + width * 3;
+    int *next2_errors = error_rows + 2 * width * 3;
 
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
@@ -316,14 +326,14 @@ static void apply_error_diffusion_dither(uint8_t *image, int width, int height,
         memset(next2_errors, 0, width * 3 * sizeof(int));
     }
 
-    free(curr_errors);
-    free(next_errors);
-    free(next2_errors);
+    pipeline_arena_free(error_rows);
 }
 
 esp_err_t image_processor_init(void)
 {
     load_calibrated_palette();
+    // Without the arena every buffer comes from the heap, which still works
+    pipeline_arena_init();
     ESP_LOGI(TAG, "Image processor initialized");
     return ESP_OK;
 }
@@ -339,9 +349,205 @@ esp_err_t image_processor_reload_palette(void)
     return ESP_OK;
 }
 
+const char *image_processor_stage_name(image_stage_t stage)
+{
+    static const char *names[IMAGE_STAGE_COUNT] = {
+        [IMAGE_STAGE_DECODE] = "decode", [IMAGE_STAGE_RESIZE] = "resize",
+        [IMAGE_STAGE_ROTATE] = "rotate", [IMAGE_STAGE_CDR] = "cdr",
+        [IMAGE_STAGE_DITHER] = "dither", [IMAGE_STAGE_ENCODE] = "encode",
+        [IMAGE_STAGE_PAINT] = "paint",
+    };
+    return stage < IMAGE_STAGE_COUNT ? names[stage] : "unknown";
+}
+
+typedef struct {
+    image_stage_t stage;
+    int64_t start_us;
+    size_t start_fallback_bytes;
+} stage_timer_t;
+
+// Memory is accounted per task, since runs on other tasks may be processing at the same time
+static void stage_begin(stage_timer_t *timer, image_stage_t stage, const image_profile_t *profile)
+{
+    timer->stage = stage;
+    timer->start_fallback_bytes = pipeline_arena_task_fallback_bytes();
+    timer->start_us = esp_timer_get_time();
+}
+
+static void stage_end(stage_timer_t *timer, image_profile_t *profile)
+{
+    int64_t elapsed_us = esp_timer_get_time() - timer->start_us;
+    metrics_image_stage(timer->stage, elapsed_us);
+
+    if (profile) {
+        profile->stages_run |= 1u << timer->stage;
+        profile->stage_us[timer->stage] += (uint32_t) elapsed_us;
+        profile->heap_fallback_bytes +=
+            pipeline_arena_task_fallback_bytes() - timer->start_fallback_bytes;
+        size_t arena_peak = pipeline_arena_run_peak();
+        if (arena_peak > profile->arena_peak_bytes) {
+            profile->arena_peak_bytes = arena_peak;
+        }
+    }
+}
+
+static void profile_decoded(image_profile_t *profile, image_format_t format, int width, int height)
+{
+    if (!profile) {
+        return;
+    }
+    profile->format = format;
+    profile->decoded_width = width;
+    profile->decoded_height = height;
+    // decode_jpg_buffer() has already filled these in for JPEG
+    if (profile->source_width == 0) {
+        profile->source_width = width;
+        profile->source_height = height;
+    }
+    if (profile->decode_scale == 0) {
+        profile->decode_scale = 1;
+    }
+}
+
+// Adds the stages recorded in src, for runs split across tasks
+static void profile_merge(image_profile_t *dst, const image_profile_t *src)
+{
+    if (dst->source_width == 0) {
+        dst->format = src->format;
+        dst->source_width = src->source_width;
+        dst->source_height = src->source_height;
+        dst->decode_scale = src->decode_scale;
+        dst->decoded_width = src->decoded_width;
+        dst->decoded_height = src->decoded_height;
+    }
+    dst->yields += src->yields;
+    dst->stages_run |= src->stages_run;
+    for (int i = 0; i < IMAGE_STAGE_COUNT; i++) {
+        dst->stage_us[i] += src->stage_us[i];
+    }
+    if (src->arena_peak_bytes > dst->arena_peak_bytes) {
+        dst->arena_peak_bytes = src->arena_peak_bytes;
+    }
+    dst->heap_fallback_bytes += src->heap_fallback_bytes;
+}
+
+static image_profile_t profile_history[IMAGE_PROFILE_HISTORY];
+static int profile_next;
+static int profile_count;
+static portMUX_TYPE profile_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void image_processor_profile_add_stage(image_profile_t *profile, image_stage_t stage,
+                                       int64_t duration_us)
+{
+    if (!profile || stage >= IMAGE_STAGE_COUNT || duration_us <= 0) {
+        return;
+    }
+    profile->stages_run |= 1u << stage;
+    profile->stage_us[stage] += (uint32_t) duration_us;
+}
+
+void image_processor_profile_save(const image_profile_t *profile)
+{
+    if (!profile || profile->stages_run == 0) {
+        return;
+    }
+    taskENTER_CRITICAL(&profile_lock);
+    profile_history[profile_next] = *profile;
+    profile_next = (profile_next + 1) % IMAGE_PROFILE_HISTORY;
+    if (profile_count < IMAGE_PROFILE_HISTORY) {
+        profile_count++;
+    }
+    taskEXIT_CRITICAL(&profile_lock);
+}
+
+bool image_processor_profile_find_job(uint32_t job_id, image_profile_t *profile)
+{
+    bool found = false;
+    taskENTER_CRITICAL(&profile_lock);
+    for (int i = 1; i <= profile_count && !found && job_id != 0; i++) {
+        const image_profile_t *entry =
+            &profile_history[(profile_next + IMAGE_PROFILE_HISTORY - i) % IMAGE_PROFILE_HISTORY];
+        if (entry->job_id == job_id) {
+            *profile = *entry;
+            found = true;
+        }
+    }
+    taskEXIT_CRITICAL(&profile_lock);
+    return found;
+}
+
+cJSON *image_processor_profile_to_json(const image_profile_t *profile)
+{
+    static const char *format_names[] = {
+        [IMAGE_FORMAT_UNKNOWN] = "unknown", [IMAGE_FORMAT_PNG] = "png",
+        [IMAGE_FORMAT_BMP] = "bmp",         [IMAGE_FORMAT_JPG] = "jpg",
+    };
+
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return NULL;
+    }
+    if (profile->job_id != 0) {
+        cJSON_AddNumberToObject(json, "job_id", profile->job_id);
+    }
+    cJSON_AddStringToObject(json, "format", format_names[profile->format]);
+    cJSON_AddNumberToObject(json, "source_width", profile->source_width);
+    cJSON_AddNumberToObject(json, "source_height", profile->source_height);
+    cJSON_AddNumberToObject(json, "decode_scale", profile->decode_scale);
+    cJSON_AddNumberToObject(json, "decoded_width", profile->decoded_width);
+    cJSON_AddNumberToObject(json, "decoded_height", profile->decoded_height);
+    cJSON_AddNumberToObject(json, "yields", profile->yields);
+    cJSON_AddNumberToObject(json, "arena_peak_bytes", profile->arena_peak_bytes);
+    cJSON_AddNumberToObject(json, "heap_fallback_bytes", profile->heap_fallback_bytes);
+
+    uint32_t total_us = 0;
+    cJSON *stages = cJSON_AddArrayToObject(json, "stages");
+    for (int i = 0; i < IMAGE_STAGE_COUNT; i++) {
+        if (!(profile->stages_run & (1u << i))) {
+            continue;
+        }
+        total_us += profile->stage_us[i];
+        cJSON *stage = cJSON_CreateObject();
+        if (!stages || !stage) {
+            cJSON_Delete(stage);
+            continue;
+        }
+        cJSON_AddStringToObject(stage, "name", image_processor_stage_name(i));
+        cJSON_AddNumberToObject(stage, "ms", profile->stage_us[i] / 1000.0);
+        cJSON_AddItemToArray(stages, stage);
+    }
+    cJSON_AddNumberToObject(json, "total_ms", total_us / 1000.0);
+    return json;
+}
+
+cJSON *image_processor_profile_history_to_json(void)
+{
+    image_profile_t *copy = malloc(sizeof(profile_history));
+    if (!copy) {
+        return NULL;
+    }
+    taskENTER_CRITICAL(&profile_lock);
+    int count = profile_count;
+    for (int i = 0; i < count; i++) {
+        copy[i] = profile_history[(profile_next + IMAGE_PROFILE_HISTORY - 1 - i) %
+                                  IMAGE_PROFILE_HISTORY];
+    }
+    taskEXIT_CRITICAL(&profile_lock);
+
+    cJSON *json = cJSON_CreateArray();
+    for (int i = 0; json && i < count; i++) {
+        cJSON *entry = image_processor_profile_to_json(&copy[i]);
+        if (entry) {
+            cJSON_AddItemToArray(json, entry);
+        }
+    }
+    free(copy);
+    return json;
+}
+
 static uint8_t *resize_image(uint8_t *src, int src_w, int src_h, int dst_w, int dst_h)
 {
-    uint8_t *dst = (uint8_t *) heap_caps_malloc(dst_w * dst_h * 3, MALLOC_CAP_SPIRAM);
+    uint8_t *dst = (uint8_t *) pipeline_arena_alloc(dst_w * dst_h * 3);
     if (!dst) {
         ESP_LOGE(TAG, "Failed to allocate resize buffer");
         return NULL;
@@ -442,7 +648,11 @@ static esp_err_t write_png_file(const char *filename, uint8_t *rgb_data, int wid
 
     png_write_end(png_ptr, NULL);
     png_destroy_write_struct(&png_ptr, &info_ptr);
+    long written = ftell(fp);
     fclose(fp);
+    if (written > 0) {
+        metrics_add(METRICS_STORAGE_BYTES_WRITTEN, written);
+    }
 
     return ESP_OK;
 }
@@ -451,8 +661,9 @@ static esp_err_t write_png_file(const char *filename, uint8_t *rgb_data, int wid
 // Returns processed RGB buffer (caller must free) and dimensions
 static esp_err_t process_rgb_buffer_core(uint8_t *rgb_buffer, int width, int height,
                                          dither_algorithm_t dither_algorithm, uint8_t **out_buffer,
-                                         int *out_width, int *out_height)
+                                         int *out_width, int *out_height, image_profile_t *profile)
 {
+    stage_timer_t timer;
     ESP_LOGI(TAG, "Processing RGB buffer: %dx%d", width, height);
 
     uint8_t *resized = NULL;
@@ -477,13 +688,15 @@ static esp_err_t process_rgb_buffer_core(uint8_t *rgb_buffer, int width, int hei
 
     if (final_width != target_width || final_height != target_height) {
         ESP_LOGI(TAG, "Resizing image to %dx%d", target_width, target_height);
+        stage_begin(&timer, IMAGE_STAGE_RESIZE, profile);
         resized = resize_image(final_image, final_width, final_height, target_width, target_height);
+        stage_end(&timer, profile);
         if (!resized) {
             ESP_LOGE(TAG, "Failed to resize image to %dx%d", target_width, target_height);
             return ESP_FAIL;
         }
         if (final_image != rgb_buffer)
-            heap_caps_free(final_image);
+            pipeline_arena_free(final_image);
         final_image = resized;
         final_width = target_width;
         final_height = target_height;
@@ -492,12 +705,14 @@ static esp_err_t process_rgb_buffer_core(uint8_t *rgb_buffer, int width, int hei
     // STEP 2: Rotate
     if (needs_rotation) {
         ESP_LOGI(TAG, "Rotating image by 90 degrees");
+        stage_begin(&timer, IMAGE_STAGE_ROTATE, profile);
         size_t rotated_size = final_width * final_height * 3;
-        rotated = (uint8_t *) heap_caps_malloc(rotated_size, MALLOC_CAP_SPIRAM);
+        rotated = (uint8_t *) pipeline_arena_alloc(rotated_size);
         if (!rotated) {
             ESP_LOGE(TAG, "Failed to allocate rotation buffer of %zu bytes", rotated_size);
+            stage_end(&timer, profile);
             if (final_image != rgb_buffer)
-                heap_caps_free(final_image);
+                pipeline_arena_free(final_image);
             return ESP_FAIL;
         }
 
@@ -513,8 +728,9 @@ static esp_err_t process_rgb_buffer_core(uint8_t *rgb_buffer, int width, int hei
             }
         }
         if (final_image != rgb_buffer)
-            heap_caps_free(final_image);
+            pipeline_arena_free(final_image);
         final_image = rotated;
+        stage_end(&timer, profile);
         int temp = final_width;
         final_width = final_height;
         final_height = temp;
@@ -522,17 +738,19 @@ static esp_err_t process_rgb_buffer_core(uint8_t *rgb_buffer, int width, int hei
 
     // STEP 3: Final fit check
     if (final_width != BOARD_HAL_DISPLAY_WIDTH || final_height != BOARD_HAL_DISPLAY_HEIGHT) {
+        stage_begin(&timer, IMAGE_STAGE_RESIZE, profile);
         uint8_t *final_resized = resize_image(final_image, final_width, final_height,
                                               BOARD_HAL_DISPLAY_WIDTH, BOARD_HAL_DISPLAY_HEIGHT);
+        stage_end(&timer, profile);
         if (!final_resized) {
             ESP_LOGE(TAG, "Failed to final resize image to %dx%d", BOARD_HAL_DISPLAY_WIDTH,
                      BOARD_HAL_DISPLAY_HEIGHT);
             if (final_image != rgb_buffer)
-                heap_caps_free(final_image);
+                pipeline_arena_free(final_image);
             return ESP_FAIL;
         }
         if (final_image != rgb_buffer)
-            heap_caps_free(final_image);
+            pipeline_arena_free(final_image);
         final_image = final_resized;
         final_width = BOARD_HAL_DISPLAY_WIDTH;
         final_height = BOARD_HAL_DISPLAY_HEIGHT;
@@ -540,11 +758,16 @@ static esp_err_t process_rgb_buffer_core(uint8_t *rgb_buffer, int width, int hei
 
     // Apply fast Compress Dynamic Range (fast CDR)
     ESP_LOGI(TAG, "Applying fast Compress Dynamic Range (fast CDR)");
-    fast_compress_dynamic_range(final_image, final_width, final_height, palette_measured);
+    stage_begin(&timer, IMAGE_STAGE_CDR, profile);
+    fast_compress_dynamic_range(final_image, final_width, final_height, palette_measured, profile);
+    stage_end(&timer, profile);
 
     // Apply Dithering (always use measured palette)
+    stage_begin(&timer, IMAGE_STAGE_DITHER, profile);
     apply_error_diffusion_dither(final_image, final_width, final_height, palette_measured,
                                  dither_algorithm);
+    stage_end(&timer, profile);
+    metrics_sample_heap();
 
     *out_buffer = final_image;
     *out_width = final_width;
@@ -552,9 +775,19 @@ static esp_err_t process_rgb_buffer_core(uint8_t *rgb_buffer, int width, int hei
     return ESP_OK;
 }
 
+// Decoded images take the arena only when no bigger than a frame. Larger ones are the size of
+// the source, and would leave no room for the frame-sized buffers of the rest of the run.
+static uint8_t *alloc_decoded(size_t size)
+{
+    if (size <= pipeline_arena_frame_size()) {
+        return pipeline_arena_alloc(size);
+    }
+    return heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+}
+
 // Decode JPG from buffer to RGB
 static esp_err_t decode_jpg_buffer(const uint8_t *jpg_data, size_t jpg_size, uint8_t **rgb_buffer,
-                                   int *width, int *height)
+                                   int *width, int *height, image_profile_t *profile)
 {
     esp_jpeg_image_cfg_t jpeg_cfg = {.indata = (uint8_t *) jpg_data,
                                      .indata_size = jpg_size,
@@ -572,6 +805,12 @@ static esp_err_t decode_jpg_buffer(const uint8_t *jpg_data, size_t jpg_size, uin
              outimg.height > BOARD_HAL_DISPLAY_HEIGHT * 2)
         jpeg_cfg.out_scale = JPEG_IMAGE_SCALE_1_2;
 
+    if (profile) {
+        profile->source_width = original_width;
+        profile->source_height = original_height;
+        profile->decode_scale = 1 << jpeg_cfg.out_scale;
+    }
+
     if (jpeg_cfg.out_scale != JPEG_IMAGE_SCALE_0) {
         esp_jpeg_get_image_info(&jpeg_cfg, &outimg);
         ESP_LOGI(TAG, "JPG scaled from %dx%d to %dx%d (scale: 1/%d)", original_width,
@@ -580,7 +819,7 @@ static esp_err_t decode_jpg_buffer(const uint8_t *jpg_data, size_t jpg_size, uin
         ESP_LOGI(TAG, "JPG size: %dx%d (no scaling needed)", outimg.width, outimg.height);
     }
 
-    *rgb_buffer = (uint8_t *) heap_caps_malloc(outimg.output_len, MALLOC_CAP_SPIRAM);
+    *rgb_buffer = alloc_decoded(outimg.output_len);
     if (!*rgb_buffer) {
         ESP_LOGE(TAG, "Failed to allocate JPG RGB buffer of %u bytes", outimg.output_len);
         return ESP_ERR_NO_MEM;
@@ -591,7 +830,7 @@ static esp_err_t decode_jpg_buffer(const uint8_t *jpg_data, size_t jpg_size, uin
     esp_err_t decode_err = esp_jpeg_decode(&jpeg_cfg, &outimg);
     if (decode_err != ESP_OK) {
         ESP_LOGE(TAG, "JPG decoding failed: %s", esp_err_to_name(decode_err));
-        heap_caps_free(*rgb_buffer);
+        pipeline_arena_free(*rgb_buffer);
         *rgb_buffer = NULL;
         return ESP_FAIL;
     }
@@ -619,11 +858,16 @@ static void png_mem_read_callback(png_structp png_ptr, png_bytep data, png_size_
     mem->offset += length;
 }
 
-// Decode PNG from buffer to RGB
-static esp_err_t decode_png_buffer(const uint8_t *png_data, size_t png_size, uint8_t **rgb_buffer,
-                                   int *width, int *height)
+// Largest decoded PNG accepted, checked against the header before anything is allocated
+#define PNG_MAX_DECODED_SIZE (6 * 1024 * 1024)
+
+// Decode PNG to RGB, pulling the encoded bytes through read_fn. Rows are inflated straight into
+// the output buffer one at a time, so libpng never holds a second copy of the image.
+static esp_err_t decode_png(png_rw_ptr read_fn, void *io, uint8_t **rgb_buffer, int *width,
+                            int *height)
 {
-    png_mem_read_t mem = {.data = png_data, .size = png_size, .offset = 0};
+    // Freed by the error handler below, so it must survive the longjmp
+    uint8_t *volatile output = NULL;
 
     png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!png_ptr) {
@@ -640,52 +884,92 @@ static esp_err_t decode_png_buffer(const uint8_t *png_data, size_t png_size, uin
 
     if (setjmp(png_jmpbuf(png_ptr))) {
         ESP_LOGE(TAG, "PNG decoding error");
+        pipeline_arena_free(output);
         png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
         return ESP_FAIL;
     }
 
-    png_set_read_fn(png_ptr, &mem, png_mem_read_callback);
-    png_read_png(png_ptr, info_ptr,
-                 PNG_TRANSFORM_STRIP_16 | PNG_TRANSFORM_PACKING | PNG_TRANSFORM_EXPAND |
-                     PNG_TRANSFORM_STRIP_ALPHA,
-                 NULL);
+    png_set_read_fn(png_ptr, io, read_fn);
+    png_read_info(png_ptr, info_ptr);
 
-    *width = png_get_image_width(png_ptr, info_ptr);
-    *height = png_get_image_height(png_ptr, info_ptr);
-    ESP_LOGI(TAG, "PNG Image info: %dx%d", *width, *height);
+    png_uint_32 png_width = png_get_image_width(png_ptr, info_ptr);
+    png_uint_32 png_height = png_get_image_height(png_ptr, info_ptr);
+    ESP_LOGI(TAG, "PNG Image info: %lux%lu", (unsigned long) png_width,
+             (unsigned long) png_height);
 
-    size_t rgb_size = (*width) * (*height) * 3;
-    if (rgb_size > 6 * 1024 * 1024) {
-        ESP_LOGE(TAG, "PNG image too large for memory: %zu bytes (limit 6MB)", rgb_size);
+    uint64_t rgb_size = (uint64_t) png_width * png_height * 3;
+    if (rgb_size > PNG_MAX_DECODED_SIZE) {
+        ESP_LOGE(TAG, "PNG image too large for memory: %llu bytes (limit 6MB)", rgb_size);
         png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
         return ESP_ERR_NO_MEM;
     }
 
-    *rgb_buffer = (uint8_t *) heap_caps_malloc(rgb_size, MALLOC_CAP_SPIRAM);
-    if (!*rgb_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate PNG RGB buffer of %zu bytes", rgb_size);
-        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-        return ESP_ERR_NO_MEM;
-    }
+    // Same output as PNG_TRANSFORM_STRIP_16 | PACKING | EXPAND | STRIP_ALPHA, plus grey to RGB
+    png_set_strip_16(png_ptr);
+    png_set_packing(png_ptr);
+    png_set_expand(png_ptr);
+    png_set_strip_alpha(png_ptr);
+    png_set_gray_to_rgb(png_ptr);
+    int passes = png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, info_ptr);
 
-    png_bytep *row_pointers = png_get_rows(png_ptr, info_ptr);
     int channels = png_get_channels(png_ptr, info_ptr);
-    if (channels != 3) {
+    if (channels != 3 || png_get_rowbytes(png_ptr, info_ptr) != (size_t) png_width * 3) {
         ESP_LOGE(TAG, "Unsupported channel count: %d", channels);
-        heap_caps_free(*rgb_buffer);
-        *rgb_buffer = NULL;
         png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
         return ESP_FAIL;
     }
 
-    for (int y = 0; y < *height; y++) {
-        memcpy(*rgb_buffer + y * (*width) * 3, row_pointers[y], (*width) * 3);
+    output = alloc_decoded(rgb_size);
+    if (!output) {
+        ESP_LOGE(TAG, "Failed to allocate PNG RGB buffer of %llu bytes", rgb_size);
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return ESP_ERR_NO_MEM;
     }
 
+    // Interlaced images are read once per pass, each pass filling in more of every row
+    size_t stride = (size_t) png_width * 3;
+    for (int pass = 0; pass < passes; pass++) {
+        for (png_uint_32 y = 0; y < png_height; y++) {
+            png_read_row(png_ptr, output + y * stride, NULL);
+        }
+    }
+    png_read_end(png_ptr, NULL);
     png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+
+    *rgb_buffer = output;
+    *width = png_width;
+    *height = png_height;
     return ESP_OK;
 }
 
+// Decode PNG from buffer to RGB
+static esp_err_t decode_png_buffer(const uint8_t *png_data, size_t png_size, uint8_t **rgb_buffer,
+                                   int *width, int *height)
+{
+    png_mem_read_t mem = {.data = png_data, .size = png_size, .offset = 0};
+    return decode_png(png_mem_read_callback, &mem, rgb_buffer, width, height);
+}
+
+typedef struct {
+    image_stream_read_fn read;
+    void *ctx;
+} png_stream_read_t;
+
+static void png_stream_read_callback(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+    png_stream_read_t *stream = (png_stream_read_t *) png_get_io_ptr(png_ptr);
+    while (length > 0) {
+        int got = stream->read(stream->ctx, data, length);
+        if (got <= 0) {
+            png_error(png_ptr, got < 0 ? "Stream read failed" : "Unexpected end of stream");
+            return;
+        }
+        data += got;
+        length -= got;
+    }
+}
+
 image_format_t image_processor_detect_format_buffer(const uint8_t *data, size_t size)
 {
     if (size < 8) {
@@ -704,9 +988,304 @@ image_format_t image_processor_detect_format_buffer(const uint8_t *data, size_t
     return IMAGE_FORMAT_UNKNOWN;
 }
 
+// Borrow the file contents straight from the RAM filesystem when the file lives there, and
+// read them into a PSRAM buffer otherwise. Pair with release_input_file().
+static esp_err_t load_input_file(const char *path, const uint8_t **data, size_t *size,
+                                 bool *mapped)
+{
+    if (memfs_map(path, data, size) == ESP_OK) {
+        *mapped = true;
+        return ESP_OK;
+    }
+    *mapped = false;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        ESP_LOGE(TAG, "Failed to open input file: %s", path);
+        return ESP_FAIL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (file_size <= 0) {
+        ESP_LOGE(TAG, "Input file is empty: %s", path);
+        fclose(fp);
+        return ESP_FAIL;
+    }
+
+    uint8_t *buffer = heap_caps_malloc(file_size, MALLOC_CAP_SPIRAM);
+    if (!buffer) {
+        ESP_LOGE(TAG, "Failed to allocate file buffer of %ld bytes", file_size);
+        fclose(fp);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t read_bytes = fread(buffer, 1, file_size, fp);
+    fclose(fp);
+    metrics_add(METRICS_STORAGE_BYTES_READ, read_bytes);
+
+    if (read_bytes != (size_t) file_size) {
+        ESP_LOGE(TAG, "Incomplete file read: %zu of %ld bytes", read_bytes, file_size);
+        heap_caps_free(buffer);
+        return ESP_FAIL;
+    }
+
+    *data = buffer;
+    *size = file_size;
+    return ESP_OK;
+}
+
+static void release_input_file(const uint8_t *data, bool mapped)
+{
+    if (mapped) {
+        memfs_unmap(data);
+    } else {
+        heap_caps_free((void *) data);
+    }
+}
+
+esp_err_t image_processor_process_rgb(uint8_t *rgb_data, int width, int height,
+                                      dither_algorithm_t dither_algorithm,
+                                      image_process_rgb_result_t *result, image_profile_t *profile)
+{
+    memset(result, 0, sizeof(*result));
+
+    uint8_t *processed_buffer = NULL;
+    int processed_width = 0, processed_height = 0;
+    timeline_begin(TIMELINE_PROCESSING);
+    esp_err_t err =
+        process_rgb_buffer_core(rgb_data, width, height, dither_algorithm, &processed_buffer,
+                                &processed_width, &processed_height, profile);
+    timeline_end(TIMELINE_PROCESSING);
+
+    // Free original RGB buffer if it wasn't reused
+    if (rgb_data != processed_buffer) {
+        pipeline_arena_free(rgb_data);
+    }
+
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    result->rgb_data = processed_buffer;
+    result->rgb_size = processed_width * processed_height * 3;
+    result->width = processed_width;
+    result->height = processed_height;
+    return ESP_OK;
+}
+
+esp_err_t image_processor_decode_stream(image_format_t format, size_t size_hint,
+                                        image_stream_read_fn read, void *ctx,
+                                        image_process_rgb_result_t *decoded,
+                                        image_profile_t *profile)
+{
+    stage_timer_t timer;
+    if (!read || !decoded) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(decoded, 0, sizeof(*decoded));
+
+    uint8_t *rgb_buffer = NULL;
+    int width = 0, height = 0;
+    esp_err_t err;
+
+    if (format == IMAGE_FORMAT_PNG) {
+        // libpng inflates and unfilters rows as the bytes arrive
+        png_stream_read_t stream = {.read = read, .ctx = ctx};
+        timeline_begin(TIMELINE_PROCESSING);
+        stage_begin(&timer, IMAGE_STAGE_DECODE, profile);
+        err = decode_png(png_stream_read_callback, &stream, &rgb_buffer, &width, &height);
+        stage_end(&timer, profile);
+        timeline_end(TIMELINE_PROCESSING);
+    } else if (format == IMAGE_FORMAT_JPG) {
+        // The JPEG decoder needs the whole input, so collect it in RAM rather than a file
+        if (size_hint == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        uint8_t *jpg_data = heap_caps_malloc(size_hint, MALLOC_CAP_SPIRAM);
+        if (!jpg_data) {
+            ESP_LOGE(TAG, "Failed to allocate JPG input buffer of %zu bytes", size_hint);
+            return ESP_ERR_NO_MEM;
+        }
+
+        size_t jpg_size = 0;
+        while (jpg_size < size_hint) {
+            int got = read(ctx, jpg_data + jpg_size, size_hint - jpg_size);
+            if (got < 0) {
+                heap_caps_free(jpg_data);
+                return ESP_FAIL;
+            }
+            if (got == 0) {
+                break;
+            }
+            jpg_size += got;
+        }
+
+        timeline_begin(TIMELINE_PROCESSING);
+        stage_begin(&timer, IMAGE_STAGE_DECODE, profile);
+        err = decode_jpg_buffer(jpg_data, jpg_size, &rgb_buffer, &width, &height, profile);
+        stage_end(&timer, profile);
+        timeline_end(TIMELINE_PROCESSING);
+        heap_caps_free(jpg_data);
+    } else {
+        ESP_LOGE(TAG, "Unsupported image format for stream decoding: %d", format);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Decoded stream: %dx%d", width, height);
+    profile_decoded(profile, format, width, height);
+    decoded->rgb_data = rgb_buffer;
+    decoded->rgb_size = (size_t) width * height * 3;
+    decoded->width = width;
+    decoded->height = height;
+    return ESP_OK;
+}
+
+struct image_stream_decoder {
+    image_format_t format;
+    size_t size_hint;
+    StreamBufferHandle_t buffer;
+    TaskHandle_t task;
+    SemaphoreHandle_t done;  // Given by the decode task when it stops
+    volatile bool closed;    // No more input will be fed
+    volatile bool complete;  // Input was closed at the end of the image, not cut short
+    volatile bool exited;    // The decode task has stopped reading
+    bool joined;             // The caller has waited for the decode task
+    esp_err_t result;
+    image_process_rgb_result_t decoded;
+    image_profile_t profile;
+};
+
+static int stream_decoder_read(void *ctx, uint8_t *buf, size_t len)
+{
+    image_stream_decoder_t *decoder = (image_stream_decoder_t *) ctx;
+    for (;;) {
+        // Sample closed first: once it is set, every byte fed is already in the buffer
+        bool closed = decoder->closed;
+        size_t got = xStreamBufferReceive(decoder->buffer, buf, len,
+                                          closed ? 0 : pdMS_TO_TICKS(STREAM_DECODER_POLL_MS));
+        if (got > 0) {
+            return (int) got;
+        }
+        if (closed) {
+            return decoder->complete ? 0 : -1;
+        }
+    }
+}
+
+static void stream_decoder_task(void *arg)
+{
+    image_stream_decoder_t *decoder = (image_stream_decoder_t *) arg;
+    decoder->result = image_processor_decode_stream(decoder->format, decoder->size_hint,
+                                                    stream_decoder_read, decoder,
+                                                    &decoder->decoded, &decoder->profile);
+    decoder->exited = true;
+    xSemaphoreGive(decoder->done);
+    vTaskDelete(NULL);
+}
+
+image_stream_decoder_t *image_processor_stream_decoder_start(image_format_t format,
+                                                             size_t size_hint)
+{
+    image_stream_decoder_t *decoder = calloc(1, sizeof(*decoder));
+    if (!decoder) {
+        return NULL;
+    }
+    decoder->format = format;
+    decoder->size_hint = size_hint;
+    decoder->buffer = xStreamBufferCreate(STREAM_DECODER_BUFFER_SIZE, 1);
+    decoder->done = xSemaphoreCreateBinary();
+
+    if (!decoder->buffer || !decoder->done ||
+        xTaskCreate(stream_decoder_task, "stream_decode", STREAM_DECODER_TASK_STACK, decoder, 5,
+                    &decoder->task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start stream decoder");
+        if (decoder->buffer) {
+            vStreamBufferDelete(decoder->buffer);
+        }
+        if (decoder->done) {
+            vSemaphoreDelete(decoder->done);
+        }
+        free(decoder);
+        return NULL;
+    }
+    return decoder;
+}
+
+esp_err_t image_processor_stream_decoder_feed(image_stream_decoder_t *decoder, const uint8_t *data,
+                                              size_t len)
+{
+    if (!decoder || decoder->closed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    while (len > 0) {
+        if (decoder->exited) {
+            return decoder->result;
+        }
+        size_t sent =
+            xStreamBufferSend(decoder->buffer, data, len, pdMS_TO_TICKS(STREAM_DECODER_POLL_MS));
+        data += sent;
+        len -= sent;
+    }
+    return ESP_OK;
+}
+
+static void stream_decoder_join(image_stream_decoder_t *decoder)
+{
+    if (!decoder->joined) {
+        decoder->closed = true;
+        xSemaphoreTake(decoder->done, portMAX_DELAY);
+        decoder->joined = true;
+    }
+}
+
+esp_err_t image_processor_stream_decoder_finish(image_stream_decoder_t *decoder,
+                                                image_process_rgb_result_t *decoded,
+                                                image_profile_t *profile)
+{
+    if (!decoder || !decoded) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!decoder->closed) {
+        decoder->complete = true;
+    }
+    stream_decoder_join(decoder);
+
+    if (decoder->result != ESP_OK) {
+        return decoder->result;
+    }
+    // The caller processes the decoded buffer: continue the decoder's arena run
+    pipeline_arena_adopt(decoder->task);
+    *decoded = decoder->decoded;
+    memset(&decoder->decoded, 0, sizeof(decoder->decoded));
+    if (profile) {
+        profile_merge(profile, &decoder->profile);
+    }
+    return ESP_OK;
+}
+
+void image_processor_stream_decoder_free(image_stream_decoder_t *decoder)
+{
+    if (!decoder) {
+        return;
+    }
+    stream_decoder_join(decoder);
+    pipeline_arena_free(decoder->decoded.rgb_data);
+    vStreamBufferDelete(decoder->buffer);
+    vSemaphoreDelete(decoder->done);
+    free(decoder);
+}
+
 esp_err_t image_processor_process_to_rgb(const uint8_t *input_data, size_t input_size,
                                          image_format_t format, dither_algorithm_t dither_algorithm,
-                                         image_process_rgb_result_t *result)
+                                         image_process_rgb_result_t *result,
+                                         image_profile_t *profile)
 {
     if (!input_data || input_size == 0 || !result) {
         return ESP_ERR_INVALID_ARG;
@@ -723,49 +1302,62 @@ esp_err_t image_processor_process_to_rgb(const uint8_t *input_data, size_t input
     int width = 0, height = 0;
     esp_err_t err;
 
+    timeline_begin(TIMELINE_PROCESSING);
+    stage_timer_t timer;
+    stage_begin(&timer, IMAGE_STAGE_DECODE, profile);
     if (format == IMAGE_FORMAT_JPG) {
-        err = decode_jpg_buffer(input_data, input_size, &rgb_buffer, &width, &height);
+        err = decode_jpg_buffer(input_data, input_size, &rgb_buffer, &width, &height, profile);
     } else if (format == IMAGE_FORMAT_PNG) {
         err = decode_png_buffer(input_data, input_size, &rgb_buffer, &width, &height);
     } else {
         ESP_LOGE(TAG, "Unsupported image format for buffer processing: %d", format);
-        return ESP_ERR_NOT_SUPPORTED;
+        err = ESP_ERR_NOT_SUPPORTED;
     }
+    stage_end(&timer, profile);
+    timeline_end(TIMELINE_PROCESSING);
 
     if (err != ESP_OK) {
         return err;
     }
 
     ESP_LOGI(TAG, "Decoded image: %dx%d", width, height);
+    profile_decoded(profile, format, width, height);
 
-    // Process RGB buffer
-    uint8_t *processed_buffer = NULL;
-    int processed_width = 0, processed_height = 0;
-    err = process_rgb_buffer_core(rgb_buffer, width, height, dither_algorithm, &processed_buffer,
-                                  &processed_width, &processed_height);
-
-    // Free original RGB buffer if it wasn't reused
-    if (rgb_buffer != processed_buffer) {
-        heap_caps_free(rgb_buffer);
-    }
-
+    // Return the processed RGB buffer directly (no PNG encoding)
+    err = image_processor_process_rgb(rgb_buffer, width, height, dither_algorithm, result, profile);
     if (err != ESP_OK) {
         return err;
     }
 
-    // Return the processed RGB buffer directly (no PNG encoding)
-    result->rgb_data = processed_buffer;
-    result->rgb_size = processed_width * processed_height * 3;
-    result->width = processed_width;
-    result->height = processed_height;
-
-    ESP_LOGI(TAG, "Processed to RGB buffer: %dx%d (%zu bytes)", processed_width, processed_height,
+    ESP_LOGI(TAG, "Processed to RGB buffer: %dx%d (%zu bytes)", result->width, result->height,
              result->rgb_size);
     return ESP_OK;
 }
 
+esp_err_t image_processor_process_file_to_rgb(const char *input_path, image_format_t format,
+                                              dither_algorithm_t dither_algorithm,
+                                              image_process_rgb_result_t *result,
+                                              image_profile_t *profile)
+{
+    const uint8_t *file_buffer = NULL;
+    size_t file_size = 0;
+    bool mapped = false;
+    esp_err_t err = load_input_file(input_path, &file_buffer, &file_size, &mapped);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (mapped) {
+        ESP_LOGI(TAG, "Decoding %s in place from RAM filesystem", input_path);
+    }
+    err = image_processor_process_to_rgb(file_buffer, file_size, format, dither_algorithm, result,
+                                         profile);
+    release_input_file(file_buffer, mapped);
+    return err;
+}
+
 esp_err_t image_processor_process(const char *input_path, const char *output_path,
-                                  dither_algorithm_t dither_algorithm)
+                                  dither_algorithm_t dither_algorithm, image_profile_t *profile)
 {
     const char *algo_names[] = {"floyd-steinberg", "stucki", "burkes", "sierra"};
     ESP_LOGI(TAG, "Processing %s -> %s (dither: %s)", input_path, output_path,
@@ -778,65 +1370,50 @@ esp_err_t image_processor_process(const char *input_path, const char *output_pat
         return ESP_FAIL;
     }
 
-    // Read entire file into buffer
-    FILE *fp = fopen(input_path, "rb");
-    if (!fp) {
-        ESP_LOGE(TAG, "Failed to open input file: %s", input_path);
-        return ESP_FAIL;
-    }
-
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    uint8_t *file_buffer = heap_caps_malloc(file_size, MALLOC_CAP_SPIRAM);
-    if (!file_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate file buffer of %ld bytes", file_size);
-        fclose(fp);
-        return ESP_ERR_NO_MEM;
-    }
-
-    size_t read_bytes = fread(file_buffer, 1, file_size, fp);
-    fclose(fp);
-
-    if (read_bytes != file_size) {
-        ESP_LOGE(TAG, "Failed to read entire file");
-        heap_caps_free(file_buffer);
-        return ESP_FAIL;
+    const uint8_t *file_buffer = NULL;
+    size_t file_size = 0;
+    bool mapped = false;
+    esp_err_t err = load_input_file(input_path, &file_buffer, &file_size, &mapped);
+    if (err != ESP_OK) {
+        return err;
     }
 
     // Decode to RGB buffer
     uint8_t *rgb_buffer = NULL;
     int width = 0, height = 0;
-    esp_err_t err;
 
+    timeline_begin(TIMELINE_PROCESSING);
+    stage_timer_t timer;
+    stage_begin(&timer, IMAGE_STAGE_DECODE, profile);
     if (format == IMAGE_FORMAT_JPG) {
-        err = decode_jpg_buffer(file_buffer, file_size, &rgb_buffer, &width, &height);
-    } else if (format == IMAGE_FORMAT_PNG) {
-        err = decode_png_buffer(file_buffer, file_size, &rgb_buffer, &width, &height);
+        err = decode_jpg_buffer(file_buffer, file_size, &rgb_buffer, &width, &height, profile);
     } else {
-        heap_caps_free(file_buffer);
-        return ESP_ERR_NOT_SUPPORTED;
+        err = decode_png_buffer(file_buffer, file_size, &rgb_buffer, &width, &height);
     }
+    stage_end(&timer, profile);
+    timeline_end(TIMELINE_PROCESSING);
 
     // Free input file buffer immediately after decoding
-    heap_caps_free(file_buffer);
+    release_input_file(file_buffer, mapped);
 
     if (err != ESP_OK) {
         return err;
     }
 
     ESP_LOGI(TAG, "Decoded image: %dx%d", width, height);
+    profile_decoded(profile, format, width, height);
 
     // Process RGB buffer
     uint8_t *processed_buffer = NULL;
     int processed_width = 0, processed_height = 0;
+    timeline_begin(TIMELINE_PROCESSING);
     err = process_rgb_buffer_core(rgb_buffer, width, height, dither_algorithm, &processed_buffer,
-                                  &processed_width, &processed_height);
+                                  &processed_width, &processed_height, profile);
+    timeline_end(TIMELINE_PROCESSING);
 
     // Free original RGB buffer if it wasn't reused
     if (rgb_buffer != processed_buffer) {
-        heap_caps_free(rgb_buffer);
+        pipeline_arena_free(rgb_buffer);
     }
 
     if (err != ESP_OK) {
@@ -845,9 +1422,13 @@ esp_err_t image_processor_process(const char *input_path, const char *output_pat
 
     // Write directly to file using png_init_io (no intermediate buffer)
     ESP_LOGI(TAG, "Writing PNG output to %s", output_path);
+    timeline_begin(TIMELINE_PROCESSING);
+    stage_begin(&timer, IMAGE_STAGE_ENCODE, profile);
     err = write_png_file(output_path, processed_buffer, processed_width, processed_height);
+    stage_end(&timer, profile);
+    timeline_end(TIMELINE_PROCESSING);
 
-    heap_caps_free(processed_buffer);
+    pipeline_arena_free(processed_buffer);
 
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "Successfully wrote PNG to %s", output_path);
@@ -989,20 +1570,25 @@ bool image_processor_is_processed_buffer(const uint8_t *data, size_t size)
         return false;
     }
 
+    bool valid = image_processor_is_processed_rgb(rgb_buffer, width, height);
+    pipeline_arena_free(rgb_buffer);
+    return valid;
+}
+
+bool image_processor_is_processed_rgb(const uint8_t *rgb_data, int width, int height)
+{
     // Check dimensions
     if (width != BOARD_HAL_DISPLAY_WIDTH || height != BOARD_HAL_DISPLAY_HEIGHT) {
         ESP_LOGI(TAG, "Buffer dimensions mismatch: %dx%d (expected %dx%d)", width, height,
                  BOARD_HAL_DISPLAY_WIDTH, BOARD_HAL_DISPLAY_HEIGHT);
-        heap_caps_free(rgb_buffer);
         return false;
     }
 
     // Check if all pixels are in palette
-    bool valid = true;
-    for (int i = 0; i < width * height && valid; i++) {
-        uint8_t r = rgb_buffer[i * 3];
-        uint8_t g = rgb_buffer[i * 3 + 1];
-        uint8_t b = rgb_buffer[i * 3 + 2];
+    for (int i = 0; i < width * height; i++) {
+        uint8_t r = rgb_data[i * 3];
+        uint8_t g = rgb_data[i * 3 + 1];
+        uint8_t b = rgb_data[i * 3 + 2];
 
         bool color_match = false;
         for (int j = 0; j < 7; j++) {
@@ -1015,12 +1601,10 @@ bool image_processor_is_processed_buffer(const uint8_t *data, size_t size)
         }
 
         if (!color_match) {
-            valid = false;
+            return false;
         }
     }
-
-    heap_caps_free(rgb_buffer);
-    return valid;
+    return true;
 }
 
 image_format_t image_processor_detect_format(const char *input_path)
@@ -21,16 +21,59 @@ typedef enum {
     IMAGE_FORMAT_JPG
 } image_format_t;
 
+// Pipeline stages, for timing
+typedef enum {
+    IMAGE_STAGE_DECODE,
+    IMAGE_STAGE_RESIZE,
+    IMAGE_STAGE_ROTATE,
+    IMAGE_STAGE_CDR,
+    IMAGE_STAGE_DITHER,
+    IMAGE_STAGE_ENCODE,  // PNG output of image_processor_process()
+    IMAGE_STAGE_PAINT,   // Drawing into the framebuffer, see display_manager_get_last_paint_us()
+    IMAGE_STAGE_COUNT
+} image_stage_t;
+
+#define IMAGE_PROFILE_HISTORY 8
+
+/**
+ * @brief Where the time and memory of one image went
+ *
+ * Zero-initialize it and pass it to each pipeline call of the run; every call adds the stages
+ * it performed, and the memory its buffers took from the pipeline arena and from the heap.
+ */
+typedef struct {
+    uint32_t job_id;  // Display job the run belonged to, 0 if none
+    image_format_t format;
+    int source_width;  // Encoded image size
+    int source_height;
+    int decode_scale;  // JPEG downscale denominator (1, 2, 4 or 8); 1 for PNG
+    int decoded_width;
+    int decoded_height;
+    uint32_t yields;      // Times the pipeline gave up the CPU to let other tasks run
+    uint16_t stages_run;  // Bit per image_stage_t
+    uint32_t stage_us[IMAGE_STAGE_COUNT];
+    uint32_t arena_peak_bytes;     // Most of the pipeline arena the run had in use
+    uint32_t heap_fallback_bytes;  // Buffers the run allocated from the heap instead of the arena
+} image_profile_t;
+
 /**
  * @brief Result structure for raw RGB buffer output (no PNG encoding)
  */
 typedef struct {
-    uint8_t *rgb_data;  // RGB888 buffer (caller must free with heap_caps_free)
+    uint8_t *rgb_data;  // RGB888 buffer (caller must free with pipeline_arena_free)
     size_t rgb_size;    // Size of RGB data in bytes (width * height * 3)
     int width;          // Output image width
     int height;         // Output image height
 } image_process_rgb_result_t;
 
+/**
+ * @brief Source of encoded image bytes for image_processor_decode_stream()
+ *
+ * Copies up to len bytes into buf and returns how many were copied, 0 at the end of the input
+ * or a negative value on error. May block until data is available.
+ */
+typedef int (*image_stream_read_fn)(void *ctx, uint8_t *buf, size_t len);
+
 esp_err_t image_processor_init(void);
 
 /**
@@ -40,7 +83,7 @@ esp_err_t image_processor_init(void);
  * For SD-card systems, this is the preferred interface.
  */
 esp_err_t image_processor_process(const char *input_path, const char *output_path,
-                                  dither_algorithm_t dither_algorithm);
+                                  dither_algorithm_t dither_algorithm, image_profile_t *profile);
 
 /**
  * @brief Process image from memory buffer to raw RGB buffer (no PNG encoding)
@@ -48,21 +91,130 @@ esp_err_t image_processor_process(const char *input_path, const char *output_pat
  * This function takes raw image data (PNG or JPG), processes it, and returns
  * the processed RGB buffer directly. This is more efficient for SD-card-less
  * systems where the image can be displayed directly without PNG encode/decode.
- * The caller is responsible for freeing result->rgb_data with heap_caps_free().
+ * The caller is responsible for freeing result->rgb_data with pipeline_arena_free().
  *
  * @param input_data Raw image data (PNG or JPG format)
  * @param input_size Size of input data in bytes
  * @param format Image format of input data
  * @param dither_algorithm Dithering algorithm to use
  * @param result Output structure containing processed RGB data
+ * @param profile Optional, filled in with the run's timings (see image_profile_t)
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t image_processor_process_to_rgb(const uint8_t *input_data, size_t input_size,
                                          image_format_t format, dither_algorithm_t dither_algorithm,
-                                         image_process_rgb_result_t *result);
+                                         image_process_rgb_result_t *result,
+                                         image_profile_t *profile);
+
+/**
+ * @brief Process an image file to a raw RGB buffer
+ *
+ * Same as image_processor_process_to_rgb(), reading the input from a file. Files on the RAM
+ * filesystem are decoded in place through memfs_map() instead of being copied into a second
+ * buffer. The file must not be renamed over, unlinked or written while this runs.
+ */
+esp_err_t image_processor_process_file_to_rgb(const char *input_path, image_format_t format,
+                                              dither_algorithm_t dither_algorithm,
+                                              image_process_rgb_result_t *result,
+                                              image_profile_t *profile);
+
+/**
+ * @brief Decode an image to an unprocessed RGB buffer while its bytes are being received
+ *
+ * PNG data is decoded as it is read. JPEG data is collected in a PSRAM buffer of size_hint
+ * bytes (the expected input size) and decoded once complete. No files are written. The caller
+ * frees decoded->rgb_data with pipeline_arena_free() or passes it to
+ * image_processor_process_rgb().
+ */
+esp_err_t image_processor_decode_stream(image_format_t format, size_t size_hint,
+                                        image_stream_read_fn read, void *ctx,
+                                        image_process_rgb_result_t *decoded,
+                                        image_profile_t *profile);
+
+typedef struct image_stream_decoder image_stream_decoder_t;
+
+/**
+ * @brief Start decoding an image whose bytes will be pushed in as they arrive
+ *
+ * Runs image_processor_decode_stream() on its own task, so decoding overlaps whatever produces
+ * the bytes (typically a network transfer). Returns NULL if the task cannot be started.
+ */
+image_stream_decoder_t *image_processor_stream_decoder_start(image_format_t format,
+                                                             size_t size_hint);
+
+/**
+ * @brief Push the next piece of the encoded image, blocking while the decoder catches up
+ *
+ * Bytes that arrive after the decoder has seen the end of the image are discarded.
+ *
+ * @return The decoder's error if it has already failed
+ */
+esp_err_t image_processor_stream_decoder_feed(image_stream_decoder_t *decoder, const uint8_t *data,
+                                              size_t len);
+
+/**
+ * @brief Mark the input complete and wait for the decoded RGB buffer
+ *
+ * On success the caller owns decoded->rgb_data. The decoder must still be freed. The decode
+ * stage is added to profile if one is given.
+ */
+esp_err_t image_processor_stream_decoder_finish(image_stream_decoder_t *decoder,
+                                                image_process_rgb_result_t *decoded,
+                                                image_profile_t *profile);
+
+/**
+ * @brief Free a decoder, cutting its input short first if it is still running
+ */
+void image_processor_stream_decoder_free(image_stream_decoder_t *decoder);
+
+/**
+ * @brief Resize, rotate and dither a decoded RGB buffer for the panel
+ *
+ * Takes ownership of rgb_data: it is either reused for the result or freed.
+ */
+esp_err_t image_processor_process_rgb(uint8_t *rgb_data, int width, int height,
+                                      dither_algorithm_t dither_algorithm,
+                                      image_process_rgb_result_t *result,
+                                      image_profile_t *profile);
 
 esp_err_t image_processor_reload_palette(void);
 
+/**
+ * @brief Short lowercase name of a pipeline stage, e.g. "decode"
+ */
+const char *image_processor_stage_name(image_stage_t stage);
+
+/**
+ * @brief Record a stage timed outside the image processor, e.g. the paint stage
+ *
+ * Does nothing if profile is NULL or duration_us is not positive.
+ */
+void image_processor_profile_add_stage(image_profile_t *profile, image_stage_t stage,
+                                       int64_t duration_us);
+
+/**
+ * @brief Add a finished run to the last IMAGE_PROFILE_HISTORY kept in RAM
+ */
+void image_processor_profile_save(const image_profile_t *profile);
+
+/**
+ * @brief Find the most recent saved run of a display job
+ *
+ * @return false if no run of that job is kept
+ */
+bool image_processor_profile_find_job(uint32_t job_id, image_profile_t *profile);
+
+/**
+ * @brief A run as JSON (caller must cJSON_Delete), NULL if out of memory
+ */
+struct cJSON;
+struct cJSON *image_processor_profile_to_json(const image_profile_t *profile);
+
+/**
+ * @brief The saved runs as a JSON array, newest first
+ */
+struct cJSON *image_processor_profile_history_to_json(void);
+
 bool image_processor_is_processed(const char *input_path);
 
 /**
@@ -70,6 +222,11 @@ bool image_processor_is_processed(const char *input_path);
  */
 bool image_processor_is_processed_buffer(const uint8_t *data, size_t size);
 
+/**
+ * @brief Check if a decoded RGB buffer is already panel-sized and uses only palette colors
+ */
+bool image_processor_is_processed_rgb(const uint8_t *rgb_data, int width, int height);
+
 image_format_t image_processor_detect_format(const char *input_path);
 
 /**
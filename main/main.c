@@ -37,6 +37,7 @@
 #include "power_manager.h"
 #include "processing_settings.h"
 #include "storage.h"
+#include "timeline.h"
 #include "utils.h"
 #include "wifi_manager.h"
 #include "wifi_provisioning.h"
@@ -115,7 +116,12 @@ static bool connect_to_wifi_with_timeout(int timeout_seconds)
     }
 
     if (wifi_manager_is_connected()) {
-        ESP_LOGI(TAG, "WiFi connected after %d seconds", retry_count);
+        wifi_connect_stats_t stats;
+        wifi_manager_get_connect_stats(&stats);
+        ESP_LOGI(TAG, "WiFi connected in %d ms%s", stats.connect_ms,
+                 stats.fast ? (stats.cached_lease ? " (fast reconnect, cached lease)"
+                                                  : " (fast reconnect)")
+                            : "");
         return true;
     } else {
         ESP_LOGE(TAG, "WiFi connection timeout after %d seconds", timeout_seconds);
@@ -169,8 +175,8 @@ static void button_task(void *arg)
                 if (duration > 50 && duration < 3000) {
                     ESP_LOGI(TAG, "Key button pressed, triggering rotation");
                     power_manager_reset_sleep_timer();
-                    trigger_image_rotation();
-                    ha_notify_update();
+                    // Queued so repeated presses during a refresh collapse into one rotation
+                    queue_image_rotation(NULL);
                 }
             }
             last_key_state = current_key_state;
@@ -205,6 +211,27 @@ static void button_task(void *arg)
     }
 }
 
+static esp_err_t prefetch_show_job(void *arg)
+{
+    return url_prefetch_show();
+}
+
+// Block until a display job has finished; returns its result
+static esp_err_t wait_for_display_job(uint32_t job_id)
+{
+    display_job_status_t status;
+    while (display_manager_get_job_status(job_id, &status) == ESP_OK) {
+        if (status.state == DISPLAY_JOB_DONE || status.state == DISPLAY_JOB_FAILED) {
+            return status.result;
+        }
+        if (status.state == DISPLAY_JOB_SUPERSEDED) {
+            return ESP_FAIL;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
 void deep_sleep_wake_main(void)
 {
     // Check rotation mode and HA configuration
@@ -212,10 +239,21 @@ void deep_sleep_wake_main(void)
     bool ha_configured = ha_is_configured();
     bool wifi_connected = false;
 
+    // A frame prefetched before the last sleep goes up right away: the panel refreshes on the
+    // display job task while Wi-Fi connects, and the network only prepares the next frame
+    uint32_t prefetch_job = 0;
+    if (rotation_mode == ROTATION_MODE_URL && url_prefetch_available()) {
+        ESP_LOGI(TAG, "Showing prefetched frame");
+        if (display_manager_submit_job(prefetch_show_job, NULL, NULL, &prefetch_job) != ESP_OK) {
+            prefetch_job = 0;
+        }
+    }
+
     // Initialize WiFi if needed (URL mode always needs it, SD card mode only if HA configured)
     if (rotation_mode == ROTATION_MODE_URL || ha_configured) {
         ESP_LOGI(TAG, "Initializing WiFi for %s",
                  rotation_mode == ROTATION_MODE_URL ? "URL rotation" : "HA battery post");
+        timeline_begin(TIMELINE_WIFI_CONNECT);
         ESP_ERROR_CHECK(wifi_manager_init());
 
         if (connect_to_wifi_with_timeout(60)) {
@@ -224,6 +262,7 @@ void deep_sleep_wake_main(void)
         } else {
             ESP_LOGW(TAG, "WiFi connection timeout");
         }
+        timeline_end(TIMELINE_WIFI_CONNECT);
     }
 
     // Start HTTP server for 10 seconds to allow config modifications
@@ -232,7 +271,9 @@ void deep_sleep_wake_main(void)
 
         // Check and run periodic tasks (OTA check, SNTP sync if due)
         ESP_LOGI(TAG, "Checking periodic tasks...");
+        timeline_begin(TIMELINE_PERIODIC_TASKS);
         periodic_tasks_check_and_run();
+        timeline_end(TIMELINE_PERIODIC_TASKS);
 
         ESP_LOGI(TAG, "Starting HTTP server for 10 seconds before sleep");
         power_manager_reset_sleep_timer();
@@ -248,7 +289,13 @@ void deep_sleep_wake_main(void)
 
     // Trigger rotation
     power_manager_reset_sleep_timer();
-    trigger_image_rotation();
+    if (prefetch_job != 0 && wait_for_display_job(prefetch_job) == ESP_OK) {
+        if (wifi_connected) {
+            url_prefetch_next();
+        }
+    } else {
+        trigger_image_rotation();
+    }
 
     // Notify HA that data has been updated (after both OTA check and rotation)
     if (wifi_connected && ha_configured) {
@@ -310,12 +357,18 @@ void app_main(void)
 
     // Initialize Board HAL
     ESP_LOGI(TAG, "Initializing Board HAL...");
+    timeline_begin(TIMELINE_BOARD_INIT);
     ESP_ERROR_CHECK(board_hal_init());
+    timeline_end(TIMELINE_BOARD_INIT);
     ESP_LOGI(TAG, "Board HAL initialized");
 
     // Initialize the storage subsystem (handles SD, LittleFS, MemFS fallbacks)
     ESP_LOGI(TAG, "Initializing storage subsystem...");
+    timeline_begin(TIMELINE_STORAGE_INIT);
     ESP_ERROR_CHECK(storage_init());
+    timeline_end(TIMELINE_STORAGE_INIT);
+
+    timeline_begin(TIMELINE_SYSTEM_INIT);
 
     // Initialize external RTC (via HAL)
     ESP_LOGI(TAG, "Initializing RTC...");
@@ -405,9 +458,12 @@ void app_main(void)
 
     ESP_ERROR_CHECK(album_manager_init());
 
+    timeline_end(TIMELINE_SYSTEM_INIT);
+
     // Check wake-up source
     wakeup_source_t wakeup_src = power_manager_get_wakeup_source();
     ESP_LOGI(TAG, "Wake-up source: %d", wakeup_src);
+    timeline_set_wakeup_source(wakeup_src);
 
     switch (wakeup_src) {
     case WAKEUP_SOURCE_CLEAR_BUTTON:
@@ -436,7 +492,9 @@ void app_main(void)
         break;
     }
 
+    timeline_begin(TIMELINE_WIFI_CONNECT);
     ESP_ERROR_CHECK(wifi_manager_init());
+    timeline_end(TIMELINE_WIFI_CONNECT);
     ESP_ERROR_CHECK(wifi_provisioning_init());
 
     if (!wifi_provisioning_is_provisioned()) {
@@ -499,12 +557,18 @@ void app_main(void)
         }
     }
 
-    if (connect_to_wifi_with_timeout(30)) {
+    timeline_begin(TIMELINE_WIFI_CONNECT);
+    bool wifi_connected = connect_to_wifi_with_timeout(30);
+    timeline_end(TIMELINE_WIFI_CONNECT);
+
+    if (wifi_connected) {
         // Check and run periodic tasks (OTA check, SNTP sync if due)
         // Note: If RTC was invalid at boot, sntp_sync was already forced via
         // periodic_tasks_force_run()
         ESP_LOGI(TAG, "Checking periodic tasks...");
+        timeline_begin(TIMELINE_PERIODIC_TASKS);
         periodic_tasks_check_and_run();
+        timeline_end(TIMELINE_PERIODIC_TASKS);
 
         // Start mDNS service
         ESP_ERROR_CHECK(mdns_service_init());
@@ -0,0 +1,333 @@
+#include "metrics.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define HISTOGRAM_MAX_BOUNDS 12
+#define RENDER_INITIAL_SIZE 8192
+
+typedef struct {
+    atomic_uint buckets[HISTOGRAM_MAX_BOUNDS + 1];  // Per bucket, not cumulative; last is +Inf
+    atomic_uint_fast64_t sum_us;
+} histogram_t;
+
+typedef struct {
+    const char *uri;
+    const char *method;
+    histogram_t latency;
+} route_metrics_t;
+
+typedef struct {
+    uint32_t caps;
+    const char *name;
+    atomic_uint free_high;
+    atomic_uint largest_low;
+    atomic_uint largest_high;
+} heap_metrics_t;
+
+// Upper bounds in microseconds
+static const uint32_t http_bounds_us[] = {5000,    10000,   25000,   50000,    100000,   250000,
+                                          500000,  1000000, 2500000, 5000000, 10000000, 30000000};
+static const uint32_t refresh_bounds_us[] = {1000000,  2000000,  5000000,  10000000, 15000000,
+                                             20000000, 30000000, 45000000, 60000000};
+
+_Static_assert(sizeof(http_bounds_us) / sizeof(http_bounds_us[0]) <= HISTOGRAM_MAX_BOUNDS,
+               "too many HTTP latency buckets");
+_Static_assert(sizeof(refresh_bounds_us) / sizeof(refresh_bounds_us[0]) <= HISTOGRAM_MAX_BOUNDS,
+               "too many refresh duration buckets");
+
+static const struct {
+    const char *name;
+    const char *help;
+} counter_info[METRICS_COUNTER_COUNT] = {
+    [METRICS_HTTP_BYTES_SENT] = {"photoframe_http_sent_bytes_total",
+                                 "Bytes sent by the HTTP server"},
+    [METRICS_HTTP_BYTES_RECEIVED] = {"photoframe_http_received_bytes_total",
+                                     "Bytes received by the HTTP server"},
+    [METRICS_STORAGE_BYTES_READ] = {"photoframe_storage_read_bytes_total",
+                                    "Image data read from storage"},
+    [METRICS_STORAGE_BYTES_WRITTEN] = {"photoframe_storage_written_bytes_total",
+                                       "Image data written to storage"},
+    [METRICS_DISPLAY_REFRESH_SKIPPED] = {"photoframe_display_refresh_skipped_total",
+                                         "Refreshes skipped because the frame was unchanged"},
+    [METRICS_WIFI_CONNECTS] = {"photoframe_wifi_connects_total",
+                               "Wi-Fi connections that obtained an IP address"},
+    [METRICS_WIFI_DISCONNECTS] = {"photoframe_wifi_disconnects_total",
+                                  "Wi-Fi disconnections and failed connection attempts"},
+    [METRICS_WIFI_RECONNECT_ATTEMPTS] = {"photoframe_wifi_reconnect_attempts_total",
+                                         "Wi-Fi reconnection attempts after a disconnection"},
+    [METRICS_PIPELINE_ARENA_FALLBACKS] = {"photoframe_pipeline_arena_fallbacks_total",
+                                          "Image pipeline buffers allocated from the heap because "
+                                          "the arena was full"},
+};
+
+static atomic_uint_fast64_t counters[METRICS_COUNTER_COUNT];
+
+static route_metrics_t routes[METRICS_MAX_ROUTES];
+static atomic_int route_count;
+static portMUX_TYPE route_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static histogram_t refresh_duration;
+
+static atomic_uint stage_count[IMAGE_STAGE_COUNT];
+static atomic_uint_fast64_t stage_sum_us[IMAGE_STAGE_COUNT];
+
+static heap_metrics_t heaps[] = {
+    {.caps = MALLOC_CAP_INTERNAL, .name = "internal", .largest_low = UINT_MAX},
+    {.caps = MALLOC_CAP_SPIRAM, .name = "spiram", .largest_low = UINT_MAX},
+};
+
+void metrics_add(metrics_counter_t counter, uint64_t value)
+{
+    if (counter < METRICS_COUNTER_COUNT) {
+        atomic_fetch_add_explicit(&counters[counter], value, memory_order_relaxed);
+    }
+}
+
+static void histogram_observe(histogram_t *histogram, const uint32_t *bounds, int bound_count,
+                              int64_t duration_us)
+{
+    if (duration_us < 0) {
+        duration_us = 0;
+    }
+    int bucket = 0;
+    while (bucket < bound_count && duration_us > bounds[bucket]) {
+        bucket++;
+    }
+    atomic_fetch_add_explicit(&histogram->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum_us, (uint64_t) duration_us, memory_order_relaxed);
+}
+
+int metrics_register_route(const char *uri, const char *method)
+{
+    int route = -1;
+
+    portENTER_CRITICAL(&route_lock);
+    int count = atomic_load_explicit(&route_count, memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(routes[i].uri, uri) == 0 && strcmp(routes[i].method, method) == 0) {
+            route = i;
+            break;
+        }
+    }
+    if (route < 0 && count < METRICS_MAX_ROUTES) {
+        route = count;
+        routes[route].uri = uri;
+        routes[route].method = method;
+        // Published only once the slot is filled in, for a concurrent metrics_render()
+        atomic_store_explicit(&route_count, count + 1, memory_order_release);
+    }
+    portEXIT_CRITICAL(&route_lock);
+
+    return route;
+}
+
+void metrics_http_request(int route, int64_t duration_us)
+{
+    if (route >= 0 && route < METRICS_MAX_ROUTES) {
+        histogram_observe(&routes[route].latency, http_bounds_us,
+                          sizeof(http_bounds_us) / sizeof(http_bounds_us[0]), duration_us);
+    }
+}
+
+void metrics_display_refresh(int64_t duration_us)
+{
+    histogram_observe(&refresh_duration, refresh_bounds_us,
+                      sizeof(refresh_bounds_us) / sizeof(refresh_bounds_us[0]), duration_us);
+}
+
+void metrics_image_stage(image_stage_t stage, int64_t duration_us)
+{
+    if (stage < IMAGE_STAGE_COUNT && duration_us >= 0) {
+        atomic_fetch_add_explicit(&stage_count[stage], 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stage_sum_us[stage], (uint64_t) duration_us,
+                                  memory_order_relaxed);
+    }
+}
+
+static void atomic_raise(atomic_uint *target, unsigned int value)
+{
+    unsigned int current = atomic_load_explicit(target, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(target, &current, value, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+static void atomic_lower(atomic_uint *target, unsigned int value)
+{
+    unsigned int current = atomic_load_explicit(target, memory_order_relaxed);
+    while (value < current &&
+           !atomic_compare_exchange_weak_explicit(target, &current, value, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void metrics_sample_heap(void)
+{
+    for (size_t i = 0; i < sizeof(heaps) / sizeof(heaps[0]); i++) {
+        if (heap_caps_get_total_size(heaps[i].caps) == 0) {
+            continue;
+        }
+        size_t largest = heap_caps_get_largest_free_block(heaps[i].caps);
+        atomic_raise(&heaps[i].free_high, heap_caps_get_free_size(heaps[i].caps));
+        atomic_raise(&heaps[i].largest_high, largest);
+        atomic_lower(&heaps[i].largest_low, largest);
+    }
+}
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t size;
+    bool failed;
+} text_t;
+
+static void __attribute__((format(printf, 2, 3))) append(text_t *text, const char *fmt, ...)
+{
+    while (!text->failed) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(text->buf + text->len, text->size - text->len, fmt, args);
+        va_end(args);
+
+        if (n < 0) {
+            text->failed = true;
+        } else if ((size_t) n < text->size - text->len) {
+            text->len += n;
+            return;
+        } else {
+            char *grown = realloc(text->buf, text->size * 2);
+            if (!grown) {
+                text->failed = true;
+            } else {
+                text->buf = grown;
+                text->size *= 2;
+            }
+        }
+    }
+}
+
+static void append_header(text_t *text, const char *name, const char *type, const char *help)
+{
+    append(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// labels is empty or a comma-separated label list without braces
+static void append_histogram(text_t *text, const char *name, const char *labels,
+                             const histogram_t *histogram, const uint32_t *bounds,
+                             int bound_count)
+{
+    const char *sep = labels[0] != '\0' ? "," : "";
+    unsigned int cumulative = 0;
+    for (int i = 0; i < bound_count; i++) {
+        cumulative += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        append(text, "%s_bucket{%s%sle=\"%g\"} %u\n", name, labels, sep, bounds[i] / 1e6,
+               cumulative);
+    }
+    cumulative += atomic_load_explicit(&histogram->buckets[bound_count], memory_order_relaxed);
+    append(text, "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, sep, cumulative);
+
+    uint64_t sum_us = atomic_load_explicit(&histogram->sum_us, memory_order_relaxed);
+    if (labels[0] != '\0') {
+        append(text, "%s_sum{%s} %.6f\n%s_count{%s} %u\n", name, labels, sum_us / 1e6, name,
+               labels, cumulative);
+    } else {
+        append(text, "%s_sum %.6f\n%s_count %u\n", name, sum_us / 1e6, name, cumulative);
+    }
+}
+
+char *metrics_render(void)
+{
+    metrics_sample_heap();
+
+    text_t text = {.buf = malloc(RENDER_INITIAL_SIZE), .size = RENDER_INITIAL_SIZE};
+    if (!text.buf) {
+        return NULL;
+    }
+    text.buf[0] = '\0';
+
+    append_header(&text, "photoframe_uptime_seconds", "gauge", "Time since boot");
+    append(&text, "photoframe_uptime_seconds %.3f\n", esp_timer_get_time() / 1e6);
+
+    for (int i = 0; i < METRICS_COUNTER_COUNT; i++) {
+        append_header(&text, counter_info[i].name, "counter", counter_info[i].help);
+        append(&text, "%s %llu\n", counter_info[i].name,
+               (unsigned long long) atomic_load_explicit(&counters[i], memory_order_relaxed));
+    }
+
+    const char *http_name = "photoframe_http_request_duration_seconds";
+    append_header(&text, http_name, "histogram", "HTTP request handling time by URI and method");
+    int count = atomic_load_explicit(&route_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        char labels[128];
+        snprintf(labels, sizeof(labels), "uri=\"%s\",method=\"%s\"", routes[i].uri,
+                 routes[i].method);
+        append_histogram(&text, http_name, labels, &routes[i].latency, http_bounds_us,
+                         sizeof(http_bounds_us) / sizeof(http_bounds_us[0]));
+    }
+
+    const char *refresh_name = "photoframe_display_refresh_duration_seconds";
+    append_header(&text, refresh_name, "histogram", "E-paper refresh time");
+    append_histogram(&text, refresh_name, "", &refresh_duration, refresh_bounds_us,
+                     sizeof(refresh_bounds_us) / sizeof(refresh_bounds_us[0]));
+
+    const char *stage_name = "photoframe_image_stage_duration_seconds";
+    append_header(&text, stage_name, "summary", "Image pipeline time by stage");
+    for (int i = 0; i < IMAGE_STAGE_COUNT; i++) {
+        const char *stage = image_processor_stage_name(i);
+        append(&text, "%s_sum{stage=\"%s\"} %.6f\n", stage_name, stage,
+               atomic_load_explicit(&stage_sum_us[i], memory_order_relaxed) / 1e6);
+        append(&text, "%s_count{stage=\"%s\"} %u\n", stage_name, stage,
+               atomic_load_explicit(&stage_count[i], memory_order_relaxed));
+    }
+
+    // Samples of one metric have to be contiguous, so collect per heap first
+    static const struct {
+        const char *name;
+        const char *help;
+    } heap_gauges[] = {
+        {"photoframe_heap_free_bytes", "Free heap"},
+        {"photoframe_heap_free_min_bytes", "Lowest free heap since boot"},
+        {"photoframe_heap_free_max_bytes", "Highest sampled free heap"},
+        {"photoframe_heap_largest_free_block_bytes", "Largest free heap block"},
+        {"photoframe_heap_largest_free_block_min_bytes", "Smallest sampled largest free block"},
+        {"photoframe_heap_largest_free_block_max_bytes", "Largest sampled largest free block"},
+    };
+    const size_t heap_count = sizeof(heaps) / sizeof(heaps[0]);
+    const size_t gauge_count = sizeof(heap_gauges) / sizeof(heap_gauges[0]);
+    size_t values[sizeof(heaps) / sizeof(heaps[0])][sizeof(heap_gauges) / sizeof(heap_gauges[0])];
+    for (size_t i = 0; i < heap_count; i++) {
+        uint32_t caps = heaps[i].caps;
+        values[i][0] = heap_caps_get_free_size(caps);
+        values[i][1] = heap_caps_get_minimum_free_size(caps);
+        values[i][2] = atomic_load_explicit(&heaps[i].free_high, memory_order_relaxed);
+        values[i][3] = heap_caps_get_largest_free_block(caps);
+        values[i][4] = atomic_load_explicit(&heaps[i].largest_low, memory_order_relaxed);
+        values[i][5] = atomic_load_explicit(&heaps[i].largest_high, memory_order_relaxed);
+    }
+    for (size_t g = 0; g < gauge_count; g++) {
+        append_header(&text, heap_gauges[g].name, "gauge", heap_gauges[g].help);
+        for (size_t i = 0; i < heap_count; i++) {
+            if (heap_caps_get_total_size(heaps[i].caps) > 0) {
+                append(&text, "%s{heap=\"%s\"} %zu\n", heap_gauges[g].name, heaps[i].name,
+                       values[i][g]);
+            }
+        }
+    }
+
+    if (text.failed) {
+        free(text.buf);
+        return NULL;
+    }
+    return text.buf;
+}
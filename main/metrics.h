@@ -0,0 +1,59 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image_processor.h"
+
+// Monotonic counters. Appending is fine; the names are in metrics.c
+typedef enum {
+    METRICS_HTTP_BYTES_SENT,
+    METRICS_HTTP_BYTES_RECEIVED,
+    METRICS_STORAGE_BYTES_READ,     // Image data read from storage
+    METRICS_STORAGE_BYTES_WRITTEN,  // Image data written to storage
+    METRICS_DISPLAY_REFRESH_SKIPPED,
+    METRICS_WIFI_CONNECTS,
+    METRICS_WIFI_DISCONNECTS,
+    METRICS_WIFI_RECONNECT_ATTEMPTS,
+    METRICS_PIPELINE_ARENA_FALLBACKS,  // Pipeline buffers that didn't fit in the arena
+    METRICS_COUNTER_COUNT
+} metrics_counter_t;
+
+#define METRICS_MAX_ROUTES 64
+
+/**
+ * @brief Add to a counter. Safe from any task and cheap enough for per-packet use
+ */
+void metrics_add(metrics_counter_t counter, uint64_t value);
+
+/**
+ * @brief Get the slot that metrics_http_request() takes for a URI handler
+ *
+ * Registering the same uri and method again returns the same slot. Both strings must outlive
+ * the firmware (literals or static tables). Returns -1 once METRICS_MAX_ROUTES are in use.
+ */
+int metrics_register_route(const char *uri, const char *method);
+
+void metrics_http_request(int route, int64_t duration_us);
+
+void metrics_display_refresh(int64_t duration_us);
+
+void metrics_image_stage(image_stage_t stage, int64_t duration_us);
+
+/**
+ * @brief Fold the current heap state into the free and largest-free-block watermarks
+ *
+ * Walks the heap, so it is called at the end of pipeline runs, refreshes and scrapes rather
+ * than per request. The low watermark of free memory is exact regardless.
+ */
+void metrics_sample_heap(void);
+
+/**
+ * @brief Render every metric in the Prometheus text exposition format
+ *
+ * @return NUL-terminated text (caller must free), NULL if out of memory
+ */
+char *metrics_render(void);
+
+#endif
@@ -0,0 +1,176 @@
+#include "pipeline_arena.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "board_hal.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
+
+#define ARENA_FRAMES 2
+#define ARENA_ALIGN 16
+// Every block starts with its size, so that the most recent block can be given back early
+#define BLOCK_HEADER ARENA_ALIGN
+// Room for row buffers, dither error rows and other small allocations next to the frames
+#define ARENA_SLACK (64 * 1024)
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+static const char *TAG = "pipeline_arena";
+
+static uint8_t *arena = NULL;
+static size_t arena_size = 0;
+static size_t frame_size = 0;
+static size_t arena_top = 0;   // Offset of the first free byte
+static size_t arena_peak = 0;  // Highest arena_top since the last rewind
+static int arena_blocks = 0;   // Blocks handed out and not released yet
+// Task whose run is using the arena. Runs on other tasks meanwhile use the heap, so their blocks
+// never interleave with this run's and the arena rewinds as soon as this run is done.
+static TaskHandle_t arena_owner = NULL;
+static portMUX_TYPE arena_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Bytes the calling task's pipeline_arena_alloc() calls took from the heap, for profiling
+static __thread size_t task_fallback_bytes = 0;
+
+esp_err_t pipeline_arena_init(void)
+{
+    if (arena) {
+        return ESP_OK;
+    }
+
+    frame_size = (size_t) BOARD_HAL_DISPLAY_WIDTH * BOARD_HAL_DISPLAY_HEIGHT * 3;
+    size_t size = ARENA_FRAMES * (BLOCK_HEADER + ALIGN_UP(frame_size)) + ARENA_SLACK;
+    arena = heap_caps_aligned_alloc(ARENA_ALIGN, size, MALLOC_CAP_SPIRAM);
+    if (!arena) {
+        ESP_LOGW(TAG, "Failed to reserve %zu byte arena, pipeline buffers will use the heap",
+                 size);
+        return ESP_ERR_NO_MEM;
+    }
+    arena_size = size;
+
+    ESP_LOGI(TAG, "Reserved %zu byte pipeline arena (%d frames of %zu bytes)", arena_size,
+             ARENA_FRAMES, frame_size);
+    return ESP_OK;
+}
+
+static bool in_arena(const void *ptr)
+{
+    uintptr_t p = (uintptr_t) ptr;
+    return arena && p >= (uintptr_t) arena && p < (uintptr_t) arena + arena_size;
+}
+
+void *pipeline_arena_alloc(size_t size)
+{
+    uint8_t *block = NULL;
+    size_t needed = 0;
+    bool busy = false;
+
+    if (arena && size > 0 && size <= arena_size) {
+        TaskHandle_t self = xTaskGetCurrentTaskHandle();
+        needed = BLOCK_HEADER + ALIGN_UP(size);
+        taskENTER_CRITICAL(&arena_lock);
+        busy = arena_blocks > 0 && arena_owner != self;
+        if (!busy && needed <= arena_size - arena_top) {
+            block = arena + arena_top;
+            arena_top += needed;
+            arena_blocks++;
+            arena_owner = self;
+            if (arena_top > arena_peak) {
+                arena_peak = arena_top;
+            }
+        }
+        taskEXIT_CRITICAL(&arena_lock);
+    }
+
+    if (!block) {
+        if (arena) {
+            ESP_LOGD(TAG, "%s, allocating %zu bytes from the heap",
+                     busy ? "Arena in use by another run" : "Arena full", size);
+            metrics_add(METRICS_PIPELINE_ARENA_FALLBACKS, 1);
+        }
+        void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+        if (ptr) {
+            task_fallback_bytes += size;
+        }
+        return ptr;
+    }
+
+    *(size_t *) block = needed;
+    return block + BLOCK_HEADER;
+}
+
+void *pipeline_arena_calloc(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = pipeline_arena_alloc(count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void pipeline_arena_free(void *ptr)
+{
+    if (!in_arena(ptr)) {
+        heap_caps_free(ptr);
+        return;
+    }
+
+    uint8_t *block = (uint8_t *) ptr - BLOCK_HEADER;
+    size_t size = *(size_t *) block;
+    size_t run_peak = 0;
+
+    taskENTER_CRITICAL(&arena_lock);
+    if (--arena_blocks == 0) {
+        // The run is over: start the next one from the bottom
+        run_peak = arena_peak;
+        arena_top = 0;
+        arena_peak = 0;
+        arena_owner = NULL;
+    } else if (block + size == arena + arena_top) {
+        arena_top = block - arena;
+    }
+    taskEXIT_CRITICAL(&arena_lock);
+
+    if (run_peak) {
+        ESP_LOGD(TAG, "Arena rewound, peak use %zu of %zu bytes", run_peak, arena_size);
+    }
+}
+
+void pipeline_arena_adopt(TaskHandle_t from)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    taskENTER_CRITICAL(&arena_lock);
+    if (arena_blocks > 0 && arena_owner == from) {
+        arena_owner = self;
+    }
+    taskEXIT_CRITICAL(&arena_lock);
+}
+
+size_t pipeline_arena_run_peak(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    size_t peak = 0;
+    taskENTER_CRITICAL(&arena_lock);
+    if (arena_blocks > 0 && arena_owner == self) {
+        peak = arena_peak;
+    }
+    taskEXIT_CRITICAL(&arena_lock);
+    return peak;
+}
+
+size_t pipeline_arena_task_fallback_bytes(void)
+{
+    return task_fallback_bytes;
+}
+
+size_t pipeline_arena_frame_size(void)
+{
+    return frame_size;
+}
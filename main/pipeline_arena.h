@@ -0,0 +1,74 @@
+#ifndef PIPELINE_ARENA_H
+#define PIPELINE_ARENA_H
+
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief Reserve the image pipeline's PSRAM arena
+ *
+ * Called once at boot, before other large PSRAM allocations are made, so the block is
+ * contiguous. It holds two RGB888 frames at panel resolution, enough for the source and
+ * destination of any resize or rotation. Requires board_hal_init().
+ *
+ * Pipeline buffers are bump-allocated from the arena, which rewinds as soon as every buffer in it
+ * has been released, i.e. between runs. Unlike heap_caps_malloc() and heap_caps_free() of
+ * megabyte buffers run after run, this cannot fragment PSRAM.
+ *
+ * The arena serves one run at a time: the task that makes the first allocation owns it until
+ * all of its buffers are released. Runs on other tasks meanwhile get heap buffers, so they can't
+ * keep the arena from rewinding. A buffer kept for a queued display job keeps its run going.
+ *
+ * @return ESP_ERR_NO_MEM if the arena can't be reserved; allocations then use the heap
+ */
+esp_err_t pipeline_arena_init(void);
+
+/**
+ * @brief Allocate a pipeline buffer
+ *
+ * Comes from the arena if it fits and the calling task owns the current run (or there is none),
+ * from PSRAM heap otherwise. Either way it is released with pipeline_arena_free(). Safe from
+ * any task.
+ *
+ * @return NULL if out of memory
+ */
+void *pipeline_arena_alloc(size_t size);
+
+void *pipeline_arena_calloc(size_t count, size_t size);
+
+/**
+ * @brief Release a buffer from pipeline_arena_alloc(); NULL is ignored
+ *
+ * Arena space is reused once the most recently allocated buffer or every buffer is released.
+ */
+void pipeline_arena_free(void *ptr);
+
+/**
+ * @brief Take over the run of another task, which handed its buffers to the caller
+ *
+ * Does nothing unless task `from` owns the current run. Lets e.g. a decoder task's output be
+ * processed in the same run by the task that receives it.
+ */
+void pipeline_arena_adopt(TaskHandle_t from);
+
+/**
+ * @brief Highest arena use so far in the calling task's run, 0 if it doesn't own the arena
+ */
+size_t pipeline_arena_run_peak(void);
+
+/**
+ * @brief Bytes the calling task's allocations have taken from the heap instead of the arena
+ *
+ * A running total since boot: profile a run by the difference between two readings.
+ */
+size_t pipeline_arena_task_fallback_bytes(void);
+
+/**
+ * @brief Size in bytes of one RGB888 frame at panel resolution
+ */
+size_t pipeline_arena_frame_size(void);
+
+#endif
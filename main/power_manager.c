@@ -17,6 +17,7 @@
 #include "config_manager.h"
 #include "ha_integration.h"
 #include "periodic_tasks.h"
+#include "timeline.h"
 #include "utils.h"
 
 // RTC memory to store expected wakeup time (persists across deep sleep)
@@ -75,8 +76,8 @@ static void rotation_timer_task(void *arg)
                     board_hal_is_usb_connected() ? "USB powered" : "deep sleep disabled";
                 ESP_LOGI(TAG, "Active rotation triggered (%s)", reason);
 
-                trigger_image_rotation();
-                ha_notify_update();
+                // Queued behind any display update in progress instead of racing it
+                queue_image_rotation(NULL);
 
                 // Schedule next rotation
                 int seconds_until_next = get_seconds_until_next_wakeup();
@@ -343,6 +344,7 @@ void power_manager_enter_sleep(void)
     board_hal_prepare_for_sleep();
 
     ESP_LOGI(TAG, "Entering deep sleep now");
+    timeline_commit();
     vTaskDelay(pdMS_TO_TICKS(100));
 
     esp_deep_sleep_start();
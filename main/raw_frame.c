@@ -0,0 +1,172 @@
+#include "raw_frame.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board_hal.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "rom/miniz.h"
+#include "testable_utils.h"
+
+static const char *TAG = "raw_frame";
+
+struct raw_frame_decoder {
+    uint8_t header_bytes[RAW_FRAME_HEADER_SIZE];
+    size_t header_len;
+    raw_frame_header_t header;
+
+    uint8_t *frame;
+    size_t frame_size;
+    size_t frame_pos;
+
+    tinfl_decompressor *inflator;  // only for compressed frames
+    tinfl_status inflate_status;
+};
+
+raw_frame_decoder_t *raw_frame_decoder_create(void)
+{
+    return calloc(1, sizeof(raw_frame_decoder_t));
+}
+
+static esp_err_t start_frame(raw_frame_decoder_t *decoder)
+{
+    if (!raw_frame_parse_header(decoder->header_bytes, RAW_FRAME_HEADER_SIZE, &decoder->header)) {
+        ESP_LOGE(TAG, "Invalid frame header");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Frames are in panel memory order, so they must match the native panel size exactly
+    if (decoder->header.width != BOARD_HAL_DISPLAY_WIDTH ||
+        decoder->header.height != BOARD_HAL_DISPLAY_HEIGHT) {
+        ESP_LOGE(TAG, "Frame is %ux%u, panel is %dx%d", decoder->header.width,
+                 decoder->header.height, BOARD_HAL_DISPLAY_WIDTH, BOARD_HAL_DISPLAY_HEIGHT);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    decoder->frame_size = raw_frame_size(decoder->header.width, decoder->header.height);
+    decoder->frame = heap_caps_malloc(decoder->frame_size, MALLOC_CAP_SPIRAM);
+    if (!decoder->frame) {
+        ESP_LOGE(TAG, "Failed to allocate %zu byte framebuffer", decoder->frame_size);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (decoder->header.flags & RAW_FRAME_FLAG_DEFLATE) {
+        decoder->inflator = malloc(sizeof(tinfl_decompressor));
+        if (!decoder->inflator) {
+            return ESP_ERR_NO_MEM;
+        }
+        tinfl_init(decoder->inflator);
+        decoder->inflate_status = TINFL_STATUS_NEEDS_MORE_INPUT;
+    }
+    return ESP_OK;
+}
+
+// The whole framebuffer is the output buffer, so tinfl can use it as its own dictionary and
+// no separate 32 KB window is needed
+static esp_err_t inflate_into_frame(raw_frame_decoder_t *decoder, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        if (decoder->inflate_status == TINFL_STATUS_DONE) {
+            ESP_LOGE(TAG, "Trailing data after compressed frame");
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        size_t in_bytes = len;
+        size_t out_bytes = decoder->frame_size - decoder->frame_pos;
+        decoder->inflate_status =
+            tinfl_decompress(decoder->inflator, data, &in_bytes, decoder->frame,
+                             decoder->frame + decoder->frame_pos, &out_bytes,
+                             TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT |
+                                 TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+        data += in_bytes;
+        len -= in_bytes;
+        decoder->frame_pos += out_bytes;
+
+        if (decoder->inflate_status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+            ESP_LOGE(TAG, "Compressed frame inflates past %zu bytes", decoder->frame_size);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (decoder->inflate_status < TINFL_STATUS_DONE) {
+            ESP_LOGE(TAG, "Corrupt compressed frame (status %d)", (int) decoder->inflate_status);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t raw_frame_decoder_feed(raw_frame_decoder_t *decoder, const uint8_t *data, size_t len)
+{
+    if (decoder->header_len < RAW_FRAME_HEADER_SIZE) {
+        size_t n = RAW_FRAME_HEADER_SIZE - decoder->header_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(decoder->header_bytes + decoder->header_len, data, n);
+        decoder->header_len += n;
+        data += n;
+        len -= n;
+
+        if (decoder->header_len < RAW_FRAME_HEADER_SIZE) {
+            return ESP_OK;
+        }
+        esp_err_t err = start_frame(decoder);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (len == 0) {
+        return ESP_OK;
+    }
+
+    if (decoder->inflator) {
+        return inflate_into_frame(decoder, data, len);
+    }
+
+    if (len > decoder->frame_size - decoder->frame_pos) {
+        ESP_LOGE(TAG, "Frame payload is larger than %zu bytes", decoder->frame_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(decoder->frame + decoder->frame_pos, data, len);
+    decoder->frame_pos += len;
+    return ESP_OK;
+}
+
+esp_err_t raw_frame_decoder_finish(raw_frame_decoder_t *decoder, uint8_t **frame)
+{
+    if (!decoder->frame || decoder->frame_pos != decoder->frame_size ||
+        (decoder->inflator && decoder->inflate_status != TINFL_STATUS_DONE)) {
+        ESP_LOGE(TAG, "Incomplete frame: %zu of %zu bytes", decoder->frame_pos,
+                 decoder->frame_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, decoder->frame, decoder->frame_size);
+    if (crc != decoder->header.crc32) {
+        ESP_LOGE(TAG, "Frame CRC mismatch: %08lx, header says %08lx", (unsigned long) crc,
+                 (unsigned long) decoder->header.crc32);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    if (!raw_frame_pixels_valid(decoder->frame, decoder->header.width, decoder->header.height)) {
+        ESP_LOGE(TAG, "Frame contains pixels outside the panel palette");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *frame = decoder->frame;
+    decoder->frame = NULL;
+    return ESP_OK;
+}
+
+void raw_frame_decoder_free(raw_frame_decoder_t *decoder)
+{
+    if (!decoder) {
+        return;
+    }
+    heap_caps_free(decoder->frame);
+    free(decoder->inflator);
+    free(decoder);
+}
@@ -0,0 +1,41 @@
+#ifndef RAW_FRAME_H
+#define RAW_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Content-Type of a packed panel frame (see raw_frame_header_t in testable_utils.h)
+#define RAW_FRAME_CONTENT_TYPE "application/vnd.photoframe.epd4"
+
+typedef struct raw_frame_decoder raw_frame_decoder_t;
+
+/**
+ * @brief Create a decoder for one packed panel frame
+ *
+ * The frame is fed in arbitrary pieces as it arrives and inflated (if compressed) straight into
+ * a panel-sized PSRAM framebuffer, so no copy of the encoded frame is ever kept.
+ */
+raw_frame_decoder_t *raw_frame_decoder_create(void);
+
+/**
+ * @brief Feed the next piece of the encoded frame
+ *
+ * @return ESP_ERR_INVALID_ARG if the header is invalid or does not match the panel,
+ *         ESP_ERR_INVALID_SIZE if the payload is larger than the frame,
+ *         ESP_ERR_NO_MEM if the framebuffer cannot be allocated
+ */
+esp_err_t raw_frame_decoder_feed(raw_frame_decoder_t *decoder, const uint8_t *data, size_t len);
+
+/**
+ * @brief Validate the complete frame and take its framebuffer
+ *
+ * Checks the length, CRC and that every pixel is a panel colour. On success *frame receives a
+ * buffer for display_manager_show_packed_frame().
+ */
+esp_err_t raw_frame_decoder_finish(raw_frame_decoder_t *decoder, uint8_t **frame);
+
+void raw_frame_decoder_free(raw_frame_decoder_t *decoder);
+
+#endif
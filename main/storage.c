@@ -87,9 +87,9 @@ esp_err_t storage_init(void)
     }
 #endif
 
-    // Final fallback to MemFS
+    // Final fallback to MemFS. Directories take entries too, so leave room for a small album
     ESP_LOGW(TAG, "No persistent storage available, mounting MemFS at %s", FS_MOUNT_POINT);
-    ret = memfs_mount(FS_MOUNT_POINT, 10);
+    ret = memfs_mount(FS_MOUNT_POINT, 64);
     if (ret == ESP_OK) {
         current_storage_type = STORAGE_TYPE_MEMFS;
     } else {
@@ -1,5 +1,10 @@
 #include "testable_utils.h"
 
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
 int calculate_next_wakeup_interval(const struct tm *timeinfo, int rotate_interval, bool aligned,
                                    const sleep_schedule_config_t *sleep_schedule)
 {
@@ -98,3 +103,390 @@ int calculate_next_wakeup_interval(const struct tm *timeinfo, int rotate_interva
 
     return seconds_until_wake;
 }
+
+// Round function for the Feistel network (murmur3 finalizer)
+static uint32_t shuffle_round(uint32_t value, uint32_t seed, int round)
+{
+    uint32_t h = value ^ seed ^ ((uint32_t) round * 0x9e3779b9u);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t shuffle_permute_index(uint32_t index, uint32_t count, uint32_t seed)
+{
+    if (count <= 1) {
+        return 0;
+    }
+
+    // Balanced Feistel network over the smallest even-bit power of two >= count. Values that
+    // land outside [0, count) are fed through again (cycle walking); since the domain is less
+    // than 4x count this takes few iterations and stays a bijection on [0, count).
+    int bits = 2;
+    while (bits < 32 && (1ull << bits) < count) {
+        bits += 2;
+    }
+    int half_bits = bits / 2;
+    uint32_t half_mask = (1u << half_bits) - 1;
+
+    uint32_t value = index % count;
+    do {
+        uint32_t left = value >> half_bits;
+        uint32_t right = value & half_mask;
+        for (int round = 0; round < 4; round++) {
+            uint32_t next = left ^ (shuffle_round(right, seed, round) & half_mask);
+            left = right;
+            right = next;
+        }
+        value = (left << half_bits) | right;
+    } while (value >= count);
+
+    return value;
+}
+
+static bool ascii_prefix_equal(const char *text, size_t len, const char *prefix)
+{
+    size_t prefix_len = strlen(prefix);
+    if (len < prefix_len) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix_len; i++) {
+        if (tolower((unsigned char) text[i]) != prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool multipart_get_boundary(const char *content_type, char *boundary, size_t size)
+{
+    if (!content_type || !boundary || size == 0) {
+        return false;
+    }
+
+    size_t len = strlen(content_type);
+    for (size_t i = 0; i < len; i++) {
+        // Only accept "boundary=" at the start of a parameter, not inside another value
+        if (i > 0 && content_type[i - 1] != ';' && content_type[i - 1] != ' ' &&
+            content_type[i - 1] != '\t') {
+            continue;
+        }
+        if (!ascii_prefix_equal(content_type + i, len - i, "boundary=")) {
+            continue;
+        }
+
+        const char *value = content_type + i + 9;
+        const char *end;
+        if (*value == '"') {
+            value++;
+            end = strchr(value, '"');
+            if (!end) {
+                return false;
+            }
+        } else {
+            end = value;
+            while (*end && *end != ';' && *end != ' ' && *end != '\t' && *end != '\r' &&
+                   *end != '\n') {
+                end++;
+            }
+        }
+
+        size_t value_len = end - value;
+        if (value_len == 0 || value_len > MULTIPART_BOUNDARY_MAX || value_len >= size) {
+            return false;
+        }
+        memcpy(boundary, value, value_len);
+        boundary[value_len] = '\0';
+        return true;
+    }
+    return false;
+}
+
+bool multipart_delimiter_init(multipart_delimiter_t *delimiter, const char *boundary)
+{
+    size_t boundary_len = boundary ? strlen(boundary) : 0;
+    if (boundary_len == 0 || boundary_len > MULTIPART_BOUNDARY_MAX) {
+        return false;
+    }
+
+    memcpy(delimiter->pattern, "\r\n--", 4);
+    memcpy(delimiter->pattern + 4, boundary, boundary_len);
+    delimiter->length = boundary_len + 4;
+
+    // Horspool: on a mismatch, shift so the byte under the window's last position lines up
+    // with its rightmost occurrence in the pattern (excluding the last pattern byte)
+    memset(delimiter->skip, (int) delimiter->length, sizeof(delimiter->skip));
+    for (size_t i = 0; i + 1 < delimiter->length; i++) {
+        delimiter->skip[delimiter->pattern[i]] = (uint8_t) (delimiter->length - 1 - i);
+    }
+    return true;
+}
+
+long multipart_delimiter_find(const multipart_delimiter_t *delimiter, const uint8_t *data,
+                              size_t len)
+{
+    size_t m = delimiter->length;
+    if (len < m) {
+        return -1;
+    }
+
+    const uint8_t last = delimiter->pattern[m - 1];
+    size_t pos = 0;
+    while (pos <= len - m) {
+        uint8_t c = data[pos + m - 1];
+        if (c == last && memcmp(data + pos, delimiter->pattern, m - 1) == 0) {
+            return (long) pos;
+        }
+        pos += delimiter->skip[c];
+    }
+    return -1;
+}
+
+// Copy a header parameter value, undoing quoted-string escapes; truncates to fit
+static const char *copy_param_value(const char *p, const char *end, char *out, size_t out_size)
+{
+    size_t n = 0;
+    if (p < end && *p == '"') {
+        p++;
+        while (p < end && *p != '"') {
+            if (*p == '\\' && p + 1 < end) {
+                p++;
+            }
+            if (out && n + 1 < out_size) {
+                out[n++] = *p;
+            }
+            p++;
+        }
+        if (p < end) {
+            p++;  // closing quote
+        }
+    } else {
+        while (p < end && *p != ';') {
+            if (out && n + 1 < out_size) {
+                out[n++] = *p;
+            }
+            p++;
+        }
+        while (out && n > 0 && (out[n - 1] == ' ' || out[n - 1] == '\t')) {
+            n--;
+        }
+    }
+    if (out && out_size > 0) {
+        out[n] = '\0';
+    }
+    return p;
+}
+
+bool multipart_parse_part_headers(const char *headers, size_t len, char *name, size_t name_size,
+                                  char *filename, size_t filename_size)
+{
+    if (name && name_size > 0) {
+        name[0] = '\0';
+    }
+    if (filename && filename_size > 0) {
+        filename[0] = '\0';
+    }
+
+    const char *line = headers;
+    const char *headers_end = headers + len;
+    while (line < headers_end) {
+        const char *line_end = line;
+        while (line_end < headers_end && *line_end != '\r' && *line_end != '\n') {
+            line_end++;
+        }
+
+        if (ascii_prefix_equal(line, line_end - line, "content-disposition:")) {
+            const char *p = line + 20;
+            while (p < line_end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+            if (!ascii_prefix_equal(p, line_end - p, "form-data")) {
+                return false;
+            }
+            p += 9;
+
+            while (p < line_end) {
+                while (p < line_end && (*p == ';' || *p == ' ' || *p == '\t')) {
+                    p++;
+                }
+                const char *key = p;
+                while (p < line_end && *p != '=' && *p != ';') {
+                    p++;
+                }
+                const char *key_end = p;
+                while (key_end > key && (key_end[-1] == ' ' || key_end[-1] == '\t')) {
+                    key_end--;
+                }
+                if (p >= line_end || *p != '=') {
+                    continue;  // parameter without a value
+                }
+                p++;
+                while (p < line_end && (*p == ' ' || *p == '\t')) {
+                    p++;
+                }
+
+                size_t key_len = key_end - key;
+                if (key_len == 4 && ascii_prefix_equal(key, key_len, "name")) {
+                    p = copy_param_value(p, line_end, name, name_size);
+                } else if (key_len == 8 && ascii_prefix_equal(key, key_len, "filename")) {
+                    p = copy_param_value(p, line_end, filename, filename_size);
+                } else {
+                    p = copy_param_value(p, line_end, NULL, 0);
+                }
+            }
+            return true;
+        }
+
+        line = line_end;
+        while (line < headers_end && (*line == '\r' || *line == '\n')) {
+            line++;
+        }
+    }
+    return false;
+}
+
+static uint16_t read_le16(const uint8_t *p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+bool raw_frame_parse_header(const uint8_t *data, size_t len, raw_frame_header_t *header)
+{
+    if (!data || !header || len < RAW_FRAME_HEADER_SIZE) {
+        return false;
+    }
+    if (memcmp(data, "EPD4", 4) != 0 || data[4] != RAW_FRAME_VERSION) {
+        return false;
+    }
+    if ((data[5] & ~RAW_FRAME_FLAG_DEFLATE) != 0 || data[6] != 0 || data[7] != 0) {
+        return false;
+    }
+
+    header->flags = data[5];
+    header->width = read_le16(data + 8);
+    header->height = read_le16(data + 10);
+    header->crc32 = (uint32_t) read_le16(data + 12) | ((uint32_t) read_le16(data + 14) << 16);
+    return header->width > 0 && header->height > 0;
+}
+
+void raw_frame_build_header(uint8_t *out, uint16_t width, uint16_t height, uint8_t flags,
+                            uint32_t crc32)
+{
+    memcpy(out, "EPD4", 4);
+    out[4] = RAW_FRAME_VERSION;
+    out[5] = flags;
+    out[6] = 0;
+    out[7] = 0;
+    out[8] = width & 0xff;
+    out[9] = width >> 8;
+    out[10] = height & 0xff;
+    out[11] = height >> 8;
+    for (int i = 0; i < 4; i++) {
+        out[12 + i] = (crc32 >> (8 * i)) & 0xff;
+    }
+}
+
+size_t raw_frame_size(uint16_t width, uint16_t height)
+{
+    return (size_t) ((width + 1) / 2) * height;
+}
+
+static bool panel_color_valid(uint8_t index)
+{
+    // 0x4 is unused by the panel, 0x7 and up do not exist
+    return index <= 0x6 && index != 0x4;
+}
+
+bool raw_frame_pixels_valid(const uint8_t *frame, uint16_t width, uint16_t height)
+{
+    size_t stride = (width + 1) / 2;
+    for (uint16_t y = 0; y < height; y++) {
+        const uint8_t *row = frame + (size_t) y * stride;
+        for (uint16_t x = 0; x < width; x += 2) {
+            uint8_t byte = row[x / 2];
+            if (!panel_color_valid(byte >> 4)) {
+                return false;
+            }
+            if (x + 1 < width && !panel_color_valid(byte & 0x0f)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    bool https;
+    const char *host;
+    size_t host_len;
+    long port;
+} url_origin_t;
+
+static bool url_parse_origin(const char *url, url_origin_t *origin)
+{
+    if (strncasecmp(url, "http://", 7) == 0) {
+        origin->https = false;
+        url += 7;
+    } else if (strncasecmp(url, "https://", 8) == 0) {
+        origin->https = true;
+        url += 8;
+    } else {
+        return false;
+    }
+
+    size_t authority_len = strcspn(url, "/?#");
+    const char *end = url + authority_len;
+    for (const char *p = url; p < end; p++) {
+        if (*p == '@') {
+            url = p + 1;
+        }
+    }
+
+    const char *port = NULL;
+    if (*url == '[') {
+        // IPv6 literal: the port separator follows the closing bracket
+        const char *close = memchr(url, ']', end - url);
+        if (!close) {
+            return false;
+        }
+        origin->host = url;
+        origin->host_len = close + 1 - url;
+        if (close + 1 < end && close[1] == ':') {
+            port = close + 2;
+        }
+    } else {
+        const char *colon = memchr(url, ':', end - url);
+        origin->host = url;
+        origin->host_len = (colon ? colon : end) - url;
+        if (colon) {
+            port = colon + 1;
+        }
+    }
+    if (origin->host_len == 0) {
+        return false;
+    }
+
+    origin->port = origin->https ? 443 : 80;
+    if (port && port < end) {
+        char *port_end;
+        origin->port = strtol(port, &port_end, 10);
+        if (port_end != end || origin->port <= 0 || origin->port > 65535) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool url_same_origin(const char *a, const char *b)
+{
+    url_origin_t origin_a, origin_b;
+    if (!a || !b || !url_parse_origin(a, &origin_a) || !url_parse_origin(b, &origin_b)) {
+        return false;
+    }
+    return origin_a.https == origin_b.https && origin_a.port == origin_b.port &&
+           origin_a.host_len == origin_b.host_len &&
+           strncasecmp(origin_a.host, origin_b.host, origin_a.host_len) == 0;
+}
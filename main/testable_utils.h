@@ -2,6 +2,8 @@
 #define TESTABLE_UTILS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 typedef struct {
@@ -10,6 +12,18 @@ typedef struct {
     int end_minutes;    // Minutes since midnight
 } sleep_schedule_config_t;
 
+// RFC 2046 caps boundaries at 70 characters; the delimiter adds CRLF and "--"
+#define MULTIPART_BOUNDARY_MAX 70
+#define MULTIPART_DELIMITER_MAX (MULTIPART_BOUNDARY_MAX + 4)
+
+// Precomputed Boyer-Moore-Horspool search for the "\r\n--boundary" delimiter of a
+// multipart body
+typedef struct {
+    uint8_t pattern[MULTIPART_DELIMITER_MAX];
+    size_t length;
+    uint8_t skip[256];  // shift for each byte value when the window does not match
+} multipart_delimiter_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -24,6 +38,66 @@ extern "C" {
 int calculate_next_wakeup_interval(const struct tm *timeinfo, int rotate_interval, bool aligned,
                                    const sleep_schedule_config_t *sleep_schedule);
 
+// Map position `index` of a shuffled sequence to an item in [0, count)
+// For a fixed seed this is a bijection on [0, count): walking index 0..count-1 visits every
+// item exactly once, in an order that depends on the seed. Needs O(1) memory, so only the seed
+// and the current position have to be kept across deep sleep.
+uint32_t shuffle_permute_index(uint32_t index, uint32_t count, uint32_t seed);
+
+// Extract the boundary parameter (quoted or bare) from a multipart Content-Type header value
+// Returns false if there is none or it does not fit in `size` / MULTIPART_BOUNDARY_MAX.
+bool multipart_get_boundary(const char *content_type, char *boundary, size_t size);
+
+// Build the delimiter "\r\n--<boundary>" and its skip table
+bool multipart_delimiter_init(multipart_delimiter_t *delimiter, const char *boundary);
+
+// Offset of the first delimiter in data[0, len), or -1 if it does not occur there
+long multipart_delimiter_find(const multipart_delimiter_t *delimiter, const uint8_t *data,
+                              size_t len);
+
+// Parse the header block of one multipart/form-data part (without the blank line that ends it)
+// Fills `name` and `filename` from Content-Disposition; header names are matched without regard
+// to case and parameter values may be quoted or bare. Missing values are returned as "".
+// Returns false if the part has no form-data Content-Disposition.
+bool multipart_parse_part_headers(const char *headers, size_t len, char *name, size_t name_size,
+                                  char *filename, size_t filename_size);
+
+// Packed panel frame (/api/display-raw, URL rotation): a RAW_FRAME_HEADER_SIZE header followed
+// by the panel framebuffer, optionally zlib-compressed. Header layout, little endian:
+//   0  "EPD4"   4  version (1)   5  flags   6  reserved (0, 2 bytes)
+//   8  width    10 height        12 CRC-32 of the uncompressed framebuffer
+// Each framebuffer row is (width + 1) / 2 bytes, two pixels per byte with the left pixel in the
+// high nibble, using the panel colour indices (EPD_7IN3E_*).
+#define RAW_FRAME_HEADER_SIZE 16
+#define RAW_FRAME_VERSION 1
+#define RAW_FRAME_FLAG_DEFLATE 0x01
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t flags;
+    uint32_t crc32;
+} raw_frame_header_t;
+
+// Parse and sanity-check a frame header. Returns false on a bad magic, version or flags.
+bool raw_frame_parse_header(const uint8_t *data, size_t len, raw_frame_header_t *header);
+
+// Write a RAW_FRAME_HEADER_SIZE header for a frame into out
+void raw_frame_build_header(uint8_t *out, uint16_t width, uint16_t height, uint8_t flags,
+                            uint32_t crc32);
+
+// Size in bytes of the uncompressed framebuffer for the given dimensions
+size_t raw_frame_size(uint16_t width, uint16_t height);
+
+// Check that every pixel is one of the six panel colours (the padding nibble of odd-width rows
+// is ignored)
+bool raw_frame_pixels_valid(const uint8_t *frame, uint16_t width, uint16_t height);
+
+// True if two absolute http(s) URLs share scheme, host and port, so a request to one can reuse a
+// kept-alive connection to the other. Hosts compare without regard to case and a missing port
+// is the scheme's default. Userinfo, path, query and fragment are ignored.
+bool url_same_origin(const char *a, const char *b);
+
 #ifdef __cplusplus
 }
 #endif
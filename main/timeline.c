@@ -0,0 +1,214 @@
+#include "timeline.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "power_manager.h"
+
+#define TIMELINE_HISTORY 8
+// Stored next to the history so a firmware update does not misread what the previous one left
+// in RTC memory. The phase count and history length are covered here; reordered phases and
+// record changes rely on TIMELINE_LAYOUT_VERSION being bumped.
+#define TIMELINE_LAYOUT \
+    (((uint32_t) TIMELINE_LAYOUT_VERSION << 16) | (TIMELINE_PHASE_COUNT << 8) | TIMELINE_HISTORY)
+
+static const char *phase_names[TIMELINE_PHASE_COUNT] = {
+    [TIMELINE_BOARD_INIT] = "board_init",
+    [TIMELINE_STORAGE_INIT] = "storage_init",
+    [TIMELINE_SYSTEM_INIT] = "system_init",
+    [TIMELINE_WIFI_CONNECT] = "wifi_connect",
+    [TIMELINE_PERIODIC_TASKS] = "periodic_tasks",
+    [TIMELINE_DOWNLOAD] = "download",
+    [TIMELINE_PROCESSING] = "processing",
+    [TIMELINE_DISPLAY] = "epaper_display",
+    [TIMELINE_HA_NOTIFY] = "ha_notify",
+};
+
+typedef struct {
+    uint32_t start_ms;  // Since boot, of the first begin
+    uint32_t duration_ms;
+} timeline_span_t;
+
+typedef struct {
+    uint32_t ended_at;  // Unix time the wake ended, 0 if the clock was not set
+    uint32_t awake_ms;
+    uint16_t ran;  // Bit per phase that was begun
+    uint8_t wakeup_source;
+    timeline_span_t phases[TIMELINE_PHASE_COUNT];
+} timeline_record_t;
+
+_Static_assert(TIMELINE_PHASE_COUNT <= 16, "timeline_record_t.ran needs to be widened");
+
+RTC_DATA_ATTR static uint32_t history_layout;
+RTC_DATA_ATTR static uint8_t history_next;
+RTC_DATA_ATTR static uint8_t history_count;
+RTC_DATA_ATTR static timeline_record_t history[TIMELINE_HISTORY];
+
+static timeline_record_t current;
+static int64_t open_since[TIMELINE_PHASE_COUNT];
+static uint8_t open_depth[TIMELINE_PHASE_COUNT];
+static portMUX_TYPE timeline_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void timeline_begin(timeline_phase_t phase)
+{
+    if (phase >= TIMELINE_PHASE_COUNT) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&timeline_lock);
+    if (open_depth[phase]++ == 0) {
+        open_since[phase] = now;
+        if (!(current.ran & (1u << phase))) {
+            current.ran |= 1u << phase;
+            current.phases[phase].start_ms = (uint32_t) (now / 1000);
+        }
+    }
+    portEXIT_CRITICAL(&timeline_lock);
+}
+
+void timeline_end(timeline_phase_t phase)
+{
+    if (phase >= TIMELINE_PHASE_COUNT) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&timeline_lock);
+    if (open_depth[phase] > 0 && --open_depth[phase] == 0) {
+        current.phases[phase].duration_ms += (uint32_t) ((now - open_since[phase]) / 1000);
+    }
+    portEXIT_CRITICAL(&timeline_lock);
+}
+
+void timeline_set_wakeup_source(int wakeup_source)
+{
+    current.wakeup_source = (uint8_t) wakeup_source;
+}
+
+// Copy of the current record with phases still open counted up to now
+static void timeline_snapshot(timeline_record_t *record)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&timeline_lock);
+    *record = current;
+    for (int i = 0; i < TIMELINE_PHASE_COUNT; i++) {
+        if (open_depth[i] > 0) {
+            record->phases[i].duration_ms += (uint32_t) ((now - open_since[i]) / 1000);
+        }
+    }
+    portEXIT_CRITICAL(&timeline_lock);
+
+    record->awake_ms = (uint32_t) (now / 1000);
+    time_t wall = time(NULL);
+    // Before the clock is set, time() counts from 1970
+    record->ended_at = wall > 1700000000 ? (uint32_t) wall : 0;
+}
+
+void timeline_commit(void)
+{
+    if (history_layout != TIMELINE_LAYOUT) {
+        history_layout = TIMELINE_LAYOUT;
+        history_next = 0;
+        history_count = 0;
+    }
+
+    timeline_snapshot(&history[history_next]);
+    history_next = (history_next + 1) % TIMELINE_HISTORY;
+    if (history_count < TIMELINE_HISTORY) {
+        history_count++;
+    }
+}
+
+static const char *wakeup_source_name(uint8_t source)
+{
+    switch (source) {
+    case WAKEUP_SOURCE_TIMER:
+        return "timer";
+    case WAKEUP_SOURCE_BOOT_BUTTON:
+        return "boot_button";
+    case WAKEUP_SOURCE_ROTATE_BUTTON:
+        return "rotate_button";
+    case WAKEUP_SOURCE_CLEAR_BUTTON:
+        return "clear_button";
+    case WAKEUP_SOURCE_EXT1_UNKNOWN:
+        return "ext1";
+    default:
+        return "boot";
+    }
+}
+
+// ended is false for the wake in progress
+static cJSON *timeline_record_to_json(const timeline_record_t *record, bool ended)
+{
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return NULL;
+    }
+
+    cJSON_AddStringToObject(json, "wakeup", wakeup_source_name(record->wakeup_source));
+    if (ended && record->ended_at == 0) {
+        cJSON_AddNullToObject(json, "ended_at");
+    } else if (ended) {
+        cJSON_AddNumberToObject(json, "ended_at", record->ended_at);
+    }
+    cJSON_AddNumberToObject(json, "awake_ms", record->awake_ms);
+
+    // In the order they started
+    cJSON *phases = cJSON_AddArrayToObject(json, "phases");
+    uint16_t pending = record->ran;
+    while (phases && pending) {
+        int first = -1;
+        for (int i = 0; i < TIMELINE_PHASE_COUNT; i++) {
+            if ((pending & (1u << i)) &&
+                (first < 0 || record->phases[i].start_ms < record->phases[first].start_ms)) {
+                first = i;
+            }
+        }
+        pending &= ~(1u << first);
+
+        cJSON *phase = cJSON_CreateObject();
+        if (!phase) {
+            break;
+        }
+        cJSON_AddStringToObject(phase, "name", phase_names[first]);
+        cJSON_AddNumberToObject(phase, "start_ms", record->phases[first].start_ms);
+        cJSON_AddNumberToObject(phase, "duration_ms", record->phases[first].duration_ms);
+        cJSON_AddItemToArray(phases, phase);
+    }
+
+    return json;
+}
+
+cJSON *timeline_to_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return NULL;
+    }
+
+    timeline_record_t record;
+    timeline_snapshot(&record);
+    cJSON *current_json = timeline_record_to_json(&record, false);
+    if (current_json) {
+        cJSON_AddItemToObject(json, "current", current_json);
+    }
+
+    cJSON *history_json = cJSON_AddArrayToObject(json, "history");
+    if (history_json && history_layout == TIMELINE_LAYOUT) {
+        for (int i = 1; i <= history_count; i++) {
+            int index = (history_next + TIMELINE_HISTORY - i) % TIMELINE_HISTORY;
+            cJSON *entry = timeline_record_to_json(&history[index], true);
+            if (entry) {
+                cJSON_AddItemToArray(history_json, entry);
+            }
+        }
+    }
+
+    return json;
+}
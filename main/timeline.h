@@ -0,0 +1,52 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "cJSON.h"
+
+// Bump when reordering or removing phases below, or when changing the record layout in
+// timeline.c. The history kept in RTC memory is then discarded on the next update instead of
+// being misread; appending a phase is detected on its own and needs no bump.
+#define TIMELINE_LAYOUT_VERSION 1
+
+// Phases of a boot or wake
+typedef enum {
+    TIMELINE_BOARD_INIT,      // board_hal_init()
+    TIMELINE_STORAGE_INIT,    // storage_init()
+    TIMELINE_SYSTEM_INIT,     // RTC, power rails, NVS, config and manager init
+    TIMELINE_WIFI_CONNECT,    // Wi-Fi init and connect
+    TIMELINE_PERIODIC_TASKS,  // periodic_tasks_check_and_run()
+    TIMELINE_DOWNLOAD,        // URL rotation image and thumbnail downloads
+    TIMELINE_PROCESSING,      // Decode, resize and dither
+    TIMELINE_DISPLAY,         // epaper_display()
+    TIMELINE_HA_NOTIFY,       // ha_notify_*()
+    TIMELINE_PHASE_COUNT
+} timeline_phase_t;
+
+/**
+ * @brief Mark the start of a phase
+ *
+ * Calls may nest and may come from several tasks; a phase's duration is the time during which
+ * at least one begin is unmatched. The first begin of a wake sets the phase's start offset.
+ */
+void timeline_begin(timeline_phase_t phase);
+
+void timeline_end(timeline_phase_t phase);
+
+/**
+ * @brief Record what woke the device (a wakeup_source_t) for the current timeline
+ */
+void timeline_set_wakeup_source(int wakeup_source);
+
+/**
+ * @brief Close the current wake and store it in the RTC-memory history
+ *
+ * Called right before deep sleep. Frames that never sleep only ever have a current timeline.
+ */
+void timeline_commit(void);
+
+/**
+ * @brief The current wake and the stored history (newest first) as JSON
+ */
+cJSON *timeline_to_json(void);
+
+#endif
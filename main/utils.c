@@ -1,35 +1,143 @@
 #include "utils.h"
 
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "album_manager.h"
 #include "board_hal.h"
 #include "cJSON.h"
 #include "color_palette.h"
 #include "config.h"
 #include "config_manager.h"
 #include "display_manager.h"
+#include "esp_attr.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
 #include "esp_mac.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ha_integration.h"
 #include "image_processor.h"
+#include "memfs.h"
+#include "metrics.h"
+#include "pipeline_arena.h"
 #include "processing_settings.h"
+#include "raw_frame.h"
 #include "storage.h"
 #include "testable_utils.h"
+#include "timeline.h"
 
 static const char *TAG = "utils";
 
+#define URL_CACHE_ETAG_MAX 96
+#define URL_CACHE_LAST_MODIFIED_MAX 40
+#define THUMBNAIL_TASK_STACK 8192
+
+// What the last image shown by URL rotation was fetched with, kept across deep sleep so the
+// next wake can ask the server whether anything changed. request_key covers the URL and every
+// request header that affects the result; panel_digest ties the entry to the frame it produced,
+// so it is ignored once something else has been displayed.
+typedef struct {
+    bool valid;
+    uint32_t request_key;
+    uint32_t body_digest;
+    uint32_t panel_digest;
+    char etag[URL_CACHE_ETAG_MAX];
+    char last_modified[URL_CACHE_LAST_MODIFIED_MAX];
+} url_cache_t;
+
+RTC_DATA_ATTR static url_cache_t url_cache;
+// Filled by a download, committed by trigger_image_rotation() once the image is on the panel
+static url_cache_t url_cache_pending;
+
 // Context for HTTP event handler
 typedef struct {
+    const char *file_path;  // Where the body is stored; opened when the first bytes arrive
     FILE *file;
+    bool body_started;
+    bool stream_decode;     // Decode JPEG/PNG bodies as they arrive instead of storing them
+    image_format_t format;  // Sniffed from the first bytes when stream decoding
+    image_stream_decoder_t *decoder;
+    esp_err_t decoder_err;
+    int content_length;  // Of the final response, -1 if unknown
     int total_read;
     char *content_type;
     char *thumbnail_url;  // Optional thumbnail URL from X-Thumbnail-URL header
+    bool accept_raw_frame;
+    raw_frame_decoder_t *raw_frame;  // Set when the server sent a packed panel frame
+    esp_err_t raw_frame_err;
+    uint32_t body_digest;  // CRC-32 of the body so far
+    char etag[URL_CACHE_ETAG_MAX];
+    char last_modified[URL_CACHE_LAST_MODIFIED_MAX];
 } download_context_t;
 
+// True if url_cache describes the image on the panel and was fetched with request_key. Never
+// true while the overlay shows the time or battery, which must be re-rendered.
+static bool url_cache_matches(uint32_t request_key)
+{
+    uint32_t panel_digest;
+    return url_cache.valid && url_cache.request_key == request_key &&
+           display_manager_get_panel_digest(&panel_digest) &&
+           panel_digest == url_cache.panel_digest && !display_manager_overlay_has_placeholders();
+}
+
+static void url_cache_commit(void)
+{
+    if (!url_cache_pending.valid ||
+        !display_manager_get_panel_digest(&url_cache_pending.panel_digest)) {
+        return;
+    }
+    url_cache = url_cache_pending;
+    url_cache_pending.valid = false;
+}
+
+// Decide where a body goes from its first bytes: into a stream decoder when allowed, so it is
+// decoded while the rest downloads, otherwise into ctx->file_path
+static void http_begin_body(download_context_t *ctx, esp_http_client_handle_t client,
+                            const uint8_t *data, int len)
+{
+    ctx->body_started = true;
+    // Read from the final response, a redirect may have announced a different length
+    ctx->content_length = (int) esp_http_client_get_content_length(client);
+
+    if (ctx->stream_decode) {
+        image_format_t format = image_processor_detect_format_buffer(data, len);
+        // JPEG is collected whole before it is decoded, which needs its size up front
+        if (format == IMAGE_FORMAT_PNG || (format == IMAGE_FORMAT_JPG && ctx->content_length > 0)) {
+            ctx->decoder = image_processor_stream_decoder_start(format, ctx->content_length);
+            if (ctx->decoder) {
+                ctx->format = format;
+                ESP_LOGI(TAG, "Decoding %s while downloading",
+                         format == IMAGE_FORMAT_PNG ? "PNG" : "JPEG");
+            }
+        }
+    }
+
+    // A streamed JPEG is still written out when it has to serve as its own thumbnail
+    bool store = !ctx->decoder || (ctx->format == IMAGE_FORMAT_JPG && ctx->thumbnail_url &&
+                                   ctx->thumbnail_url[0] == '\0');
+    if (!store || !ctx->file_path) {
+        return;
+    }
+    ctx->file = fopen(ctx->file_path, "wb");
+    if (!ctx->file) {
+        ESP_LOGE(TAG, "Failed to open file for writing: %s", ctx->file_path);
+        return;
+    }
+    // Size the RAM file once instead of growing it while the body arrives
+    if (ctx->content_length > 0 && storage_get_type() == STORAGE_TYPE_MEMFS &&
+        fcntl(fileno(ctx->file), MEMFS_F_PREALLOCATE, ctx->content_length) != 0) {
+        ESP_LOGW(TAG, "Could not preallocate %d bytes for download", ctx->content_length);
+    }
+}
+
 // HTTP event handler to write data to file
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
@@ -37,14 +145,59 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 
     switch (evt->event_id) {
     case HTTP_EVENT_ON_DATA:
+        // Only the final response's body is the image, not that of a redirect or an error
+        if (esp_http_client_get_status_code(evt->client) != 200) {
+            break;
+        }
+        ctx->body_digest = esp_rom_crc32_le(ctx->body_digest, evt->data, evt->data_len);
+        if (ctx->raw_frame) {
+            // Packed frames are unpacked as they arrive instead of going through a file
+            if (ctx->raw_frame_err == ESP_OK) {
+                ctx->raw_frame_err =
+                    raw_frame_decoder_feed(ctx->raw_frame, evt->data, evt->data_len);
+            }
+            ctx->total_read += evt->data_len;
+            break;
+        }
+        if (!ctx->body_started) {
+            http_begin_body(ctx, evt->client, evt->data, evt->data_len);
+        }
+        if (ctx->decoder && ctx->decoder_err == ESP_OK) {
+            ctx->decoder_err =
+                image_processor_stream_decoder_feed(ctx->decoder, evt->data, evt->data_len);
+        }
         if (ctx->file) {
             fwrite(evt->data, 1, evt->data_len, ctx->file);
+            metrics_add(METRICS_STORAGE_BYTES_WRITTEN, evt->data_len);
+        }
+        if (ctx->decoder || ctx->file) {
             ctx->total_read += evt->data_len;
         }
         break;
     case HTTP_EVENT_ON_HEADER:
         if (strcasecmp(evt->header_key, "Content-Type") == 0) {
             snprintf(ctx->content_type, 128, "%s", evt->header_value);
+            raw_frame_decoder_free(ctx->raw_frame);
+            ctx->raw_frame = NULL;
+            ctx->raw_frame_err = ESP_OK;
+            if (ctx->accept_raw_frame &&
+                strncasecmp(evt->header_value, RAW_FRAME_CONTENT_TYPE,
+                            strlen(RAW_FRAME_CONTENT_TYPE)) == 0) {
+                ctx->raw_frame = raw_frame_decoder_create();
+                if (!ctx->raw_frame) {
+                    ESP_LOGE(TAG, "Failed to allocate raw frame decoder");
+                    return ESP_ERR_NO_MEM;
+                }
+            }
+        } else if (strcasecmp(evt->header_key, "ETag") == 0) {
+            // Too long to keep means no conditional request next time, not a truncated tag
+            if (strlen(evt->header_value) < sizeof(ctx->etag)) {
+                strlcpy(ctx->etag, evt->header_value, sizeof(ctx->etag));
+            }
+        } else if (strcasecmp(evt->header_key, "Last-Modified") == 0) {
+            if (strlen(evt->header_value) < sizeof(ctx->last_modified)) {
+                strlcpy(ctx->last_modified, evt->header_value, sizeof(ctx->last_modified));
+            }
         } else if (strcasecmp(evt->header_key, "X-Thumbnail-URL") == 0) {
             // Capture thumbnail URL if provided by server (case-insensitive)
             if (ctx->thumbnail_url && strlen(evt->header_value) > 0) {
@@ -60,12 +213,258 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
-esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path, size_t path_size)
+// Validate a packed panel frame received by http_event_handler and display it, or hand it to
+// the caller through frame_out if given. Frees the decoder.
+static esp_err_t show_downloaded_raw_frame(raw_frame_decoder_t *decoder, esp_err_t feed_err,
+                                           uint8_t **frame_out)
+{
+    uint8_t *frame = NULL;
+    esp_err_t err = feed_err;
+    if (err == ESP_OK) {
+        err = raw_frame_decoder_finish(decoder, &frame);
+    }
+    raw_frame_decoder_free(decoder);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid packed frame from server: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (frame_out) {
+        *frame_out = frame;
+        return ESP_OK;
+    }
+
+    err = display_manager_show_packed_frame(&frame, false);
+    heap_caps_free(frame);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to display packed frame");
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Packed frame displayed");
+    return ESP_OK;
+}
+
+// Wait for an image decoded while it downloaded, then process it unless it already is, and
+// display it
+static esp_err_t show_downloaded_stream(image_stream_decoder_t *decoder, esp_err_t feed_err,
+                                        image_format_t format, image_profile_t *profile)
+{
+    image_process_rgb_result_t decoded;
+    esp_err_t err = feed_err;
+    if (err == ESP_OK) {
+        err = image_processor_stream_decoder_finish(decoder, &decoded, profile);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to decode downloaded image: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t *rgb_data = decoded.rgb_data;
+    int width = decoded.width;
+    int height = decoded.height;
+    if (format == IMAGE_FORMAT_PNG && image_processor_is_processed_rgb(rgb_data, width, height)) {
+        ESP_LOGI(TAG, "Image already processed, skipping processing");
+    } else {
+        image_process_rgb_result_t result;
+        err = image_processor_process_rgb(rgb_data, width, height,
+                                          processing_settings_get_dithering_algorithm(), &result,
+                                          profile);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
+            return err;
+        }
+        rgb_data = result.rgb_data;
+        width = result.width;
+        height = result.height;
+    }
+
+    err = display_manager_show_rgb_buffer(rgb_data, width, height, false);
+    pipeline_arena_free(rgb_data);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to display image");
+        return err;
+    }
+    image_processor_profile_add_stage(profile, IMAGE_STAGE_PAINT,
+                                      display_manager_get_last_paint_us());
+
+    ESP_LOGI(TAG, "Image displayed from download stream");
+    return ESP_OK;
+}
+
+// Download a thumbnail to path. client is the main download's connection when it can be
+// reused, and is cleaned up here; otherwise a new connection is opened.
+static bool download_thumbnail(esp_http_client_handle_t client, const char *url, const char *path)
+{
+    char thumb_content_type[128] = {0};
+    download_context_t thumb_ctx = {.file_path = path,
+                                    .total_read = 0,
+                                    .content_type = thumb_content_type,
+                                    .thumbnail_url = NULL};
+
+    if (client) {
+        // The conditional and processing headers of the image request do not apply here
+        esp_http_client_delete_header(client, "Accept");
+        esp_http_client_delete_header(client, "If-None-Match");
+        esp_http_client_delete_header(client, "If-Modified-Since");
+        esp_http_client_delete_header(client, "X-Processing-Settings");
+        esp_http_client_delete_header(client, "X-Color-Palette");
+        esp_http_client_set_user_data(client, &thumb_ctx);
+        esp_http_client_set_timeout_ms(client, 30000);
+        if (esp_http_client_set_url(client, url) != ESP_OK) {
+            esp_http_client_cleanup(client);
+            client = NULL;
+        }
+    }
+    if (!client) {
+        esp_http_client_config_t thumb_config = {
+            .url = url,
+            .timeout_ms = 30000,
+            .event_handler = http_event_handler,
+            .user_data = &thumb_ctx,
+            .max_redirection_count = 5,
+            .user_agent = "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36",
+        };
+        client = esp_http_client_init(&thumb_config);
+        if (!client) {
+            return false;
+        }
+    }
+
+    timeline_begin(TIMELINE_DOWNLOAD);
+    esp_err_t thumb_err = esp_http_client_perform(client);
+    timeline_end(TIMELINE_DOWNLOAD);
+    int thumb_status = esp_http_client_get_status_code(client);
+
+    if (thumb_ctx.file) {
+        fclose(thumb_ctx.file);
+    }
+    esp_http_client_cleanup(client);
+
+    if (thumb_err == ESP_OK && thumb_status == 200 && thumb_ctx.total_read > 0) {
+        ESP_LOGI(TAG, "Thumbnail downloaded successfully: %d bytes", thumb_ctx.total_read);
+        return true;
+    }
+    ESP_LOGW(TAG, "Failed to download thumbnail (status: %d)", thumb_status);
+    unlink(path);
+    return false;
+}
+
+// Thumbnail download running on its own task while the image is processed and displayed
+typedef struct {
+    char *url;
+    const char *path;
+    esp_http_client_handle_t client;
+    SemaphoreHandle_t done;
+    bool joined;
+    bool downloaded;
+} thumbnail_fetch_t;
+
+static void thumbnail_fetch_task(void *arg)
+{
+    thumbnail_fetch_t *fetch = (thumbnail_fetch_t *) arg;
+    fetch->downloaded = download_thumbnail(fetch->client, fetch->url, fetch->path);
+    xSemaphoreGive(fetch->done);
+    vTaskDelete(NULL);
+}
+
+// Start downloading a thumbnail, taking over client (may be NULL). Falls back to downloading it
+// right away if no task can be started.
+static thumbnail_fetch_t *thumbnail_fetch_start(const char *url, const char *path,
+                                                esp_http_client_handle_t client)
+{
+    thumbnail_fetch_t *fetch = calloc(1, sizeof(*fetch));
+    if (!fetch) {
+        if (client) {
+            esp_http_client_cleanup(client);
+        }
+        return NULL;
+    }
+    fetch->url = strdup(url);
+    fetch->path = path;
+    fetch->client = client;
+    fetch->done = xSemaphoreCreateBinary();
+
+    if (!fetch->url || !fetch->done ||
+        xTaskCreate(thumbnail_fetch_task, "thumb_fetch", THUMBNAIL_TASK_STACK, fetch, 5, NULL) !=
+            pdPASS) {
+        ESP_LOGW(TAG, "Could not start thumbnail task, downloading it first");
+        fetch->downloaded = download_thumbnail(client, url, path);
+        fetch->joined = true;
+    }
+    return fetch;
+}
+
+// Wait for the thumbnail and return whether it was downloaded. NULL means none was requested.
+static bool thumbnail_fetch_wait(thumbnail_fetch_t *fetch)
+{
+    if (!fetch) {
+        return false;
+    }
+    if (!fetch->joined) {
+        xSemaphoreTake(fetch->done, portMAX_DELAY);
+        fetch->joined = true;
+    }
+    return fetch->downloaded;
+}
+
+static void thumbnail_fetch_free(thumbnail_fetch_t *fetch)
+{
+    if (!fetch) {
+        return;
+    }
+    thumbnail_fetch_wait(fetch);
+    if (fetch->done) {
+        vSemaphoreDelete(fetch->done);
+    }
+    free(fetch->url);
+    free(fetch);
+}
+
+// What is left of a download once its image was rendered: nothing in here may delay the panel
+// refresh, so it is only finished after the image was shown (or failed to be)
+typedef struct {
+    thumbnail_fetch_t *thumb;
+    bool original_is_jpeg;  // CURRENT_UPLOAD_PATH still holds the download as a thumbnail candidate
+} download_followup_t;
+
+// Wait for the thumbnail. Without one, a downloaded JPEG serves as its own thumbnail.
+static bool settle_thumbnail(download_followup_t *followup, const char *thumbnail_path)
+{
+    bool downloaded = thumbnail_fetch_wait(followup->thumb);
+    if (followup->original_is_jpeg && !downloaded) {
+        unlink(thumbnail_path);
+        if (rename(CURRENT_UPLOAD_PATH, thumbnail_path) == 0) {
+            ESP_LOGI(TAG, "Using original JPEG as thumbnail: %s", thumbnail_path);
+        } else {
+            ESP_LOGW(TAG, "Failed to move original JPEG to thumbnail path");
+            unlink(CURRENT_UPLOAD_PATH);
+        }
+    } else if (followup->original_is_jpeg) {
+        unlink(CURRENT_UPLOAD_PATH);
+    }
+    followup->original_is_jpeg = false;
+    return downloaded;
+}
+
+// Download and process an image. The thumbnail goes to thumbnail_path and is fetched through
+// followup->thumb alongside processing. Images decoded in memory and packed frames are shown
+// right away (packed frames are returned through raw_frame_out when that is given); anything
+// rendered to a file is returned through saved_image_path for the caller to show before it
+// calls download_followup_finish().
+static esp_err_t fetch_and_process_image(const char *url, const char *thumbnail_path,
+                                         char *saved_image_path, size_t path_size,
+                                         uint8_t **raw_frame_out, download_followup_t *followup,
+                                         image_profile_t *profile)
 {
     ESP_LOGI(TAG, "Fetching image from URL: %s", url);
 
+    // Left empty when the image is shown straight from memory
+    saved_image_path[0] = '\0';
+
     // Use fixed paths for current image and upload
-    const char *temp_jpg_path = CURRENT_JPG_PATH;
+    const char *temp_jpg_path = thumbnail_path;
     const char *temp_upload_path = CURRENT_UPLOAD_PATH;
     const char *temp_bmp_path = CURRENT_BMP_PATH;
     const char *temp_png_path = CURRENT_PNG_PATH;
@@ -77,6 +476,15 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
     char *thumbnail_url_buffer = NULL;
     int total_downloaded = 0;
     const int max_retries = 3;
+    raw_frame_decoder_t *raw_frame = NULL;
+    esp_err_t raw_frame_err = ESP_OK;
+    uint32_t request_key = 0;
+    download_context_t ctx = {0};
+    esp_http_client_handle_t thumbnail_client = NULL;
+
+    // Without a Downloads album copy to keep, JPEG and PNG bodies never need to touch storage
+    bool stream_decode = !raw_frame_out && !(storage_has_persistent_storage() &&
+                                             config_manager_get_save_downloaded_images());
 
     // Allocate buffers once before retry loop
     thumbnail_url_buffer = calloc(512, 1);
@@ -98,19 +506,17 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
             vTaskDelay(pdMS_TO_TICKS(2000));  // 2 second delay between retries
         }
 
-        FILE *file = fopen(temp_upload_path, "wb");
-        if (!file) {
-            ESP_LOGE(TAG, "Failed to open file for writing: %s", temp_upload_path);
-            continue;  // Try again
-        }
-
         // Clear buffers for this retry
         memset(content_type, 0, 128);
 
-        download_context_t ctx = {.file = file,
-                                  .total_read = 0,
-                                  .content_type = content_type,
-                                  .thumbnail_url = thumbnail_url_buffer};
+        ctx = (download_context_t){.file_path = temp_upload_path,
+                                   .stream_decode = stream_decode,
+                                   .total_read = 0,
+                                   .content_type = content_type,
+                                   .thumbnail_url = thumbnail_url_buffer,
+                                   .accept_raw_frame = true,
+                                   .raw_frame = NULL,
+                                   .raw_frame_err = ESP_OK};
 
         esp_http_client_config_t config = {
             .url = url,
@@ -125,10 +531,12 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
         esp_http_client_handle_t client = esp_http_client_init(&config);
         if (!client) {
             ESP_LOGE(TAG, "Failed to initialize HTTP client");
-            fclose(file);
             continue;  // Try again
         }
 
+        esp_http_client_set_header(client, "Accept",
+                                   "image/jpeg, image/png, image/bmp, " RAW_FRAME_CONTENT_TYPE);
+
         // Add Authorization Bearer header if access token is configured
         const char *access_token = config_manager_get_access_token();
         if (access_token && strlen(access_token) > 0) {
@@ -168,10 +576,13 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
         snprintf(height_str, sizeof(height_str), "%d", BOARD_HAL_DISPLAY_HEIGHT);
         esp_http_client_set_header(client, "X-Display-Width", width_str);
         esp_http_client_set_header(client, "X-Display-Height", height_str);
-        esp_http_client_set_header(
-            client, "X-Display-Orientation",
+        const char *orientation =
             config_manager_get_display_orientation() == DISPLAY_ORIENTATION_LANDSCAPE ? "landscape"
-                                                                                      : "portrait");
+                                                                                      : "portrait";
+        esp_http_client_set_header(client, "X-Display-Orientation", orientation);
+        request_key = esp_rom_crc32_le(0, (const uint8_t *) url, strlen(url));
+        request_key =
+            esp_rom_crc32_le(request_key, (const uint8_t *) orientation, strlen(orientation));
 
         // Add processing settings as JSON header
         processing_settings_t proc_settings;
@@ -181,6 +592,8 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
         char *settings_json = processing_settings_to_json(&proc_settings);
         if (settings_json) {
             esp_http_client_set_header(client, "X-Processing-Settings", settings_json);
+            request_key = esp_rom_crc32_le(request_key, (const uint8_t *) settings_json,
+                                           strlen(settings_json));
             free(settings_json);
         }
 
@@ -192,18 +605,46 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
         char *palette_json = color_palette_to_json(&palette);
         if (palette_json) {
             esp_http_client_set_header(client, "X-Color-Palette", palette_json);
+            request_key = esp_rom_crc32_le(request_key, (const uint8_t *) palette_json,
+                                           strlen(palette_json));
             free(palette_json);
         }
 
+        // Let the server answer 304 if the image on the panel is still current
+        if (url_cache_matches(request_key)) {
+            if (url_cache.etag[0] != '\0') {
+                esp_http_client_set_header(client, "If-None-Match", url_cache.etag);
+            }
+            if (url_cache.last_modified[0] != '\0') {
+                esp_http_client_set_header(client, "If-Modified-Since", url_cache.last_modified);
+            }
+        }
+
+        timeline_begin(TIMELINE_DOWNLOAD);
         err = esp_http_client_perform(client);
+        timeline_end(TIMELINE_DOWNLOAD);
 
         status_code = esp_http_client_get_status_code(client);
         content_length = esp_http_client_get_content_length(client);
         total_downloaded = ctx.total_read;
         content_type = ctx.content_type;
+        raw_frame = ctx.raw_frame;
+        raw_frame_err = ctx.raw_frame_err;
+
+        if (ctx.file) {
+            fclose(ctx.file);
+        }
+        // Keep the connection open when the thumbnail comes from the same server
+        if (err == ESP_OK && status_code == 200 && total_downloaded > 0 &&
+            thumbnail_url_buffer[0] != '\0' && url_same_origin(url, thumbnail_url_buffer)) {
+            thumbnail_client = client;
+        } else {
+            esp_http_client_cleanup(client);
+        }
 
-        fclose(file);
-        esp_http_client_cleanup(client);
+        if (err == ESP_OK && status_code == 304) {
+            break;
+        }
 
         // Check if download was successful
         if (err == ESP_OK && status_code == 200 && total_downloaded > 0) {
@@ -223,6 +664,33 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
 
         // Clean up failed download (don't free content_type - it's reused across retries)
         unlink(temp_upload_path);
+        raw_frame_decoder_free(raw_frame);
+        raw_frame = NULL;
+        image_processor_stream_decoder_free(ctx.decoder);
+        ctx.decoder = NULL;
+    }
+
+    // The panel already shows this image: skip processing and the refresh
+    bool unchanged = false;
+    if (err == ESP_OK && status_code == 304) {
+        ESP_LOGI(TAG, "Image not modified (304), keeping the current frame");
+        unchanged = true;
+    } else if (err == ESP_OK && status_code == 200 && url_cache_matches(request_key) &&
+               ctx.body_digest == url_cache.body_digest) {
+        ESP_LOGI(TAG, "Downloaded image matches the current frame (digest %08lx)",
+                 (unsigned long) ctx.body_digest);
+        unchanged = true;
+    }
+    if (unchanged) {
+        free(content_type);
+        free(thumbnail_url_buffer);
+        raw_frame_decoder_free(raw_frame);
+        image_processor_stream_decoder_free(ctx.decoder);
+        if (thumbnail_client) {
+            esp_http_client_cleanup(thumbnail_client);
+        }
+        unlink(temp_upload_path);
+        return ESP_OK;
     }
 
     // Check final result after all retries
@@ -234,9 +702,21 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
         return ESP_FAIL;
     }
 
+    url_cache_pending = (url_cache_t){.valid = true,
+                                      .request_key = request_key,
+                                      .body_digest = ctx.body_digest};
+    strlcpy(url_cache_pending.etag, ctx.etag, sizeof(url_cache_pending.etag));
+    strlcpy(url_cache_pending.last_modified, ctx.last_modified,
+            sizeof(url_cache_pending.last_modified));
+
     // Detect format regardless of Content-Type (which might be unreliable)
-    image_format_t image_format = image_processor_detect_format(temp_upload_path);
-    if (image_format == IMAGE_FORMAT_UNKNOWN) {
+    image_format_t image_format = IMAGE_FORMAT_UNKNOWN;
+    if (ctx.decoder) {
+        image_format = ctx.format;
+    } else if (!raw_frame) {
+        image_format = image_processor_detect_format(temp_upload_path);
+    }
+    if (image_format == IMAGE_FORMAT_UNKNOWN && !raw_frame) {
         // Fallback to Content-Type if detection failed or file is empty?
         // Actually, detect_format is more reliable. If it fails, we trust it.
         // But maybe we should check Content-Type as a hint if detection returned UNKNOWN?
@@ -252,51 +732,14 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
     // Free content_type after successful processing
     free(content_type);
 
-    // Track if thumbnail was successfully downloaded
-    bool thumbnail_downloaded = false;
-
-    // Download thumbnail if URL was provided in X-Thumbnail-URL header
-    if (thumbnail_url_buffer && strlen(thumbnail_url_buffer) > 0) {
-        ESP_LOGI(TAG, "Downloading thumbnail from: %s", thumbnail_url_buffer);
-
-        FILE *thumb_file = fopen(temp_jpg_path, "wb");
-        if (thumb_file) {
-            char thumb_content_type[128] = {0};
-            download_context_t thumb_ctx = {.file = thumb_file,
-                                            .total_read = 0,
-                                            .content_type = thumb_content_type,
-                                            .thumbnail_url = NULL};
-
-            esp_http_client_config_t thumb_config = {
-                .url = thumbnail_url_buffer,
-                .timeout_ms = 30000,
-                .event_handler = http_event_handler,
-                .user_data = &thumb_ctx,
-                .max_redirection_count = 5,
-                .user_agent = "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36",
-            };
-
-            esp_http_client_handle_t thumb_client = esp_http_client_init(&thumb_config);
-            if (thumb_client) {
-                esp_err_t thumb_err = esp_http_client_perform(thumb_client);
-                int thumb_status = esp_http_client_get_status_code(thumb_client);
-
-                fclose(thumb_file);
-                esp_http_client_cleanup(thumb_client);
-
-                if (thumb_err == ESP_OK && thumb_status == 200 && thumb_ctx.total_read > 0) {
-                    ESP_LOGI(TAG, "Thumbnail downloaded successfully: %d bytes",
-                             thumb_ctx.total_read);
-                    thumbnail_downloaded = true;
-                } else {
-                    ESP_LOGW(TAG, "Failed to download thumbnail (status: %d)", thumb_status);
-                    unlink(temp_jpg_path);
-                }
-            } else {
-                fclose(thumb_file);
-                unlink(temp_jpg_path);
-            }
-        }
+    // Download thumbnail if URL was provided in X-Thumbnail-URL header. It runs alongside
+    // processing and is only waited for once the panel was updated.
+    if (thumbnail_url_buffer[0] != '\0') {
+        ESP_LOGI(TAG, "Downloading thumbnail from: %s%s", thumbnail_url_buffer,
+                 thumbnail_client ? " (reusing connection)" : "");
+        followup->thumb =
+            thumbnail_fetch_start(thumbnail_url_buffer, temp_jpg_path, thumbnail_client);
+        thumbnail_client = NULL;
     }
 
     // Free thumbnail URL buffer
@@ -304,9 +747,35 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
         free(thumbnail_url_buffer);
     }
 
+    if (raw_frame) {
+        unlink(temp_upload_path);
+        err = show_downloaded_raw_frame(raw_frame, raw_frame_err, raw_frame_out);
+        if (!thumbnail_fetch_wait(followup->thumb)) {
+            unlink(temp_jpg_path);
+        }
+        return err;
+    }
+
+    if (ctx.decoder) {
+        // Without a thumbnail URL a streamed JPEG was also stored, so it can be its own thumbnail
+        bool own_thumbnail = !followup->thumb && image_format == IMAGE_FORMAT_JPG &&
+                             rename(temp_upload_path, temp_jpg_path) == 0;
+        if (own_thumbnail) {
+            ESP_LOGI(TAG, "Using original JPEG as thumbnail: %s", temp_jpg_path);
+        } else {
+            unlink(temp_upload_path);
+        }
+        err = show_downloaded_stream(ctx.decoder, ctx.decoder_err, image_format, profile);
+        image_processor_stream_decoder_free(ctx.decoder);
+        if (!own_thumbnail && !thumbnail_fetch_wait(followup->thumb)) {
+            unlink(temp_jpg_path);
+        }
+        return err;
+    }
+
     const char *final_path = NULL;
+    followup->original_is_jpeg = image_format == IMAGE_FORMAT_JPG;
 
-    // ========== STEP 1: Image Processing (always done first) ==========
     if (image_format == IMAGE_FORMAT_BMP) {
         // BMP: just move to temp_bmp_path (no processing needed)
         unlink(temp_bmp_path);
@@ -341,190 +810,292 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
 
             if (storage_has_persistent_storage()) {
                 // Persistent storage system: process to file
-                err = image_processor_process(temp_upload_path, temp_png_path, algo);
+                err = image_processor_process(temp_upload_path, temp_png_path, algo, profile);
                 if (err != ESP_OK) {
                     ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
                     unlink(temp_upload_path);
+                    followup->original_is_jpeg = false;
                     return err;
                 }
             } else {
-                // Temporary/No-storage system: read file to buffer, process to RGB, display
-                // directly
-                FILE *fp = fopen(temp_upload_path, "rb");
-                if (!fp) {
-                    ESP_LOGE(TAG, "Failed to open uploaded file");
-                    unlink(temp_upload_path);
-                    return ESP_FAIL;
-                }
-
-                fseek(fp, 0, SEEK_END);
-                long file_size = ftell(fp);
-                fseek(fp, 0, SEEK_SET);
-
-                uint8_t *file_buffer = heap_caps_malloc(file_size, MALLOC_CAP_SPIRAM);
-                if (!file_buffer) {
-                    ESP_LOGE(TAG, "Failed to allocate buffer for image");
-                    fclose(fp);
-                    unlink(temp_upload_path);
-                    return ESP_ERR_NO_MEM;
-                }
-
-                size_t bytes_read = fread(file_buffer, 1, file_size, fp);
-                fclose(fp);
-
-                if (bytes_read != (size_t) file_size) {
-                    ESP_LOGE(TAG, "Incomplete file read: %zu of %ld bytes", bytes_read, file_size);
-                    heap_caps_free(file_buffer);
-                    unlink(temp_upload_path);
-                    return ESP_ERR_INVALID_SIZE;
-                }
+                // Temporary/No-storage system: decode straight out of the RAM file, process to
+                // RGB, display directly
+                image_process_rgb_result_t result;
+                err = image_processor_process_file_to_rgb(temp_upload_path, image_format, algo,
+                                                          &result, profile);
 
-                // For JPEG: save as thumbnail
-                if (image_format == IMAGE_FORMAT_JPG && !thumbnail_downloaded) {
-                    unlink(temp_jpg_path);
-                    if (rename(temp_upload_path, temp_jpg_path) == 0) {
-                        ESP_LOGI(TAG, "Using original JPEG as thumbnail: %s", temp_jpg_path);
-                    } else {
-                        unlink(temp_upload_path);
-                    }
-                } else {
+                // Only a JPEG is worth keeping around as a thumbnail candidate
+                if (image_format != IMAGE_FORMAT_JPG) {
                     unlink(temp_upload_path);
                 }
-
-                // Process to RGB buffer
-                image_process_rgb_result_t result;
-                err = image_processor_process_to_rgb(file_buffer, file_size, image_format, algo,
-                                                     &result);
-                heap_caps_free(file_buffer);
-
                 if (err != ESP_OK) {
                     ESP_LOGE(TAG, "Failed to process image: %s", esp_err_to_name(err));
                     return err;
                 }
 
                 // Display directly from RGB buffer
-                err = display_manager_show_rgb_buffer(result.rgb_data, result.width, result.height);
-                heap_caps_free(result.rgb_data);
+                err = display_manager_show_rgb_buffer(result.rgb_data, result.width,
+                                                      result.height, false);
+                pipeline_arena_free(result.rgb_data);
 
                 if (err != ESP_OK) {
                     ESP_LOGE(TAG, "Failed to display image");
                     return err;
                 }
+                image_processor_profile_add_stage(profile, IMAGE_STAGE_PAINT,
+                                                  display_manager_get_last_paint_us());
 
                 ESP_LOGI(TAG, "Image displayed from buffer");
                 return ESP_OK;
             }
-        }
-        final_path = temp_png_path;
-
-        // Handle thumbnail for JPEG: use original as thumbnail if none was downloaded
-        if (image_format == IMAGE_FORMAT_JPG && !thumbnail_downloaded) {
-            unlink(temp_jpg_path);
-            if (rename(temp_upload_path, temp_jpg_path) != 0) {
-                ESP_LOGW(TAG, "Failed to move original JPEG to thumbnail path");
+            if (image_format != IMAGE_FORMAT_JPG) {
                 unlink(temp_upload_path);
-            } else {
-                ESP_LOGI(TAG, "Using original JPEG as thumbnail: %s", temp_jpg_path);
             }
-        } else {
-            // Clean up original upload file
-            unlink(temp_upload_path);
         }
+        final_path = temp_png_path;
     } else {
         ESP_LOGE(TAG, "Unsupported image format: %d", image_format);
         unlink(temp_upload_path);
+        followup->original_is_jpeg = false;
         return ESP_FAIL;
     }
 
-    // ========== STEP 2: Optionally save to Downloads album ==========
-    if (storage_has_persistent_storage()) {
-        bool save_images = config_manager_get_save_downloaded_images();
-
-        if (save_images) {
-            char downloads_path[256];
-            snprintf(downloads_path, sizeof(downloads_path), "%s/Downloads", IMAGE_DIRECTORY);
+    snprintf(saved_image_path, path_size, "%s", final_path);
+    ESP_LOGI(TAG, "Successfully processed image: %s", saved_image_path);
 
-            // Create Downloads directory if it doesn't exist
-            struct stat st;
-            if (stat(downloads_path, &st) != 0) {
-                ESP_LOGI(TAG, "Creating Downloads album directory");
-                if (mkdir(downloads_path, 0755) != 0) {
-                    ESP_LOGE(TAG, "Failed to create Downloads directory");
-                    // Processing succeeded, just can't save to album - fall through to use temp
-                    // path
-                    goto use_temp_path;
-                }
-            }
+    return ESP_OK;
+}
 
-            // Generate unique filename based on timestamp
-            time_t now = time(NULL);
-            char filename_base[64];
-            snprintf(filename_base, sizeof(filename_base), "download_%lld", (long long) now);
-
-            char final_image_path[512];
-            bool thumbnail_saved_to_album = false;
-
-            if (image_format == IMAGE_FORMAT_BMP) {
-                snprintf(final_image_path, sizeof(final_image_path), "%s/%s.bmp", downloads_path,
-                         filename_base);
-                if (rename(final_path, final_image_path) != 0) {
-                    ESP_LOGW(TAG, "Failed to move BMP to Downloads album, using temp path");
-                } else {
-                    final_path = NULL;  // Will be set below
-                }
-            } else {
-                snprintf(final_image_path, sizeof(final_image_path), "%s/%s.png", downloads_path,
-                         filename_base);
-                if (rename(final_path, final_image_path) != 0) {
-                    ESP_LOGW(TAG, "Failed to move PNG to Downloads album, using temp path");
-                } else {
-                    final_path = NULL;  // Will be set below
-                }
-            }
+// Finish a download after its image was shown: settle the thumbnail and, if configured, move
+// the rendered image and thumbnail into the Downloads album. saved_image_path is updated to
+// the album copy when the move succeeds.
+static void download_followup_finish(download_followup_t *followup, const char *thumbnail_path,
+                                     char *saved_image_path, size_t path_size)
+{
+    bool thumbnail_downloaded = settle_thumbnail(followup, thumbnail_path);
+    thumbnail_fetch_free(followup->thumb);
+    followup->thumb = NULL;
 
-            // Move thumbnail to album if we successfully moved the main image
-            if (final_path == NULL) {
-                struct stat thumb_st;
-                if (stat(temp_jpg_path, &thumb_st) == 0) {
-                    char final_thumb_path[512];
-                    snprintf(final_thumb_path, sizeof(final_thumb_path), "%s/%s.jpg",
-                             downloads_path, filename_base);
-                    if (rename(temp_jpg_path, final_thumb_path) == 0) {
-                        thumbnail_saved_to_album = true;
-                    } else {
-                        ESP_LOGW(TAG, "Failed to move thumbnail to Downloads album");
-                    }
-                }
+    if (saved_image_path[0] == '\0') {
+        return;  // Shown from memory, nothing was rendered to a file
+    }
+    if (!storage_has_persistent_storage() || !config_manager_get_save_downloaded_images()) {
+        ESP_LOGI(TAG, "Image processed (not saved to album): %s", saved_image_path);
+        if (thumbnail_downloaded) {
+            ESP_LOGI(TAG, "Downloaded thumbnail available: %s", thumbnail_path);
+        }
+        return;
+    }
 
-                if (thumbnail_saved_to_album) {
-                    ESP_LOGI(TAG, "Saved to Downloads album: %s (with thumbnail)", filename_base);
-                } else {
-                    ESP_LOGI(TAG, "Saved to Downloads album: %s", filename_base);
-                }
-                snprintf(saved_image_path, path_size, "%s", final_image_path);
-            }
+    char downloads_path[256];
+    snprintf(downloads_path, sizeof(downloads_path), "%s/Downloads", IMAGE_DIRECTORY);
+
+    // Create Downloads directory if it doesn't exist
+    struct stat st;
+    if (stat(downloads_path, &st) != 0) {
+        ESP_LOGI(TAG, "Creating Downloads album directory");
+        if (mkdir(downloads_path, 0755) != 0) {
+            // Processing succeeded, just can't save to album - keep the temp path
+            ESP_LOGE(TAG, "Failed to create Downloads directory");
+            return;
         }
+    }
 
-    use_temp_path:
-        // If not saved to album (or save failed), use temp path
-        if (final_path != NULL) {
-            snprintf(saved_image_path, path_size, "%s", final_path);
-            ESP_LOGI(TAG, "Image processed (not saved to album): %s", final_path);
-            if (thumbnail_downloaded) {
-                ESP_LOGI(TAG, "Downloaded thumbnail available: %s", temp_jpg_path);
-            }
+    // Generate unique filename based on timestamp
+    time_t now = time(NULL);
+    char filename_base[64];
+    snprintf(filename_base, sizeof(filename_base), "download_%lld", (long long) now);
+
+    const char *ext = strrchr(saved_image_path, '.');
+    char final_image_path[512];
+    snprintf(final_image_path, sizeof(final_image_path), "%s/%s%s", downloads_path,
+             filename_base, ext ? ext : ".png");
+    if (rename(saved_image_path, final_image_path) != 0) {
+        ESP_LOGW(TAG, "Failed to move %s to Downloads album, using temp path", saved_image_path);
+        return;
+    }
+    display_manager_current_image_moved(saved_image_path, final_image_path);
+
+    // Move thumbnail to album now that the main image is there
+    bool thumbnail_saved_to_album = false;
+    struct stat thumb_st;
+    if (stat(thumbnail_path, &thumb_st) == 0) {
+        char final_thumb_path[512];
+        snprintf(final_thumb_path, sizeof(final_thumb_path), "%s/%s.jpg", downloads_path,
+                 filename_base);
+        if (rename(thumbnail_path, final_thumb_path) == 0) {
+            thumbnail_saved_to_album = true;
+        } else {
+            ESP_LOGW(TAG, "Failed to move thumbnail to Downloads album");
         }
+    }
+
+    if (thumbnail_saved_to_album) {
+        ESP_LOGI(TAG, "Saved to Downloads album: %s (with thumbnail)", filename_base);
     } else {
-        // No persistent storage support - just use temp path
-        snprintf(saved_image_path, path_size, "%s", final_path);
-        ESP_LOGI(TAG, "Image processed: %s", final_path);
-        if (thumbnail_downloaded) {
-            ESP_LOGI(TAG, "Downloaded thumbnail available: %s", temp_jpg_path);
+        ESP_LOGI(TAG, "Saved to Downloads album: %s", filename_base);
+    }
+    album_manager_index_add("Downloads", strrchr(final_image_path, '/') + 1,
+                            thumbnail_saved_to_album);
+    snprintf(saved_image_path, path_size, "%s", final_image_path);
+}
+
+// Download and process an image, then finish its followup right away. Used where nothing is
+// waiting on the panel.
+static esp_err_t fetch_image_from_url(const char *url, const char *thumbnail_path,
+                                      char *saved_image_path, size_t path_size,
+                                      uint8_t **raw_frame_out)
+{
+    download_followup_t followup = {0};
+    image_profile_t profile = {0};
+    esp_err_t err = fetch_and_process_image(url, thumbnail_path, saved_image_path, path_size,
+                                            raw_frame_out, &followup, &profile);
+    // Processing may have failed before the thumbnail was needed
+    download_followup_finish(&followup, thumbnail_path, saved_image_path, path_size);
+    image_processor_profile_save(&profile);
+    return err;
+}
+
+esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path, size_t path_size)
+{
+    return fetch_image_from_url(url, CURRENT_JPG_PATH, saved_image_path, path_size, NULL);
+}
+
+// Validators of the frame in PREFETCH_FRAME_PATH, moved to url_cache once it is shown
+RTC_DATA_ATTR static url_cache_t prefetch_cache;
+
+// Prefetched frames must survive deep sleep, so they need persistent storage
+static bool url_prefetch_enabled(void)
+{
+    return config_manager_get_prefetch_next_image() && storage_has_persistent_storage();
+}
+
+bool url_prefetch_available(void)
+{
+    struct stat st;
+    return url_prefetch_enabled() && stat(PREFETCH_FRAME_PATH, &st) == 0;
+}
+
+esp_err_t url_prefetch_show(void)
+{
+    FILE *fp = fopen(PREFETCH_FRAME_PATH, "rb");
+    if (!fp) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    raw_frame_decoder_t *decoder = raw_frame_decoder_create();
+    uint8_t *buf = malloc(4096);
+    esp_err_t err = (decoder && buf) ? ESP_OK : ESP_ERR_NO_MEM;
+    size_t n;
+    while (err == ESP_OK && (n = fread(buf, 1, 4096, fp)) > 0) {
+        metrics_add(METRICS_STORAGE_BYTES_READ, n);
+        err = raw_frame_decoder_feed(decoder, buf, n);
+    }
+    fclose(fp);
+    free(buf);
+
+    uint8_t *frame = NULL;
+    if (err == ESP_OK) {
+        err = raw_frame_decoder_finish(decoder, &frame);
+    }
+    raw_frame_decoder_free(decoder);
+
+    // Shown or unreadable, a prefetched frame is only used once
+    unlink(PREFETCH_FRAME_PATH);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Prefetched frame is unusable: %s", esp_err_to_name(err));
+        unlink(PREFETCH_THUMB_PATH);
+        prefetch_cache.valid = false;
+        return err;
+    }
+
+    err = display_manager_show_packed_frame(&frame, false);
+    heap_caps_free(frame);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    unlink(CURRENT_JPG_PATH);
+    rename(PREFETCH_THUMB_PATH, CURRENT_JPG_PATH);
+
+    url_cache_pending = prefetch_cache;
+    prefetch_cache.valid = false;
+    url_cache_commit();
+
+    ESP_LOGI(TAG, "Prefetched frame displayed");
+    return ESP_OK;
+}
+
+esp_err_t url_prefetch_next(void)
+{
+    if (!url_prefetch_enabled()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const char *image_url = config_manager_get_image_url();
+    ESP_LOGI(TAG, "Prefetching next image from: %s", image_url);
+
+    unlink(PREFETCH_FRAME_PATH);
+    unlink(PREFETCH_THUMB_PATH);
+    prefetch_cache.valid = false;
+    url_cache_pending.valid = false;
+
+    char saved_path[512];
+    uint8_t *frame = NULL;
+    esp_err_t err = fetch_image_from_url(image_url, PREFETCH_THUMB_PATH, saved_path,
+                                         sizeof(saved_path), &frame);
+    if (err != ESP_OK) {
+        unlink(PREFETCH_THUMB_PATH);
+        return err;
+    }
+
+    if (!frame && saved_path[0] != '\0') {
+        err = display_manager_render_image(saved_path, &frame);
+        if (!config_manager_get_save_downloaded_images()) {
+            unlink(CURRENT_BMP_PATH);
+            unlink(CURRENT_PNG_PATH);
+        }
+        if (err != ESP_OK) {
+            unlink(PREFETCH_THUMB_PATH);
+            return err;
         }
     }
 
-    ESP_LOGI(TAG, "Successfully processed image: %s", saved_image_path);
+    if (!frame) {
+        // Not modified: the frame on the panel is also the next one
+        ESP_LOGI(TAG, "Next image is unchanged, nothing to prefetch");
+        unlink(PREFETCH_THUMB_PATH);
+        return ESP_OK;
+    }
+
+    size_t frame_size = display_manager_get_frame_size();
+    uint8_t header[RAW_FRAME_HEADER_SIZE];
+    raw_frame_build_header(header, BOARD_HAL_DISPLAY_WIDTH, BOARD_HAL_DISPLAY_HEIGHT, 0,
+                           esp_rom_crc32_le(0, frame, frame_size));
+
+    // Written under a temporary name so a reset mid-write never leaves a partial frame behind
+    const char *temp_path = PREFETCH_FRAME_PATH ".tmp";
+    FILE *fp = fopen(temp_path, "wb");
+    bool written = fp && fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+                   fwrite(frame, 1, frame_size, fp) == frame_size;
+    if (fp && fclose(fp) != 0) {
+        written = false;
+    }
+    if (written) {
+        metrics_add(METRICS_STORAGE_BYTES_WRITTEN, sizeof(header) + frame_size);
+    }
+    heap_caps_free(frame);
+
+    if (!written || rename(temp_path, PREFETCH_FRAME_PATH) != 0) {
+        ESP_LOGE(TAG, "Failed to store prefetched frame");
+        unlink(temp_path);
+        unlink(PREFETCH_THUMB_PATH);
+        return ESP_FAIL;
+    }
 
+    prefetch_cache = url_cache_pending;
+    url_cache_pending.valid = false;
+    ESP_LOGI(TAG, "Next frame prefetched to %s", PREFETCH_FRAME_PATH);
     return ESP_OK;
 }
 
@@ -534,16 +1105,44 @@ esp_err_t trigger_image_rotation(void)
     esp_err_t result = ESP_OK;
 
     if (rotation_mode == ROTATION_MODE_URL) {
+        // With prefetch, show the frame prepared last time and prepare the one after it
+        if (url_prefetch_enabled() && url_prefetch_show() == ESP_OK) {
+            url_prefetch_next();
+            return ESP_OK;
+        }
+
         // URL mode - fetch image from URL
         const char *image_url = config_manager_get_image_url();
         ESP_LOGI(TAG, "URL rotation mode - downloading from: %s", image_url);
 
         char saved_bmp_path[512];
-        if (fetch_and_save_image_from_url(image_url, saved_bmp_path, sizeof(saved_bmp_path)) ==
-            ESP_OK) {
-            ESP_LOGI(TAG, "Successfully downloaded and saved image, displaying...");
-            display_manager_show_image(saved_bmp_path);
+        download_followup_t followup = {0};
+        image_profile_t profile = {0};
+        url_cache_pending.valid = false;
+        esp_err_t err = fetch_and_process_image(image_url, CURRENT_JPG_PATH, saved_bmp_path,
+                                                sizeof(saved_bmp_path), NULL, &followup, &profile);
+        if (err == ESP_OK) {
+            // An empty path means the image was already shown while it was downloaded
+            esp_err_t show_err = ESP_OK;
+            if (saved_bmp_path[0] != '\0') {
+                ESP_LOGI(TAG, "Successfully downloaded and saved image, displaying...");
+                show_err = display_manager_show_image(saved_bmp_path, false);
+            }
+            if (show_err == ESP_OK) {
+                url_cache_commit();
+            } else {
+                // The old frame is still on the panel: don't let the next wake skip this image
+                ESP_LOGE(TAG, "Failed to display downloaded image: %s", esp_err_to_name(show_err));
+                url_cache_pending.valid = false;
+            }
+        }
+
+        // The thumbnail and the Downloads album copy wait until the panel was updated
+        download_followup_finish(&followup, CURRENT_JPG_PATH, saved_bmp_path,
+                                 sizeof(saved_bmp_path));
+        image_processor_profile_save(&profile);
 
+        if (err == ESP_OK) {
             // Delete rendered temp image after display to save storage space,
             // but only if it wasn't saved to the Downloads album.
             if (!config_manager_get_save_downloaded_images()) {
@@ -551,6 +1150,10 @@ esp_err_t trigger_image_rotation(void)
                 unlink(CURRENT_PNG_PATH);
             }
 
+            if (url_prefetch_enabled()) {
+                url_prefetch_next();
+            }
+
             result = ESP_OK;
         } else {
             ESP_LOGE(TAG, "Failed to download image from URL, falling back to local rotation");
@@ -566,6 +1169,18 @@ esp_err_t trigger_image_rotation(void)
     return result;
 }
 
+static esp_err_t image_rotation_job(void *arg)
+{
+    esp_err_t err = trigger_image_rotation();
+    ha_notify_update();
+    return err;
+}
+
+esp_err_t queue_image_rotation(uint32_t *job_id)
+{
+    return display_manager_submit_job(image_rotation_job, NULL, NULL, job_id);
+}
+
 cJSON *create_battery_json(void)
 {
     cJSON *json = cJSON_CreateObject();
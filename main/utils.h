@@ -1,6 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "esp_err.h"
 
 // Fetch image from URL, process it, and save to Downloads album
@@ -13,6 +16,21 @@ esp_err_t fetch_and_save_image_from_url(const char *url, char *saved_image_path,
 // Returns ESP_OK on success, error code on failure
 esp_err_t trigger_image_rotation(void);
 
+// Run trigger_image_rotation() as a display job and notify Home Assistant afterwards.
+// Returns right away; rotations requested while one is waiting collapse into one.
+// job_id (optional) receives the id for display_manager_get_job_status()
+esp_err_t queue_image_rotation(uint32_t *job_id);
+
+// URL rotation prefetch (config_manager_get_prefetch_next_image(), persistent storage only):
+// the next image is downloaded and rendered into PREFETCH_FRAME_PATH before sleeping, so the
+// following rotation can show it without touching the network.
+// True if a prefetched frame is waiting to be shown
+bool url_prefetch_available(void);
+// Show the prefetched frame; ESP_ERR_NOT_FOUND if there is none
+esp_err_t url_prefetch_show(void);
+// Download and render the next frame for url_prefetch_show()
+esp_err_t url_prefetch_next(void);
+
 // Create battery status JSON object with all battery fields
 // Returns cJSON object (caller must delete with cJSON_Delete)
 // Returns NULL on failure
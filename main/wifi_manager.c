@@ -1,18 +1,22 @@
 #include "wifi_manager.h"
 
 #include <string.h>
+#include <time.h>
 
 #include "config.h"
 #include "config_manager.h"
+#include "esp_attr.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
+#include "metrics.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "storage.h"
@@ -22,9 +26,64 @@ static const char *TAG = "wifi_manager";
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
 
+// A direct connect to a known AP takes well under a second; give up on it long before the
+// regular connect's retries would
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 5000
+// The cached lease is only reused as a static address while it is younger than this, which is
+// shorter than the leases common home routers hand out
+#define WIFI_LEASE_REUSE_MAX_AGE_S (2 * 60 * 60)
+
+// The AP and DHCP lease of the last connection, kept across deep sleep so a timer wake can
+// connect without scanning all channels and, while the lease is fresh, without DHCP
+typedef struct {
+    bool valid;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    bool lease_valid;
+    time_t lease_time;  // When DHCP handed out ip_info
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dns_info_t dns_main;
+    esp_netif_dns_info_t dns_backup;
+} wifi_fast_connect_cache_t;
+
+RTC_DATA_ATTR static wifi_fast_connect_cache_t s_fast_cache;
+
 static EventGroupHandle_t s_wifi_event_group;
+static esp_netif_t *s_sta_netif = NULL;
 static int s_retry_num = 0;
 static bool s_is_connected = false;
+static bool s_fast_connecting = false;  // Fail at the first disconnect instead of retrying
+static bool s_static_lease = false;     // The address in use came from s_fast_cache
+static wifi_connect_stats_t s_connect_stats;
+
+// Remember the AP we are associated with and, if DHCP assigned it, the lease
+static void fast_connect_cache_update(const esp_netif_ip_info_t *ip_info)
+{
+    wifi_config_t wifi_config;
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) != ESP_OK ||
+        esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        s_fast_cache.valid = false;
+        return;
+    }
+
+    memset(s_fast_cache.ssid, 0, sizeof(s_fast_cache.ssid));
+    memcpy(s_fast_cache.ssid, wifi_config.sta.ssid, sizeof(wifi_config.sta.ssid));
+    memcpy(s_fast_cache.bssid, ap_info.bssid, sizeof(s_fast_cache.bssid));
+    s_fast_cache.channel = ap_info.primary;
+    s_fast_cache.valid = true;
+
+    if (!s_static_lease) {
+        s_fast_cache.ip_info = *ip_info;
+        s_fast_cache.lease_valid =
+            esp_netif_get_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &s_fast_cache.dns_main) ==
+                ESP_OK &&
+            esp_netif_get_dns_info(s_sta_netif, ESP_NETIF_DNS_BACKUP, &s_fast_cache.dns_backup) ==
+                ESP_OK;
+        s_fast_cache.lease_time = time(NULL);
+    }
+}
 
 static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id,
                           void *event_data)
@@ -32,8 +91,12 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_num < 5) {
+        metrics_add(METRICS_WIFI_DISCONNECTS, 1);
+        if (s_fast_connecting) {
+            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+        } else if (s_retry_num < 5) {
             esp_wifi_connect();
+            metrics_add(METRICS_WIFI_RECONNECT_ATTEMPTS, 1);
             s_retry_num++;
             ESP_LOGI(TAG, "retry to connect to the AP");
         } else {
@@ -46,6 +109,8 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
         s_is_connected = true;
+        metrics_add(METRICS_WIFI_CONNECTS, 1);
+        fast_connect_cache_update(&event->ip_info);
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
@@ -60,6 +125,7 @@ esp_err_t wifi_manager_init(void)
     // Create both STA and AP network interfaces
     esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
     esp_netif_create_default_wifi_ap();
+    s_sta_netif = sta_netif;
 
     // Set DHCP hostname
     if (sta_netif) {
@@ -86,6 +152,67 @@ esp_err_t wifi_manager_init(void)
     return ESP_OK;
 }
 
+// Connect straight to the cached AP on its channel, with the cached lease if it is fresh.
+// Returns ESP_ERR_NOT_FOUND if nothing usable is cached, ESP_FAIL if the AP did not accept us.
+// Only used on wakes from deep sleep: the connection is pinned to one BSSID, which is fine for a
+// short wake but would keep an always-on frame from roaming.
+static esp_err_t wifi_fast_connect(const wifi_config_t *base_config)
+{
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP || !s_fast_cache.valid || !s_sta_netif ||
+        strncmp(s_fast_cache.ssid, (const char *) base_config->sta.ssid,
+                sizeof(base_config->sta.ssid)) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    wifi_config_t wifi_config = *base_config;
+    wifi_config.sta.bssid_set = true;
+    memcpy(wifi_config.sta.bssid, s_fast_cache.bssid, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.channel = s_fast_cache.channel;
+
+    time_t lease_age = time(NULL) - s_fast_cache.lease_time;
+    s_static_lease =
+        s_fast_cache.lease_valid && lease_age >= 0 && lease_age < WIFI_LEASE_REUSE_MAX_AGE_S;
+    if (s_static_lease) {
+        esp_netif_dhcpc_stop(s_sta_netif);
+        if (esp_netif_set_ip_info(s_sta_netif, &s_fast_cache.ip_info) != ESP_OK) {
+            esp_netif_dhcpc_start(s_sta_netif);
+            s_static_lease = false;
+        } else {
+            esp_netif_set_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &s_fast_cache.dns_main);
+            esp_netif_set_dns_info(s_sta_netif, ESP_NETIF_DNS_BACKUP, &s_fast_cache.dns_backup);
+        }
+    }
+
+    ESP_LOGI(TAG, "Fast reconnect to " MACSTR " on channel %d%s", MAC2STR(s_fast_cache.bssid),
+             s_fast_cache.channel, s_static_lease ? " with cached lease" : "");
+
+    esp_wifi_stop();
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    s_retry_num = 0;
+    s_fast_connecting = true;
+    xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+    ESP_ERROR_CHECK(esp_wifi_start());
+    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MIN_MODEM));
+
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                                           pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(WIFI_FAST_CONNECT_TIMEOUT_MS));
+    s_fast_connecting = false;
+    if (bits & WIFI_CONNECTED_BIT) {
+        return ESP_OK;
+    }
+
+    // The AP moved, or the lease is no longer ours: forget both and scan
+    ESP_LOGW(TAG, "Fast reconnect failed, falling back to a full scan");
+    s_fast_cache.valid = false;
+    s_fast_cache.lease_valid = false;
+    if (s_static_lease) {
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_static_lease = false;
+    }
+    return ESP_FAIL;
+}
+
 esp_err_t wifi_manager_connect(const char *ssid, const char *password)
 {
     if (!ssid || strlen(ssid) == 0) {
@@ -102,6 +229,18 @@ esp_err_t wifi_manager_connect(const char *ssid, const char *password)
     wifi_config.sta.pmf_cfg.capable = true;
     wifi_config.sta.pmf_cfg.required = false;
 
+    int64_t start_time = esp_timer_get_time();
+    if (wifi_fast_connect(&wifi_config) == ESP_OK) {
+        s_connect_stats = (wifi_connect_stats_t){
+            .connect_ms = (int) ((esp_timer_get_time() - start_time) / 1000),
+            .fast = true,
+            .cached_lease = s_static_lease,
+        };
+        ESP_LOGI(TAG, "connected to ap SSID:%s in %d ms (fast reconnect)", ssid,
+                 s_connect_stats.connect_ms);
+        return ESP_OK;
+    }
+
     // Stop WiFi if it's running, then set config
     esp_wifi_stop();
 
@@ -115,7 +254,10 @@ esp_err_t wifi_manager_connect(const char *ssid, const char *password)
                                            pdFALSE, pdFALSE, portMAX_DELAY);
 
     if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "connected to ap SSID:%s", ssid);
+        s_connect_stats = (wifi_connect_stats_t){
+            .connect_ms = (int) ((esp_timer_get_time() - start_time) / 1000),
+        };
+        ESP_LOGI(TAG, "connected to ap SSID:%s in %d ms", ssid, s_connect_stats.connect_ms);
         return ESP_OK;
     } else if (bits & WIFI_FAIL_BIT) {
         ESP_LOGI(TAG, "Failed to connect to SSID:%s", ssid);
@@ -137,6 +279,11 @@ bool wifi_manager_is_connected(void)
     return s_is_connected;
 }
 
+void wifi_manager_get_connect_stats(wifi_connect_stats_t *stats)
+{
+    *stats = s_connect_stats;
+}
+
 esp_err_t wifi_manager_get_ip(char *ip_str, size_t len)
 {
     if (!ip_str || len == 0) {
@@ -183,6 +330,9 @@ esp_err_t wifi_manager_save_credentials(const char *ssid, const char *password)
     err = nvs_commit(nvs_handle);
     nvs_close(nvs_handle);
 
+    // The cached AP belongs to the old network
+    s_fast_cache.valid = false;
+
     return err;
 }
 
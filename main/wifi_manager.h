@@ -12,10 +12,18 @@
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
 
+typedef struct {
+    int connect_ms;     // From wifi_manager_connect() to an IP address, 0 if never connected
+    bool fast;          // Connected straight to the AP cached from the last wake, no scan
+    bool cached_lease;  // Reused the cached DHCP lease instead of asking for one
+} wifi_connect_stats_t;
+
 esp_err_t wifi_manager_init(void);
 esp_err_t wifi_manager_connect(const char *ssid, const char *password);
 esp_err_t wifi_manager_disconnect(void);
 bool wifi_manager_is_connected(void);
+// How the last successful wifi_manager_connect() went
+void wifi_manager_get_connect_stats(wifi_connect_stats_t *stats);
 esp_err_t wifi_manager_get_ip(char *ip_str, size_t len);
 esp_err_t wifi_manager_save_credentials(const char *ssid, const char *password);
 esp_err_t wifi_manager_load_credentials(char *ssid, char *password);
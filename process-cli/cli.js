@@ -241,8 +241,8 @@ function displayDirectlyOnce(host, pngPath, thumbPath) {
           });
 
           res.on("end", () => {
-            if (res.statusCode === 200) {
-              console.log(`✓ Image displayed successfully`);
+            if (res.statusCode === 200 || res.statusCode === 202) {
+              console.log(`✓ Image queued for display`);
               resolve();
             } else {
               reject(
@@ -43,6 +43,7 @@ export const useSettingsStore = defineStore("settings", () => {
     httpHeaderKey: "",
     httpHeaderValue: "",
     saveDownloadedImages: true,
+    prefetchNextImage: false,
     // Home Assistant
     haUrl: "",
     // Power
@@ -164,6 +165,7 @@ export const useSettingsStore = defineStore("settings", () => {
       deviceSettings.value.deepSleepEnabled = data.deep_sleep_enabled !== false;
       deviceSettings.value.haUrl = data.ha_url || "";
       deviceSettings.value.saveDownloadedImages = data.save_downloaded_images !== false;
+      deviceSettings.value.prefetchNextImage = data.prefetch_next_image === true;
       deviceSettings.value.accessToken = data.access_token || "";
       deviceSettings.value.httpHeaderKey = data.http_header_key || "";
       deviceSettings.value.httpHeaderValue = data.http_header_value || "";
@@ -249,6 +251,7 @@ export const useSettingsStore = defineStore("settings", () => {
       ha_url: deviceSettings.value.haUrl,
       deep_sleep_enabled: deviceSettings.value.deepSleepEnabled,
       save_downloaded_images: deviceSettings.value.saveDownloadedImages,
+      prefetch_next_image: deviceSettings.value.prefetchNextImage,
       display_orientation: deviceSettings.value.displayOrientation,
       sleep_schedule_enabled: deviceSettings.value.sleepScheduleEnabled,
       sleep_schedule_start: sleepScheduleStart,
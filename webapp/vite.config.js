@@ -14,9 +14,10 @@ export default defineConfig({
     rollupOptions: {
       external: ["/measurement_sample.jpg"],
       output: {
-        entryFileNames: "assets/[name].js",
-        chunkFileNames: "assets/[name].js",
-        assetFileNames: "assets/[name].[ext]",
+        // Content-hashed names let the firmware serve assets as immutable
+        entryFileNames: "assets/[name]-[hash].js",
+        chunkFileNames: "assets/[name]-[hash].js",
+        assetFileNames: "assets/[name]-[hash].[ext]",
       },
     },
   },